@@ -1,25 +1,37 @@
 #include "bm8563.h"
 #include <cstring>
+#include <esp_log.h>
 
 u8 bcd_to_dec(u8 bcd) { return (bcd >> 4) * 10 + (bcd & 0x0f); }
 
 u8 dec_to_bcd(u8 dec) { return ((dec / 10) << 4) | (dec % 10); }
 
-Bm8563::Bm8563(i2c_master_bus_handle_t i2c_handle, u16 address) {
-  i2c_device_config_t dev = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = address,
-      .scl_speed_hz = 400000,
-  };
-  ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_handle, &dev, &m_device));
+// Reading the registers has no side effects, so reads of several tasks can
+// share a transaction.
+Bm8563::Bm8563(I2cBus& bus, u16 address)
+    : m_device(bus.add_device(address, 400000, "BM8563", I2cPriority::Normal,
+                              I2cReadMerging::IdenticalReads)) {
+  if (!ensure_initialized())
+    ESP_LOGE("BM8563", "Initialization failed, retrying on the next access");
+}
 
+bool Bm8563::initialize() const {
   u8 data[2] = {0};
-  write(0x00, data, 2);
+  return write(0x00, data, 2);
+}
+
+bool Bm8563::ensure_initialized() {
+  if (m_device->take_reinitialization_request())
+    m_initialized = false;
+  if (!m_initialized)
+    m_initialized = initialize();
+  return m_initialized;
 }
 
-Bm8563::DateTime Bm8563::read_date_time() const {
+std::optional<Bm8563::DateTime> Bm8563::read_date_time() {
   u8 buf[7];
-  read(SECONDS_REGISTER, buf, sizeof(buf));
+  if (!ensure_initialized() || !read(SECONDS_REGISTER, buf, sizeof(buf)))
+    return std::nullopt;
 
   return DateTime{
       .year = bcd_to_dec(buf[6]) + (buf[5] & CENTURY_MASK ? 1900 : 2000),
@@ -32,9 +44,10 @@ Bm8563::DateTime Bm8563::read_date_time() const {
   };
 }
 
-void Bm8563::set_date_time(DateTime dt) const {
+bool Bm8563::set_date_time(DateTime dt) {
   u8 values[7];
-  read(SECONDS_REGISTER, values, sizeof(values));
+  if (!ensure_initialized() || !read(SECONDS_REGISTER, values, sizeof(values)))
+    return false;
 
   u8 buf[7] = {
       dec_to_bcd((dt.second & SECOND_MASK) | (values[0] & ~SECOND_MASK)),
@@ -45,18 +58,18 @@ void Bm8563::set_date_time(DateTime dt) const {
       static_cast<u8>(((dt.year >= 2000 ? 0 : 1) << 7) | dec_to_bcd(dt.month)),
       dec_to_bcd(dt.year % 100),
   };
-  write(SECONDS_REGISTER, buf, sizeof(buf));
+  return write(SECONDS_REGISTER, buf, sizeof(buf));
 }
 
-void Bm8563::read(u8 reg, u8* data, u32 length) const {
-  ESP_ERROR_CHECK(i2c_master_transmit_receive(m_device, &reg, 1, data, length,
-                                              I2C_TIMEOUT_MS));
+bool Bm8563::read(u8 reg, u8* data, u32 length) const {
+  return ESP_ERROR_CHECK_WITHOUT_ABORT(m_device->transmit_receive(
+             &reg, 1, data, length, I2C_TIMEOUT_MS)) == ESP_OK;
 }
 
-void Bm8563::write(u8 reg, u8 const* data, u32 length) const {
+bool Bm8563::write(u8 reg, u8 const* data, u32 length) const {
   u8 buf[64];
   buf[0] = reg;
   memcpy(buf + 1, data, length);
-  ESP_ERROR_CHECK(
-      i2c_master_transmit(m_device, buf, length + 1, I2C_TIMEOUT_MS));
+  return ESP_ERROR_CHECK_WITHOUT_ABORT(
+             m_device->transmit(buf, length + 1, I2C_TIMEOUT_MS)) == ESP_OK;
 }
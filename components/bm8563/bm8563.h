@@ -1,6 +1,7 @@
 #pragma once
 
-#include <driver/i2c_master.h>
+#include <i2c_bus.h>
+#include <optional>
 #include <types.h>
 
 class Bm8563 {
@@ -25,10 +26,12 @@ public:
     int second;
   };
 
-  Bm8563(i2c_master_bus_handle_t i2c_handle, u16 address = DEFAULT_ADDRESS);
+  Bm8563(I2cBus& bus, u16 address = DEFAULT_ADDRESS);
 
-  DateTime read_date_time() const;
-  void set_date_time(DateTime dt) const;
+  /// Returns `std::nullopt` on a bus error.
+  std::optional<DateTime> read_date_time();
+  /// Returns false on a bus error.
+  bool set_date_time(DateTime dt);
 
 private:
   static constexpr u8 SECONDS_REGISTER = 0x02;
@@ -40,8 +43,16 @@ private:
   static constexpr u8 MINUTE_MASK = 0b01111111;
   static constexpr u8 SECOND_MASK = 0b01111111;
 
-  void write(u8 reg, u8 const* data, u32 length) const;
-  void read(u8 reg, u8* data, u32 length) const;
+  /// Clears the control registers, i.e. starts the clock and disables alarms
+  /// and timers. Returns false on a bus error.
+  bool initialize() const;
+  /// Initializes the device if that failed before or it may have been reset
+  /// while it wasn't responding. Returns false on a bus error.
+  bool ensure_initialized();
 
-  i2c_master_dev_handle_t m_device;
+  bool write(u8 reg, u8 const* data, u32 length) const;
+  bool read(u8 reg, u8* data, u32 length) const;
+
+  I2cDevice* m_device;
+  bool m_initialized = false;
 };
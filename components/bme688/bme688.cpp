@@ -38,9 +38,9 @@ constexpr char const* bme688_error_to_string(i8 status) {
   } while (false);
 
 i8 i2c_read(u8 reg, u8* reg_data, u32 length, void* intf_ptr) {
-  auto dev = static_cast<i2c_master_dev_handle_t>(intf_ptr);
-  auto result = i2c_master_transmit_receive(dev, &reg, 1, reg_data, length,
-                                            Bme688::I2C_TIMEOUT_MS);
+  auto dev = static_cast<I2cDevice*>(intf_ptr);
+  auto result = dev->transmit_receive(&reg, 1, reg_data, length,
+                                      Bme688::I2C_TIMEOUT_MS);
   if (result != ESP_OK) {
     ESP_LOGD("BME688", "i2c_read receive failure: %s", esp_err_to_name(result));
     return BME68X_E_COM_FAIL;
@@ -49,7 +49,7 @@ i8 i2c_read(u8 reg, u8* reg_data, u32 length, void* intf_ptr) {
 }
 
 i8 i2c_write(u8 reg, u8 const* reg_data, u32 length, void* intf_ptr) {
-  auto dev = static_cast<i2c_master_dev_handle_t>(intf_ptr);
+  auto dev = static_cast<I2cDevice*>(intf_ptr);
 
   // copy the data to insert the register at the beginning
   uint8_t buf[64] = {0};
@@ -59,7 +59,7 @@ i8 i2c_write(u8 reg, u8 const* reg_data, u32 length, void* intf_ptr) {
     buf[buf_len++] = reg_data[i];
   }
 
-  auto result = i2c_master_transmit(dev, buf, buf_len, Bme688::I2C_TIMEOUT_MS);
+  auto result = dev->transmit(buf, buf_len, Bme688::I2C_TIMEOUT_MS);
   if (result != ESP_OK) {
     ESP_LOGD("BME688", "i2c_write failed: %s", esp_err_to_name(result));
     return BME68X_E_COM_FAIL;
@@ -67,14 +67,8 @@ i8 i2c_write(u8 reg, u8 const* reg_data, u32 length, void* intf_ptr) {
   return BME68X_OK;
 }
 
-Bme688::Bme688(i2c_master_bus_handle_t i2c_handle, u16 address) {
-  i2c_device_config_t dev = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = address,
-      .scl_speed_hz = 400000,
-  };
-  ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_handle, &dev, &m_device));
-
+Bme688::Bme688(I2cBus& bus, u16 address)
+    : m_device(bus.add_device(address, 400000, "BME688")) {
   m_sensor.chip_id = address;
   m_sensor.intf = BME68X_I2C_INTF;
   m_sensor.intf_ptr = m_device;
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "bme68x/bme68x.h"
-#include <driver/i2c_master.h>
+#include <i2c_bus.h>
 #include <optional>
 #include <types.h>
 
@@ -38,7 +38,7 @@ public:
     float pressure;
   };
 
-  Bme688(i2c_master_bus_handle_t i2c_handle, u16 address = BME_DEFAULT_ADDRESS);
+  Bme688(I2cBus& bus, u16 address = BME_DEFAULT_ADDRESS);
 
   std::optional<Data> read_sensor();
 
@@ -57,7 +57,7 @@ private:
   void set_conf();
   bme68x_conf get_conf();
 
-  i2c_master_dev_handle_t m_device{};
+  I2cDevice* m_device{};
   bme68x_dev m_sensor{};
   bme68x_conf m_conf{};
   bme68x_heatr_conf m_heater_conf{};
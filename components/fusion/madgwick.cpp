@@ -0,0 +1,173 @@
+#include "madgwick.h"
+
+#include <cmath>
+
+static float inv_sqrt(float v) { return 1.f / sqrtf(v); }
+
+void Madgwick::initialize(Vector3 acc, Vector3 mag) {
+  // rows of the rotation matrix from the sensor into the earth frame are the
+  // earth's axes expressed in the sensor frame
+  auto up = acc.normalized();
+  auto west = up.cross(mag).normalized();
+  // acceleration and magnetic field must not be parallel
+  if (up == Vector3() || west == Vector3())
+    return;
+
+  auto north = west.cross(up);
+  m_q = Quaternion::from_rotation_matrix(Matrix3(north, west, up));
+  m_initialized = true;
+}
+
+void Madgwick::update(Vector3 gyro, Vector3 acc, Vector3 mag, float dt_s) {
+  auto mag_norm = mag.length_squared();
+  if (mag_norm == 0.f) {
+    update(gyro, acc, dt_s);
+    return;
+  }
+
+  auto acc_norm = acc.length_squared();
+  if (acc_norm == 0.f) {
+    integrate(gyro, 0, 0, 0, 0, dt_s);
+    return;
+  }
+
+  acc *= inv_sqrt(acc_norm);
+  mag *= inv_sqrt(mag_norm);
+
+  auto [q0, q1, q2, q3] = m_q;
+
+  auto _2q0mx = 2.f * q0 * mag.x;
+  auto _2q0my = 2.f * q0 * mag.y;
+  auto _2q0mz = 2.f * q0 * mag.z;
+  auto _2q1mx = 2.f * q1 * mag.x;
+  auto _2q0 = 2.f * q0;
+  auto _2q1 = 2.f * q1;
+  auto _2q2 = 2.f * q2;
+  auto _2q3 = 2.f * q3;
+  auto _2q0q2 = 2.f * q0 * q2;
+  auto _2q2q3 = 2.f * q2 * q3;
+  auto q0q0 = q0 * q0;
+  auto q0q1 = q0 * q1;
+  auto q0q2 = q0 * q2;
+  auto q0q3 = q0 * q3;
+  auto q1q1 = q1 * q1;
+  auto q1q2 = q1 * q2;
+  auto q1q3 = q1 * q3;
+  auto q2q2 = q2 * q2;
+  auto q2q3 = q2 * q3;
+  auto q3q3 = q3 * q3;
+
+  // reference direction of the earth's magnetic field
+  auto hx = mag.x * q0q0 - _2q0my * q3 + _2q0mz * q2 + mag.x * q1q1 +
+            _2q1 * mag.y * q2 + _2q1 * mag.z * q3 - mag.x * q2q2 -
+            mag.x * q3q3;
+  auto hy = _2q0mx * q3 + mag.y * q0q0 - _2q0mz * q1 + _2q1mx * q2 -
+            mag.y * q1q1 + mag.y * q2q2 + _2q2 * mag.z * q3 - mag.y * q3q3;
+  auto _2bx = sqrtf(hx * hx + hy * hy);
+  auto _2bz = -_2q0mx * q2 + _2q0my * q1 + mag.z * q0q0 + _2q1mx * q3 -
+              mag.z * q1q1 + _2q2 * mag.y * q3 - mag.z * q2q2 + mag.z * q3q3;
+  auto _4bx = 2.f * _2bx;
+  auto _4bz = 2.f * _2bz;
+
+  // gradient descent corrective step
+  auto s0 = -_2q2 * (2.f * q1q3 - _2q0q2 - acc.x) +
+            _2q1 * (2.f * q0q1 + _2q2q3 - acc.y) -
+            _2bz * q2 * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) -
+                         mag.x) +
+            (-_2bx * q3 + _2bz * q1) *
+                (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - mag.y) +
+            _2bx * q2 *
+                (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mag.z);
+  auto s1 = _2q3 * (2.f * q1q3 - _2q0q2 - acc.x) +
+            _2q0 * (2.f * q0q1 + _2q2q3 - acc.y) -
+            4.f * q1 * (1 - 2.f * q1q1 - 2.f * q2q2 - acc.z) +
+            _2bz * q3 *
+                (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mag.x) +
+            (_2bx * q2 + _2bz * q0) *
+                (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - mag.y) +
+            (_2bx * q3 - _4bz * q1) *
+                (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mag.z);
+  auto s2 = -_2q0 * (2.f * q1q3 - _2q0q2 - acc.x) +
+            _2q3 * (2.f * q0q1 + _2q2q3 - acc.y) -
+            4.f * q2 * (1 - 2.f * q1q1 - 2.f * q2q2 - acc.z) +
+            (-_4bx * q2 - _2bz * q0) *
+                (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mag.x) +
+            (_2bx * q1 + _2bz * q3) *
+                (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - mag.y) +
+            (_2bx * q0 - _4bz * q2) *
+                (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mag.z);
+  auto s3 = _2q1 * (2.f * q1q3 - _2q0q2 - acc.x) +
+            _2q2 * (2.f * q0q1 + _2q2q3 - acc.y) +
+            (-_4bx * q3 + _2bz * q1) *
+                (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mag.x) +
+            (-_2bx * q0 + _2bz * q2) *
+                (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - mag.y) +
+            _2bx * q1 *
+                (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mag.z);
+
+  integrate(gyro, s0, s1, s2, s3, dt_s);
+}
+
+void Madgwick::update(Vector3 gyro, Vector3 acc, float dt_s) {
+  auto acc_norm = acc.length_squared();
+  if (acc_norm == 0.f) {
+    integrate(gyro, 0, 0, 0, 0, dt_s);
+    return;
+  }
+
+  acc *= inv_sqrt(acc_norm);
+
+  auto [q0, q1, q2, q3] = m_q;
+
+  auto _2q0 = 2.f * q0;
+  auto _2q1 = 2.f * q1;
+  auto _2q2 = 2.f * q2;
+  auto _2q3 = 2.f * q3;
+  auto _4q0 = 4.f * q0;
+  auto _4q1 = 4.f * q1;
+  auto _4q2 = 4.f * q2;
+  auto _8q1 = 8.f * q1;
+  auto _8q2 = 8.f * q2;
+  auto q0q0 = q0 * q0;
+  auto q1q1 = q1 * q1;
+  auto q2q2 = q2 * q2;
+  auto q3q3 = q3 * q3;
+
+  // gradient descent corrective step
+  auto s0 = _4q0 * q2q2 + _2q2 * acc.x + _4q0 * q1q1 - _2q1 * acc.y;
+  auto s1 = _4q1 * q3q3 - _2q3 * acc.x + 4.f * q0q0 * q1 - _2q0 * acc.y -
+            _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * acc.z;
+  auto s2 = 4.f * q0q0 * q2 + _2q0 * acc.x + _4q2 * q3q3 - _2q3 * acc.y -
+            _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * acc.z;
+  auto s3 = 4.f * q1q1 * q3 - _2q1 * acc.x + 4.f * q2q2 * q3 - _2q2 * acc.y;
+
+  integrate(gyro, s0, s1, s2, s3, dt_s);
+}
+
+void Madgwick::integrate(Vector3 gyro, float s0, float s1, float s2, float s3,
+                         float dt_s) {
+  auto [q0, q1, q2, q3] = m_q;
+
+  // rate of change of the quaternion from the gyroscope
+  auto q_dot0 = 0.5f * (-q1 * gyro.x - q2 * gyro.y - q3 * gyro.z);
+  auto q_dot1 = 0.5f * (q0 * gyro.x + q2 * gyro.z - q3 * gyro.y);
+  auto q_dot2 = 0.5f * (q0 * gyro.y - q1 * gyro.z + q3 * gyro.x);
+  auto q_dot3 = 0.5f * (q0 * gyro.z + q1 * gyro.y - q2 * gyro.x);
+
+  auto s_norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+  if (s_norm != 0.f) {
+    auto scale = m_beta * inv_sqrt(s_norm);
+    q_dot0 -= s0 * scale;
+    q_dot1 -= s1 * scale;
+    q_dot2 -= s2 * scale;
+    q_dot3 -= s3 * scale;
+  }
+
+  q0 += q_dot0 * dt_s;
+  q1 += q_dot1 * dt_s;
+  q2 += q_dot2 * dt_s;
+  q3 += q_dot3 * dt_s;
+
+  auto norm = inv_sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  m_q = Quaternion(q0 * norm, q1 * norm, q2 * norm, q3 * norm);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <types.h>
+
+/// Madgwick orientation filter fusing accelerometer, gyroscope and
+/// (optionally) magnetometer measurements into a quaternion.
+///
+/// The filter works in a right-handed sensor frame whose z-axis points up when
+/// the device lies flat. The earth frame's x-axis points to magnetic north and
+/// its z-axis up, so the quaternion rotates vectors from the sensor frame into
+/// the earth frame.
+///
+/// Everything is computed in single precision floats, which the ESP32-S3's
+/// FPU handles natively.
+///
+/// Based on: https://x-io.co.uk/open-source-imu-and-ahrs-algorithms/
+class Madgwick {
+public:
+  explicit Madgwick(float beta = DEFAULT_BETA)
+      : m_beta(beta) {}
+
+  /// Sets the orientation directly from a single accelerometer and
+  /// magnetometer measurement, so the filter doesn't have to converge from the
+  /// identity orientation first.
+  void initialize(Vector3 acc, Vector3 mag);
+
+  /// Integrates one sample. `gyro` is in rad/s, `acc` and `mag` can be in any
+  /// unit, as they are normalized.
+  void update(Vector3 gyro, Vector3 acc, Vector3 mag, float dt_s);
+  /// Same as the above, but without a magnetometer measurement. Only pitch and
+  /// roll are corrected, the heading is only integrated from the gyroscope.
+  void update(Vector3 gyro, Vector3 acc, float dt_s);
+
+  bool initialized() const { return m_initialized; }
+  Quaternion const& quaternion() const { return m_q; }
+
+  /// Rotates `v` from the sensor frame into the earth frame.
+  Vector3 to_earth_frame(Vector3 const& v) const { return m_q.rotate(v); }
+
+private:
+  /// Filter gain. Higher values trust the accelerometer and magnetometer more
+  /// and converge faster, lower values trust the gyroscope more and are less
+  /// noisy.
+  static constexpr float DEFAULT_BETA = 0.1f;
+
+  void integrate(Vector3 gyro, float s0, float s1, float s2, float s3,
+                 float dt_s);
+
+  float m_beta;
+  Quaternion m_q;
+  bool m_initialized = false;
+};
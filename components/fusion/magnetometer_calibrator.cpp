@@ -0,0 +1,117 @@
+#include "magnetometer_calibrator.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool MagnetometerCalibrator::add_sample(Vector3 raw) {
+  if (m_size > 0) {
+    auto const& last = m_samples[(m_next + CAPACITY - 1) % CAPACITY];
+    if ((raw - last).length_squared() <
+        m_min_sample_distance * m_min_sample_distance)
+      return false;
+  }
+
+  m_samples[m_next] = raw;
+  m_next = (m_next + 1) % CAPACITY;
+  m_size = std::min(m_size + 1, CAPACITY);
+  ++m_generation;
+  return true;
+}
+
+static constexpr size_t PARAMETER_COUNT = 6;
+
+/// Solves `m * x = b` in place using Gaussian elimination with partial
+/// pivoting. The solution is stored in `b`. Returns false if `m` is singular.
+static bool solve(double (&m)[PARAMETER_COUNT][PARAMETER_COUNT],
+                  double (&b)[PARAMETER_COUNT]) {
+  for (size_t col = 0; col < PARAMETER_COUNT; ++col) {
+    auto pivot = col;
+    for (size_t row = col + 1; row < PARAMETER_COUNT; ++row) {
+      if (fabs(m[row][col]) > fabs(m[pivot][col]))
+        pivot = row;
+    }
+    if (fabs(m[pivot][col]) < 1e-12)
+      return false;
+
+    if (pivot != col) {
+      std::swap(m[pivot], m[col]);
+      std::swap(b[pivot], b[col]);
+    }
+
+    for (size_t row = col + 1; row < PARAMETER_COUNT; ++row) {
+      auto factor = m[row][col] / m[col][col];
+      for (size_t i = col; i < PARAMETER_COUNT; ++i)
+        m[row][i] -= factor * m[col][i];
+      b[row] -= factor * b[col];
+    }
+  }
+
+  for (size_t col = PARAMETER_COUNT; col-- > 0;) {
+    for (size_t i = col + 1; i < PARAMETER_COUNT; ++i)
+      b[col] -= m[col][i] * b[i];
+    b[col] /= m[col][col];
+  }
+  return true;
+}
+
+std::optional<MagnetometerCalibration> MagnetometerCalibrator::fit() const {
+  if (m_size < MIN_SAMPLES)
+    return std::nullopt;
+
+  // Accumulate the normal equations. Doubles are slow on the ESP32-S3, but the
+  // fourth powers of the samples lose too much precision as floats and this
+  // isn't running often.
+  double m[PARAMETER_COUNT][PARAMETER_COUNT] = {};
+  double b[PARAMETER_COUNT] = {};
+  Vector3 min(INFINITY);
+  Vector3 max(-INFINITY);
+
+  for (size_t i = 0; i < m_size; ++i) {
+    auto const& s = m_samples[i];
+    double row[PARAMETER_COUNT] = {s.x * s.x, s.y * s.y, s.z * s.z,
+                                   s.x,       s.y,       s.z};
+    for (size_t r = 0; r < PARAMETER_COUNT; ++r) {
+      for (size_t c = 0; c < PARAMETER_COUNT; ++c)
+        m[r][c] += row[r] * row[c];
+      b[r] += row[r];
+    }
+
+    min = Vector3(std::min(min.x, s.x), std::min(min.y, s.y),
+                  std::min(min.z, s.z));
+    max = Vector3(std::max(max.x, s.x), std::max(max.y, s.y),
+                  std::max(max.z, s.z));
+  }
+
+  if (!solve(m, b))
+    return std::nullopt;
+
+  auto [a2, b2, c2, a1, b1, c1] = b;
+  // anything else is not an ellipsoid
+  if (a2 <= 0 || b2 <= 0 || c2 <= 0)
+    return std::nullopt;
+
+  auto center_x = -a1 / (2 * a2);
+  auto center_y = -b1 / (2 * b2);
+  auto center_z = -c1 / (2 * c2);
+  auto g = 1 + a1 * a1 / (4 * a2) + b1 * b1 / (4 * b2) + c1 * c1 / (4 * c2);
+  if (g <= 0)
+    return std::nullopt;
+
+  auto radius_x = sqrt(g / a2);
+  auto radius_y = sqrt(g / b2);
+  auto radius_z = sqrt(g / c2);
+
+  if (max.x - min.x < MIN_COVERAGE * 2 * radius_x ||
+      max.y - min.y < MIN_COVERAGE * 2 * radius_y ||
+      max.z - min.z < MIN_COVERAGE * 2 * radius_z)
+    return std::nullopt;
+
+  // keep the field strength roughly in its original unit by scaling to the
+  // mean radius instead of to 1
+  auto mean_radius = (radius_x + radius_y + radius_z) / 3;
+  return MagnetometerCalibration{
+      .offset = Vector3(-center_x, -center_y, -center_z),
+      .scale = Vector3(mean_radius / radius_x, mean_radius / radius_y,
+                       mean_radius / radius_z),
+  };
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <types.h>
+
+/// Hard- and soft-iron correction for magnetometer measurements.
+struct MagnetometerCalibration {
+  /// Added to the raw measurement to move the center of the measured
+  /// ellipsoid to the origin.
+  Vector3 offset;
+  /// Multiplied with the offset measurement to turn the ellipsoid into a
+  /// sphere.
+  Vector3 scale;
+
+  Vector3 apply(Vector3 raw) const { return (raw + offset) * scale; }
+};
+
+/// Estimates a `MagnetometerCalibration` from raw magnetometer samples.
+///
+/// Samples are collected in a bounded ring buffer. A sample is only accepted
+/// if it is far enough from the previously accepted one, so the buffer covers
+/// as many orientations as possible instead of filling up while the device
+/// isn't moving. `fit()` then fits an axis-aligned ellipsoid
+///
+///   A x^2 + B y^2 + C z^2 + D x + E y + F z = 1
+///
+/// to the buffered samples using linear least squares.
+///
+/// Adding samples is cheap, fitting isn't. The intended use is to add samples
+/// from the sensor task and to fit a copy of the calibrator in a background
+/// task.
+class MagnetometerCalibrator {
+public:
+  static constexpr size_t CAPACITY = 256;
+  /// Minimum number of samples `fit()` needs.
+  static constexpr size_t MIN_SAMPLES = 64;
+  /// How much of an ellipsoid's diameter the samples have to span along every
+  /// axis for a fit to be accepted. Protects against fits from samples that
+  /// only cover a small part of the ellipsoid, e.g. while the device is lying
+  /// flat on a table.
+  static constexpr float MIN_COVERAGE = 0.6f;
+
+  /// `min_sample_distance` is the distance a sample must have to the
+  /// previously accepted one, in the unit of the samples.
+  explicit MagnetometerCalibrator(float min_sample_distance)
+      : m_min_sample_distance(min_sample_distance) {}
+
+  /// Returns whether the sample was accepted.
+  bool add_sample(Vector3 raw);
+
+  size_t size() const { return m_size; }
+  /// Number of samples accepted since creation. Can be used to check if
+  /// anything changed since the last fit.
+  u32 generation() const { return m_generation; }
+
+  std::optional<MagnetometerCalibration> fit() const;
+
+private:
+  float m_min_sample_distance;
+
+  std::array<Vector3, CAPACITY> m_samples{};
+  size_t m_next = 0;
+  size_t m_size = 0;
+  u32 m_generation = 0;
+};
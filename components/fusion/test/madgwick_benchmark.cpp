@@ -0,0 +1,101 @@
+// Measures the time per update of the orientation filter, compared to the
+// heading that was computed directly from the low-pass filtered magnetometer
+// before the filter existed.
+
+#include <array>
+#include <benchmark.h>
+#include <dsp.h>
+#include <madgwick.h>
+#include <random>
+#include <util.h>
+
+namespace {
+
+constexpr float SAMPLE_PERIOD_S = 1.f / 104.f;
+constexpr size_t SAMPLE_COUNT = 1024;
+constexpr long ITERATIONS = 10'000'000;
+
+/// Earth frame: x points to magnetic north, z up
+constexpr Vector3 GRAVITY = Vector3(0, 0, 9.81f);
+constexpr Vector3 FIELD = Vector3(20.f, 0, -45.f);
+
+struct Sample {
+  /// rad/s
+  Vector3 gyro;
+  Vector3 acc;
+  Vector3 mag;
+};
+
+/// A device that tumbles slowly around a tilted axis, measured with noise
+std::array<Sample, SAMPLE_COUNT> tumbling_device() {
+  std::mt19937 random(3);
+  std::normal_distribution<float> normal;
+  auto noise = [&](float stddev) {
+    return Vector3(normal(random), normal(random), normal(random)) * stddev;
+  };
+
+  auto axis = Vector3(0.3f, -0.5f, 1.f).normalized();
+  constexpr float RATE = 0.8f;
+  std::array<Sample, SAMPLE_COUNT> samples;
+  for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+    auto angle = RATE * SAMPLE_PERIOD_S * i;
+    auto s = sinf(angle / 2.f);
+    // rotates from the sensor into the earth frame
+    auto q = Quaternion(cosf(angle / 2.f), axis.x * s, axis.y * s, axis.z * s);
+    auto to_sensor = q.conjugate();
+    samples[i] = {
+        .gyro = axis * RATE + noise(0.01f),
+        .acc = to_sensor.rotate(GRAVITY) + noise(0.05f),
+        .mag = to_sensor.rotate(FIELD) + noise(0.5f),
+    };
+  }
+  return samples;
+}
+
+} // namespace
+
+int main() {
+  using namespace host_benchmark;
+  auto const samples = tumbling_device();
+
+  dsp::OnePole<Vector3> mag_filter(0.25f);
+  size_t i = 0;
+  auto before_ns = ns_per_call(ITERATIONS, [&] {
+    auto mag = mag_filter.process(samples[i++ % SAMPLE_COUNT].mag);
+    auto heading = atan2f(mag.x, mag.z) * RAD_TO_DEG;
+    keep(heading);
+  });
+
+  Madgwick six_axis;
+  six_axis.initialize(samples[0].acc, samples[0].mag);
+  i = 0;
+  auto six_axis_ns = ns_per_call(ITERATIONS, [&] {
+    auto const& sample = samples[i++ % SAMPLE_COUNT];
+    six_axis.update(sample.gyro, sample.acc, SAMPLE_PERIOD_S);
+    keep(six_axis.quaternion());
+  });
+
+  Madgwick nine_axis;
+  nine_axis.initialize(samples[0].acc, samples[0].mag);
+  i = 0;
+  auto nine_axis_ns = ns_per_call(ITERATIONS, [&] {
+    auto const& sample = samples[i++ % SAMPLE_COUNT];
+    nine_axis.update(sample.gyro, sample.acc, sample.mag, SAMPLE_PERIOD_S);
+    keep(nine_axis.quaternion());
+  });
+
+  // as in `Data::update_compass_heading()`
+  auto heading_ns = ns_per_call(ITERATIONS, [&] {
+    auto forward = nine_axis.to_earth_frame(Vector3(0, 1, 0));
+    auto heading = fmodf(atan2f(-forward.y, forward.x) * RAD_TO_DEG + 360.f,
+                         360.f);
+    keep(heading);
+  });
+
+  std::printf("Time per sample:\n");
+  report("low-pass filtered field (before)", before_ns);
+  report("Madgwick, gyro + accelerometer", six_axis_ns, before_ns);
+  report("Madgwick, gyro + accel. + magnetometer", nine_axis_ns, before_ns);
+  report("heading from the orientation", heading_ns, before_ns);
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <magnetometer_calibrator.h>
+#include <random>
+#include <test.h>
+
+namespace {
+
+/// Roughly the earth's field in µT
+constexpr float FIELD_STRENGTH = 50.f;
+constexpr float MIN_SAMPLE_DISTANCE = 5.f;
+
+struct Distortion {
+  Vector3 hard_iron;
+  /// Semi-axes of the measured ellipsoid
+  Vector3 radii;
+
+  Vector3 measure(Vector3 direction) const {
+    return hard_iron + direction * radii;
+  }
+};
+
+constexpr Distortion DISTORTION = {
+    .hard_iron = Vector3(-23.f, 41.f, 12.5f),
+    .radii = Vector3(45.f, 58.f, 50.f),
+};
+
+/// Fills `calibrator` with measurements of a field from evenly spread random
+/// directions. `max_z` limits the directions to a cap of the sphere.
+void add_samples(MagnetometerCalibrator& calibrator,
+                 Distortion const& distortion, float noise,
+                 float max_z = 1.f) {
+  std::mt19937 random(2);
+  std::normal_distribution<float> normal;
+  while (calibrator.size() < MagnetometerCalibrator::CAPACITY) {
+    auto direction =
+        Vector3(normal(random), normal(random), normal(random)).normalized();
+    if (direction.z > max_z)
+      continue;
+    auto measurement =
+        distortion.measure(direction) +
+        Vector3(normal(random), normal(random), normal(random)) * noise;
+    calibrator.add_sample(measurement);
+  }
+}
+
+} // namespace
+
+TEST(recovers_offset_and_scale) {
+  MagnetometerCalibrator calibrator(MIN_SAMPLE_DISTANCE);
+  add_samples(calibrator, DISTORTION, 0.f);
+
+  auto calibration = calibrator.fit();
+  CHECK(calibration.has_value());
+  if (!calibration)
+    return;
+
+  auto mean_radius =
+      (DISTORTION.radii.x + DISTORTION.radii.y + DISTORTION.radii.z) / 3.f;
+  CHECK_NEAR(calibration->offset.x, -DISTORTION.hard_iron.x, 1e-2);
+  CHECK_NEAR(calibration->offset.y, -DISTORTION.hard_iron.y, 1e-2);
+  CHECK_NEAR(calibration->offset.z, -DISTORTION.hard_iron.z, 1e-2);
+  CHECK_NEAR(calibration->scale.x, mean_radius / DISTORTION.radii.x, 1e-4);
+  CHECK_NEAR(calibration->scale.y, mean_radius / DISTORTION.radii.y, 1e-4);
+  CHECK_NEAR(calibration->scale.z, mean_radius / DISTORTION.radii.z, 1e-4);
+}
+
+TEST(calibrated_measurements_lie_on_a_sphere) {
+  MagnetometerCalibrator calibrator(MIN_SAMPLE_DISTANCE);
+  add_samples(calibrator, DISTORTION, 0.5f);
+
+  auto calibration = calibrator.fit();
+  CHECK(calibration.has_value());
+  if (!calibration)
+    return;
+
+  auto mean_radius =
+      (DISTORTION.radii.x + DISTORTION.radii.y + DISTORTION.radii.z) / 3.f;
+  for (auto direction : {Vector3(1, 0, 0), Vector3(0, -1, 0), Vector3(0, 0, 1),
+                         Vector3(1, 1, 1).normalized()}) {
+    auto calibrated = calibration->apply(DISTORTION.measure(direction));
+    CHECK_NEAR(calibrated.length(), mean_radius, 0.02f * mean_radius);
+    auto heading_error = 1.f - calibrated.normalized().dot(direction);
+    CHECK_NEAR(heading_error, 0.f, 1e-3);
+  }
+}
+
+TEST(needs_enough_samples) {
+  MagnetometerCalibrator calibrator(MIN_SAMPLE_DISTANCE);
+  for (size_t i = 0; i < MagnetometerCalibrator::MIN_SAMPLES - 1; ++i) {
+    auto angle = static_cast<float>(i) * 0.4f;
+    calibrator.add_sample(Vector3(cosf(angle), sinf(angle), cosf(angle * 3)) *
+                          FIELD_STRENGTH);
+  }
+  CHECK(!calibrator.fit().has_value());
+}
+
+TEST(rejects_partial_coverage) {
+  MagnetometerCalibrator calibrator(MIN_SAMPLE_DISTANCE);
+  // e.g. lying on a table and only being turned around the z axis
+  add_samples(calibrator, DISTORTION, 0.5f, -0.9f);
+  CHECK(!calibrator.fit().has_value());
+}
+
+TEST(skips_samples_close_to_the_previous_one) {
+  MagnetometerCalibrator calibrator(MIN_SAMPLE_DISTANCE);
+  CHECK(calibrator.add_sample(Vector3(FIELD_STRENGTH, 0, 0)));
+  CHECK(!calibrator.add_sample(
+      Vector3(FIELD_STRENGTH + MIN_SAMPLE_DISTANCE / 2, 0, 0)));
+  CHECK(calibrator.add_sample(Vector3(0, FIELD_STRENGTH, 0)));
+  CHECK(calibrator.size() == 2);
+  CHECK(calibrator.generation() == 2);
+}
@@ -0,0 +1,328 @@
+#include "i2c_bus.h"
+#include <algorithm>
+#include <cstring>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+I2cTransfer::I2cTransfer()
+    : m_done(xSemaphoreCreateBinaryStatic(&m_done_buffer)) {}
+
+I2cTransfer::~I2cTransfer() {
+  wait();
+  vSemaphoreDelete(m_done);
+}
+
+bool I2cTransfer::done() const {
+  return !m_started || uxSemaphoreGetCount(m_done) > 0;
+}
+
+esp_err_t I2cTransfer::wait(TickType_t ticks) {
+  if (!m_started)
+    return m_result;
+  if (xSemaphoreTake(m_done, ticks) != pdTRUE)
+    return ESP_ERR_TIMEOUT;
+  m_started = false;
+  return m_result;
+}
+
+esp_err_t I2cDevice::transmit(u8 const* data, size_t length, u32 timeout_ms) {
+  I2cTransfer transfer;
+  start_transmit(transfer, data, length, timeout_ms);
+  return transfer.wait();
+}
+
+esp_err_t I2cDevice::receive(u8* data, size_t length, u32 timeout_ms) {
+  I2cTransfer transfer;
+  start_receive(transfer, data, length, timeout_ms);
+  return transfer.wait();
+}
+
+esp_err_t I2cDevice::transmit_receive(u8 const* tx_data, size_t tx_length,
+                                      u8* rx_data, size_t rx_length,
+                                      u32 timeout_ms) {
+  I2cTransfer transfer;
+  start_transmit_receive(transfer, tx_data, tx_length, rx_data, rx_length,
+                         timeout_ms);
+  return transfer.wait();
+}
+
+esp_err_t I2cDevice::start_transmit(I2cTransfer& transfer, u8 const* data,
+                                    size_t length, u32 timeout_ms,
+                                    I2cTransfer::Callback callback,
+                                    void* context) {
+  return start_transmit_receive(transfer, data, length, nullptr, 0,
+                                timeout_ms, callback, context);
+}
+
+esp_err_t I2cDevice::start_receive(I2cTransfer& transfer, u8* data,
+                                   size_t length, u32 timeout_ms,
+                                   I2cTransfer::Callback callback,
+                                   void* context) {
+  return start_transmit_receive(transfer, nullptr, 0, data, length,
+                                timeout_ms, callback, context);
+}
+
+esp_err_t I2cDevice::start_transmit_receive(
+    I2cTransfer& transfer, u8 const* tx_data, size_t tx_length, u8* rx_data,
+    size_t rx_length, u32 timeout_ms, I2cTransfer::Callback callback,
+    void* context) {
+  if (!transfer.done())
+    return ESP_ERR_INVALID_STATE;
+  // consume the previous completion
+  transfer.wait();
+
+  transfer.m_device = this;
+  transfer.m_tx_data = tx_data;
+  transfer.m_tx_length = tx_length;
+  transfer.m_rx_data = rx_data;
+  transfer.m_rx_length = rx_length;
+  transfer.m_timeout_ms = timeout_ms;
+  transfer.m_callback = callback;
+  transfer.m_context = context;
+  transfer.m_started = true;
+  m_bus->submit(transfer);
+  return ESP_OK;
+}
+
+I2cBus::I2cBus(i2c_master_bus_handle_t handle, char const* name,
+               UBaseType_t task_priority)
+    : m_handle(handle),
+      m_name(name),
+      m_queue(xQueueCreate(QUEUE_LENGTH, sizeof(I2cTransfer*))),
+      m_created_us(esp_timer_get_time()) {
+  xTaskCreate(arbiter_task, name, TASK_STACK_SIZE, this, task_priority, NULL);
+}
+
+I2cDevice* I2cBus::add_device(u16 address, u32 scl_speed_hz, char const* name,
+                              I2cPriority priority,
+                              I2cReadMerging read_merging) {
+  i2c_device_config_t config = {
+      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+      .device_address = address,
+      .scl_speed_hz = scl_speed_hz,
+  };
+  i2c_master_dev_handle_t handle;
+  ESP_ERROR_CHECK(i2c_master_bus_add_device(m_handle, &config, &handle));
+
+  I2cDevice* device = nullptr;
+  taskENTER_CRITICAL(&m_devices_lock);
+  if (m_device_count < MAX_DEVICES)
+    device = &m_devices[m_device_count++];
+  taskEXIT_CRITICAL(&m_devices_lock);
+  ESP_ERROR_CHECK(device ? ESP_OK : ESP_ERR_NO_MEM);
+
+  device->m_bus = this;
+  device->m_handle = handle;
+  device->m_name = name;
+  device->m_priority = priority;
+  device->m_read_merging = read_merging;
+  return device;
+}
+
+void I2cBus::log_statistics() const {
+  auto now = esp_timer_get_time();
+  ESP_LOGI(m_name, "up %lld s, %lu bus resets", (now - m_created_us) / 1000000,
+           m_bus_resets);
+
+  for (size_t i = 0; i < m_device_count; ++i) {
+    auto const& device = m_devices[i];
+    auto const& s = device.statistics();
+
+    // one column per latency bucket
+    char histogram[s.latency_histogram.size() * 11 + 1];
+    size_t length = 0;
+    for (auto count : s.latency_histogram) {
+      length += snprintf(histogram + length, sizeof(histogram) - length,
+                         " %lu", count);
+    }
+
+    ESP_LOGI(m_name,
+             "%s: %lu transactions, %lu merged, max %lu us, latency:%s, "
+             "errors: %lu timeout, %lu deadline, %lu unavailable, %lu other "
+             "(last: %s), %lu recoveries, unavailable for %lld ms%s",
+             device.name(), s.transactions, s.merged, s.max_latency_us,
+             histogram, s.error_histogram[0], s.error_histogram[1],
+             s.error_histogram[2], s.error_histogram[3],
+             esp_err_to_name(s.last_error), s.recoveries,
+             s.unavailable_us / 1000,
+             device.available() ? "" : " (currently unavailable)");
+  }
+}
+
+void I2cBus::submit(I2cTransfer& transfer) {
+  transfer.m_submitted_us = esp_timer_get_time();
+  transfer.m_deadline_us =
+      transfer.m_submitted_us + transfer.m_timeout_ms * 1000ll;
+
+  auto* t = &transfer;
+  xQueueSend(m_queue, &t, portMAX_DELAY);
+}
+
+void I2cBus::arbiter_task(void* arg) {
+  auto& bus = *static_cast<I2cBus*>(arg);
+
+  while (true) {
+    I2cTransfer* transfer;
+    if (bus.m_pending_count == 0) {
+      xQueueReceive(bus.m_queue, &transfer, portMAX_DELAY);
+      bus.m_pending[bus.m_pending_count++] = transfer;
+    }
+    // collect everything that was submitted in the meantime, so priorities
+    // can be taken into account
+    while (bus.m_pending_count < bus.m_pending.size() &&
+           xQueueReceive(bus.m_queue, &transfer, 0) == pdTRUE) {
+      bus.m_pending[bus.m_pending_count++] = transfer;
+    }
+
+    bus.run(*bus.take_next_pending());
+  }
+}
+
+I2cTransfer* I2cBus::take_next_pending() {
+  size_t next = 0;
+  for (size_t i = 1; i < m_pending_count; ++i) {
+    auto const& a = *m_pending[i];
+    auto const& b = *m_pending[next];
+    if (a.m_device->m_priority > b.m_device->m_priority ||
+        (a.m_device->m_priority == b.m_device->m_priority &&
+         a.m_deadline_us < b.m_deadline_us)) {
+      next = i;
+    }
+  }
+
+  auto* transfer = m_pending[next];
+  m_pending[next] = m_pending[--m_pending_count];
+  return transfer;
+}
+
+void I2cDevice::record_result(esp_err_t result, i64 now_us) {
+  if (result == ESP_OK) {
+    if (m_consecutive_failures >= FAILURES_BEFORE_BACKOFF) {
+      ESP_LOGI("I2C", "%s is available again", m_name);
+      ++m_statistics.recoveries;
+      m_statistics.unavailable_us += now_us - m_unavailable_since_us;
+      m_available.store(true, std::memory_order_relaxed);
+      m_reinitialization_requested.store(true, std::memory_order_relaxed);
+    }
+    m_consecutive_failures = 0;
+    return;
+  }
+
+  if (++m_consecutive_failures < FAILURES_BEFORE_BACKOFF)
+    return;
+  if (m_consecutive_failures == FAILURES_BEFORE_BACKOFF) {
+    m_unavailable_since_us = now_us;
+    m_backoff_ms = MIN_BACKOFF_MS;
+    m_available.store(false, std::memory_order_relaxed);
+  } else {
+    // a probe after the backoff failed
+    m_backoff_ms = std::min(m_backoff_ms * 2, MAX_BACKOFF_MS);
+  }
+  m_backoff_until_us = now_us + m_backoff_ms * 1000ll;
+  ESP_LOGW("I2C", "%s is unavailable (%s), retrying in %lu ms", m_name,
+           esp_err_to_name(result), m_backoff_ms);
+}
+
+void I2cBus::run(I2cTransfer& t) {
+  using Error = I2cDevice::Statistics::Error;
+  auto now = esp_timer_get_time();
+  if (now > t.m_deadline_us) {
+    complete(t, ESP_ERR_TIMEOUT, Error::DeadlineMissed);
+    return;
+  }
+  if (t.m_device->backing_off(now)) {
+    complete(t, ESP_ERR_INVALID_STATE, Error::Unavailable);
+    return;
+  }
+
+  auto result = execute(t);
+  t.m_device->record_result(result, esp_timer_get_time());
+  recover_if_necessary(result);
+
+  // a plain receive returns the response to a preceding command, so only
+  // register reads can be shared
+  if (result == ESP_OK &&
+      t.m_device->m_read_merging == I2cReadMerging::IdenticalReads &&
+      t.m_tx_length > 0 && t.m_rx_length > 0) {
+    complete_identical_reads(t);
+  }
+  complete(t, result);
+}
+
+esp_err_t I2cBus::execute(I2cTransfer& t) {
+  auto handle = t.m_device->m_handle;
+  if (t.m_rx_length == 0) {
+    return i2c_master_transmit(handle, t.m_tx_data, t.m_tx_length,
+                               t.m_timeout_ms);
+  }
+  if (t.m_tx_length == 0) {
+    return i2c_master_receive(handle, t.m_rx_data, t.m_rx_length,
+                              t.m_timeout_ms);
+  }
+  return i2c_master_transmit_receive(handle, t.m_tx_data, t.m_tx_length,
+                                     t.m_rx_data, t.m_rx_length,
+                                     t.m_timeout_ms);
+}
+
+void I2cBus::recover_if_necessary(esp_err_t result) {
+  // only timeouts point to a stuck bus, a missing acknowledge is the device's
+  // problem
+  if (result != ESP_ERR_TIMEOUT) {
+    m_consecutive_timeouts = 0;
+    return;
+  }
+  if (++m_consecutive_timeouts < TIMEOUTS_BEFORE_BUS_RESET)
+    return;
+
+  m_consecutive_timeouts = 0;
+  ++m_bus_resets;
+  ESP_LOGW(m_name, "Bus keeps timing out, resetting it");
+  ESP_ERROR_CHECK_WITHOUT_ABORT(i2c_master_bus_reset(m_handle));
+}
+
+void I2cBus::complete(I2cTransfer& t, esp_err_t result,
+                      std::optional<I2cDevice::Statistics::Error> error) {
+  auto& s = t.m_device->m_statistics;
+  ++s.transactions;
+
+  auto latency_us = static_cast<u32>(esp_timer_get_time() - t.m_submitted_us);
+  size_t bucket = 0;
+  while (bucket < s.LATENCY_BUCKET_LIMITS_US.size() &&
+         latency_us > s.LATENCY_BUCKET_LIMITS_US[bucket]) {
+    ++bucket;
+  }
+  ++s.latency_histogram[bucket];
+  s.max_latency_us = std::max(s.max_latency_us, latency_us);
+
+  if (result != ESP_OK) {
+    using Error = I2cDevice::Statistics::Error;
+    if (!error)
+      error = result == ESP_ERR_TIMEOUT ? Error::Timeout : Error::Other;
+    ++s.error_histogram[static_cast<size_t>(*error)];
+    s.last_error = result;
+  }
+
+  t.m_result = result;
+  if (t.m_callback)
+    t.m_callback(t, t.m_context);
+  // the owner may destroy the transfer right after this, so it must be the
+  // last access
+  xSemaphoreGive(t.m_done);
+}
+
+void I2cBus::complete_identical_reads(I2cTransfer const& t) {
+  for (size_t i = 0; i < m_pending_count;) {
+    auto& other = *m_pending[i];
+    if (other.m_device != t.m_device || other.m_tx_length != t.m_tx_length ||
+        other.m_rx_length != t.m_rx_length ||
+        memcmp(other.m_tx_data, t.m_tx_data, t.m_tx_length) != 0) {
+      ++i;
+      continue;
+    }
+
+    memcpy(other.m_rx_data, t.m_rx_data, t.m_rx_length);
+    ++other.m_device->m_statistics.merged;
+    m_pending[i] = m_pending[--m_pending_count];
+    complete(other, ESP_OK);
+  }
+}
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <driver/i2c_master.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <optional>
+#include <types.h>
+
+class I2cBus;
+class I2cDevice;
+
+/// Order in which pending transactions of different devices are executed.
+enum class I2cPriority : u8 {
+  /// Bulk transfers that may be delayed, e.g. NFC memory writes
+  Low,
+  Normal,
+  /// Devices with tight timing requirements, e.g. IMUs read at high rates
+  High,
+};
+
+/// Whether pending register reads of a device can share a transaction.
+enum class I2cReadMerging : u8 {
+  /// Every read is executed. Required if reading a register can have side
+  /// effects, e.g. popping a FIFO or clearing latched interrupt flags.
+  Disabled,
+  /// Register reads with the same register and length that are pending at
+  /// the same time are executed only once.
+  IdenticalReads,
+};
+
+/// A transaction that is executed asynchronously by an `I2cBus`' arbiter
+/// task, started by one of `I2cDevice`'s `start_*` functions. The buffers
+/// passed when starting it and the transfer itself must stay alive until it
+/// has completed. A transfer can be reused once it has completed.
+class I2cTransfer {
+public:
+  /// Called from the arbiter task once the transfer has completed. Must not
+  /// block, which includes starting synchronous transfers.
+  using Callback = void (*)(I2cTransfer& transfer, void* context);
+
+  I2cTransfer();
+  /// Waits for the transfer to complete if it is still in flight.
+  ~I2cTransfer();
+
+  I2cTransfer(I2cTransfer const&) = delete;
+  I2cTransfer& operator=(I2cTransfer const&) = delete;
+
+  /// Whether the transfer is idle, i.e. it has completed or was never started.
+  bool done() const;
+
+  /// Blocks until the transfer has completed and returns its result, or
+  /// `ESP_ERR_TIMEOUT` if it is still in flight after `ticks`. Returns the
+  /// last result if the transfer is not in flight.
+  esp_err_t wait(TickType_t ticks = portMAX_DELAY);
+
+  /// Result of the last completed transfer.
+  esp_err_t result() const { return m_result; }
+
+private:
+  friend class I2cBus;
+  friend class I2cDevice;
+
+  I2cDevice* m_device = nullptr;
+  u8 const* m_tx_data = nullptr;
+  size_t m_tx_length = 0;
+  u8* m_rx_data = nullptr;
+  size_t m_rx_length = 0;
+  u32 m_timeout_ms = 0;
+  i64 m_submitted_us = 0;
+  i64 m_deadline_us = 0;
+  Callback m_callback = nullptr;
+  void* m_context = nullptr;
+
+  esp_err_t m_result = ESP_OK;
+  /// Whether the transfer was started and its completion hasn't been taken
+  /// from `m_done` yet. Only accessed by the task owning the transfer, the
+  /// arbiter doesn't touch the transfer anymore once it gave `m_done`.
+  bool m_started = false;
+  StaticSemaphore_t m_done_buffer;
+  SemaphoreHandle_t m_done;
+};
+
+/// A device on an `I2cBus`.
+///
+/// The blocking functions have the same semantics as the corresponding
+/// `i2c_master_*` functions. The `start_*` functions queue the transaction
+/// and return immediately, so a task can have transfers to several devices
+/// in flight and do other work in the meantime. They only block if the
+/// bus' queue is full, and return `ESP_ERR_INVALID_STATE` if `transfer` is
+/// still in flight.
+///
+/// After `FAILURES_BEFORE_BACKOFF` consecutive failures, a device is
+/// considered unavailable: its transfers fail with `ESP_ERR_INVALID_STATE`
+/// without touching the bus, so a missing or hung device doesn't stall
+/// everything else. Once the backoff has elapsed, the next transfer probes the
+/// device, doubling the backoff on failure. After the device responds again,
+/// `take_reinitialization_request()` tells its driver to restore any
+/// configuration it may have lost.
+class I2cDevice {
+public:
+  /// Per-device counters, only written by the arbiter task.
+  struct Statistics {
+    /// Upper bounds of the latency histogram buckets, the last bucket holds
+    /// everything above.
+    static constexpr std::array<u32, 7> LATENCY_BUCKET_LIMITS_US = {
+        250, 500, 1000, 2000, 5000, 10000, 50000,
+    };
+
+    enum class Error : u8 {
+      /// The driver timed out, e.g. because the device stretched the clock
+      Timeout,
+      /// The transaction was still queued at its deadline and never executed
+      DeadlineMissed,
+      /// The device was backing off after repeated failures, so the
+      /// transaction was never executed
+      Unavailable,
+      /// Anything else, e.g. a missing acknowledge
+      Other,
+    };
+
+    u32 transactions = 0;
+    /// Reads that were served by an identical read of another task (see
+    /// `I2cReadMerging`)
+    u32 merged = 0;
+    /// Time from submission to completion, including the time spent waiting
+    /// for the bus.
+    std::array<u32, LATENCY_BUCKET_LIMITS_US.size() + 1> latency_histogram{};
+    u32 max_latency_us = 0;
+    std::array<u32, 4> error_histogram{};
+    esp_err_t last_error = ESP_OK;
+    /// How often the device became unavailable and responded again
+    u32 recoveries = 0;
+    /// Total time the device was unavailable, excluding the current outage
+    i64 unavailable_us = 0;
+  };
+
+  static constexpr u32 FAILURES_BEFORE_BACKOFF = 3;
+  static constexpr u32 MIN_BACKOFF_MS = 100;
+  static constexpr u32 MAX_BACKOFF_MS = 30 * 1000;
+
+  esp_err_t transmit(u8 const* data, size_t length, u32 timeout_ms);
+  esp_err_t receive(u8* data, size_t length, u32 timeout_ms);
+  esp_err_t transmit_receive(u8 const* tx_data, size_t tx_length, u8* rx_data,
+                             size_t rx_length, u32 timeout_ms);
+
+  esp_err_t start_transmit(I2cTransfer& transfer, u8 const* data,
+                           size_t length, u32 timeout_ms,
+                           I2cTransfer::Callback callback = nullptr,
+                           void* context = nullptr);
+  esp_err_t start_receive(I2cTransfer& transfer, u8* data, size_t length,
+                          u32 timeout_ms,
+                          I2cTransfer::Callback callback = nullptr,
+                          void* context = nullptr);
+  esp_err_t start_transmit_receive(I2cTransfer& transfer, u8 const* tx_data,
+                                   size_t tx_length, u8* rx_data,
+                                   size_t rx_length, u32 timeout_ms,
+                                   I2cTransfer::Callback callback = nullptr,
+                                   void* context = nullptr);
+
+  char const* name() const { return m_name; }
+  I2cPriority priority() const { return m_priority; }
+  Statistics const& statistics() const { return m_statistics; }
+
+  /// Whether the device responds, i.e. it isn't backing off.
+  bool available() const {
+    return m_available.load(std::memory_order_relaxed);
+  }
+  /// Returns true once after the device became available again. The driver
+  /// should then e.g. rewrite its configuration registers, as the device may
+  /// have been reset by the fault.
+  bool take_reinitialization_request() {
+    return m_reinitialization_requested.exchange(false,
+                                                 std::memory_order_relaxed);
+  }
+
+private:
+  friend class I2cBus;
+
+  /// Whether transfers are currently rejected without touching the bus.
+  bool backing_off(i64 now_us) const {
+    return m_consecutive_failures >= FAILURES_BEFORE_BACKOFF &&
+           now_us < m_backoff_until_us;
+  }
+  /// Updates the backoff state with the result of an executed transfer.
+  void record_result(esp_err_t result, i64 now_us);
+
+  I2cBus* m_bus = nullptr;
+  i2c_master_dev_handle_t m_handle = nullptr;
+  char const* m_name = nullptr;
+  I2cPriority m_priority = I2cPriority::Normal;
+  I2cReadMerging m_read_merging = I2cReadMerging::Disabled;
+  Statistics m_statistics;
+
+  // only written by the arbiter task
+  u32 m_consecutive_failures = 0;
+  u32 m_backoff_ms = 0;
+  i64 m_backoff_until_us = 0;
+  i64 m_unavailable_since_us = 0;
+  std::atomic<bool> m_available = true;
+  std::atomic<bool> m_reinitialization_requested = false;
+};
+
+/// Owns an I2C master bus shared by several devices.
+///
+/// Drivers don't access the bus directly, but submit transactions that are
+/// executed one after another by an arbiter task. The arbiter uses the
+/// driver's blocking functions, as its asynchronous mode is still
+/// experimental in ESP-IDF 5.4; callers are asynchronous nonetheless (see
+/// `I2cTransfer`). When several transactions
+/// are pending, the one with the highest device priority is executed first,
+/// and among those the one with the earliest deadline. This keeps e.g. a
+/// long running NFC write from delaying the IMU reads by more than one
+/// transaction.
+///
+/// A transaction's deadline is its submission time plus its timeout. If it
+/// is still queued at that point, it fails with `ESP_ERR_TIMEOUT` without
+/// touching the bus. Devices can opt into sharing identical register reads
+/// (see `I2cReadMerging`).
+///
+/// A device holding SDA low (e.g. after a brownout in the middle of a read)
+/// makes every transaction on the bus time out. After
+/// `TIMEOUTS_BEFORE_BUS_RESET` consecutive timeouts, the arbiter clocks SCL
+/// until the line is released.
+class I2cBus {
+public:
+  static constexpr size_t MAX_DEVICES = 8;
+  static constexpr u32 TIMEOUTS_BEFORE_BUS_RESET = 2;
+
+  I2cBus(i2c_master_bus_handle_t handle, char const* name,
+         UBaseType_t task_priority);
+
+  I2cDevice* add_device(u16 address, u32 scl_speed_hz, char const* name,
+                        I2cPriority priority = I2cPriority::Normal,
+                        I2cReadMerging read_merging = I2cReadMerging::Disabled);
+
+  /// Logs the bus' and every device's statistics.
+  void log_statistics() const;
+
+private:
+  friend class I2cDevice;
+
+  static constexpr size_t QUEUE_LENGTH = 16;
+  static constexpr u32 TASK_STACK_SIZE = 3 * 1024;
+
+  void submit(I2cTransfer& transfer);
+
+  static void arbiter_task(void* arg);
+  /// Removes and returns the pending transfer that should run next.
+  I2cTransfer* take_next_pending();
+  void run(I2cTransfer& transfer);
+  /// Executes the transfer on the bus and returns the driver's result.
+  esp_err_t execute(I2cTransfer& transfer);
+  /// Resets the bus after repeated timeouts.
+  void recover_if_necessary(esp_err_t result);
+  /// `error` classifies failures that didn't come from the driver.
+  void complete(I2cTransfer& transfer, esp_err_t result,
+                std::optional<I2cDevice::Statistics::Error> error = {});
+  /// Completes all pending reads that are identical to `transfer`, which has
+  /// just been executed successfully.
+  void complete_identical_reads(I2cTransfer const& transfer);
+
+  i2c_master_bus_handle_t const m_handle;
+  char const* const m_name;
+  QueueHandle_t m_queue;
+  i64 const m_created_us;
+
+  portMUX_TYPE m_devices_lock = portMUX_INITIALIZER_UNLOCKED;
+  std::array<I2cDevice, MAX_DEVICES> m_devices{};
+  size_t m_device_count = 0;
+
+  // only accessed from the arbiter task
+  std::array<I2cTransfer*, QUEUE_LENGTH> m_pending{};
+  size_t m_pending_count = 0;
+  u32 m_consecutive_timeouts = 0;
+  u32 m_bus_resets = 0;
+};
@@ -0,0 +1,345 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <i2c_bus.h>
+#include <mutex>
+#include <test.h>
+#include <vector>
+
+/// Simulated device behind a handle from `i2c_master_bus_add_device()`
+struct i2c_master_dev_t {
+  i2c_master_bus_t* bus;
+  u16 address;
+  /// Returned by every transaction on the device
+  esp_err_t result = ESP_OK;
+};
+
+/// Simulated bus. The transaction on the bus can be held, so others pile up
+/// in the arbiter's queue in the meantime.
+struct i2c_master_bus_t {
+  struct Transaction {
+    u16 address;
+    /// First byte sent, i.e. the register or command
+    u8 command;
+  };
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool held = false;
+  bool executing = false;
+  std::vector<Transaction> executed;
+  u32 resets = 0;
+  std::vector<i2c_master_dev_t*> devices;
+
+  /// Executes the transaction on `device`. Responses consist of the number of
+  /// the transaction on the bus followed by the command, so shared responses
+  /// can be told apart from repeated ones.
+  esp_err_t execute(i2c_master_dev_t& device, u8 const* tx_data,
+                    size_t tx_length, u8* rx_data, size_t rx_length) {
+    std::unique_lock lock(mutex);
+    executing = true;
+    changed.notify_all();
+    changed.wait(lock, [&] { return !held; });
+    executing = false;
+
+    auto command = tx_length > 0 ? tx_data[0] : u8(0);
+    executed.push_back({device.address, command});
+    for (size_t i = 0; i < rx_length; ++i)
+      rx_data[i] = i == 0 ? static_cast<u8>(executed.size()) : command;
+    return device.result;
+  }
+
+  /// Number of executed transactions to `address` with `command`
+  size_t executed_count(u16 address, u8 command) {
+    std::lock_guard lock(mutex);
+    size_t count = 0;
+    for (auto const& t : executed)
+      count += t.address == address && t.command == command;
+    return count;
+  }
+};
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus,
+                                    i2c_device_config_t const* config,
+                                    i2c_master_dev_handle_t* handle) {
+  *handle = new i2c_master_dev_t{.bus = bus, .address = config->device_address};
+  bus->devices.push_back(*handle);
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus) {
+  std::lock_guard lock(bus->mutex);
+  ++bus->resets;
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t device,
+                              uint8_t const* data, size_t length, int) {
+  return device->bus->execute(*device, data, length, nullptr, 0);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t device, uint8_t* data,
+                             size_t length, int) {
+  return device->bus->execute(*device, nullptr, 0, data, length);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t device,
+                                      uint8_t const* tx_data,
+                                      size_t tx_length, uint8_t* rx_data,
+                                      size_t rx_length, int) {
+  return device->bus->execute(*device, tx_data, tx_length, rx_data,
+                              rx_length);
+}
+
+namespace {
+
+std::atomic<i64> g_now_us = 0;
+
+constexpr u32 TIMEOUT_MS = 50;
+
+using Error = I2cDevice::Statistics::Error;
+
+/// A bus with its arbiter task. Buses are never destroyed, as their arbiter
+/// task runs forever.
+struct TestBus {
+  i2c_master_bus_t* fake = new i2c_master_bus_t();
+  I2cBus* bus = new I2cBus(fake, "test", 1);
+
+  I2cDevice* add_device(u16 address,
+                        I2cPriority priority = I2cPriority::Normal,
+                        I2cReadMerging merging = I2cReadMerging::Disabled) {
+    return bus->add_device(address, 400000, "device", priority, merging);
+  }
+
+  /// Starts `transfer` on `device` and blocks the bus with it until
+  /// `release()`, so transfers started in the meantime are pending together.
+  void hold(I2cDevice& device, I2cTransfer& transfer) {
+    {
+      std::lock_guard lock(fake->mutex);
+      fake->held = true;
+    }
+    static u8 const command = 0xFF;
+    device.start_transmit(transfer, &command, 1, TIMEOUT_MS);
+    std::unique_lock lock(fake->mutex);
+    fake->changed.wait(lock, [&] { return fake->executing; });
+  }
+
+  void release() {
+    std::lock_guard lock(fake->mutex);
+    fake->held = false;
+    fake->changed.notify_all();
+  }
+
+  std::vector<i2c_master_bus_t::Transaction> executed() {
+    std::lock_guard lock(fake->mutex);
+    return fake->executed;
+  }
+};
+
+struct CallbackRecord {
+  u32 calls = 0;
+  esp_err_t result = ESP_FAIL;
+};
+
+void record_callback(I2cTransfer& transfer, void* context) {
+  auto& record = *static_cast<CallbackRecord*>(context);
+  ++record.calls;
+  record.result = transfer.result();
+}
+
+} // namespace
+
+int64_t esp_timer_get_time() { return g_now_us; }
+
+TEST(pending_transfers_run_by_priority_then_deadline) {
+  TestBus test;
+  auto* low = test.add_device(0x10, I2cPriority::Low);
+  auto* normal = test.add_device(0x11, I2cPriority::Normal);
+  auto* high = test.add_device(0x12, I2cPriority::High);
+
+  I2cTransfer blocker, t1, t2, t3, t4;
+  test.hold(*normal, blocker);
+  u8 const commands[] = {1, 2, 3, 4};
+  low->start_transmit(t1, &commands[0], 1, TIMEOUT_MS);
+  normal->start_transmit(t2, &commands[1], 1, TIMEOUT_MS);
+  high->start_transmit(t3, &commands[2], 1, TIMEOUT_MS);
+  // same priority as t2, but due earlier
+  normal->start_transmit(t4, &commands[3], 1, TIMEOUT_MS / 2);
+  test.release();
+
+  for (auto* t : {&blocker, &t1, &t2, &t3, &t4})
+    CHECK(t->wait() == ESP_OK);
+
+  auto executed = test.executed();
+  CHECK(executed.size() == 5);
+  if (executed.size() == 5) {
+    CHECK(executed[1].address == 0x12 && executed[1].command == 3);
+    CHECK(executed[2].address == 0x11 && executed[2].command == 4);
+    CHECK(executed[3].address == 0x11 && executed[3].command == 2);
+    CHECK(executed[4].address == 0x10 && executed[4].command == 1);
+  }
+}
+
+TEST(transfers_still_queued_at_their_deadline_fail) {
+  TestBus test;
+  auto* device = test.add_device(0x10);
+
+  I2cTransfer blocker, late, in_time;
+  test.hold(*device, blocker);
+  u8 const late_command = 1, in_time_command = 2;
+  CallbackRecord record;
+  device->start_transmit(late, &late_command, 1, 5, record_callback, &record);
+  device->start_transmit(in_time, &in_time_command, 1, 20);
+  g_now_us += 10 * 1000;
+  test.release();
+
+  CHECK(blocker.wait() == ESP_OK);
+  CHECK(late.wait() == ESP_ERR_TIMEOUT);
+  CHECK(in_time.wait() == ESP_OK);
+  CHECK(record.calls == 1 && record.result == ESP_ERR_TIMEOUT);
+  CHECK(test.fake->executed_count(0x10, 1) == 0);
+  CHECK(test.fake->executed_count(0x10, 2) == 1);
+
+  auto const& s = device->statistics();
+  CHECK(s.transactions == 3);
+  CHECK(s.error_histogram[static_cast<size_t>(Error::DeadlineMissed)] == 1);
+  CHECK(s.last_error == ESP_ERR_TIMEOUT);
+}
+
+TEST(completion_callbacks_run_before_wait_returns) {
+  TestBus test;
+  auto* device = test.add_device(0x10);
+
+  u8 const command = 7;
+  u8 response[3] = {};
+  CallbackRecord record;
+  I2cTransfer transfer;
+  CHECK(transfer.done());
+  CHECK(device->start_transmit_receive(transfer, &command, 1, response,
+                                       sizeof(response), TIMEOUT_MS,
+                                       record_callback, &record) == ESP_OK);
+  CHECK(transfer.wait() == ESP_OK);
+  CHECK(transfer.done());
+  CHECK(record.calls == 1 && record.result == ESP_OK);
+  CHECK(response[0] == 1 && response[1] == 7 && response[2] == 7);
+
+  // a completed transfer can be reused
+  CHECK(device->start_transmit(transfer, &command, 1, TIMEOUT_MS,
+                               record_callback, &record) == ESP_OK);
+  CHECK(transfer.wait() == ESP_OK);
+  CHECK(record.calls == 2);
+}
+
+TEST(transfers_in_flight_cant_be_restarted) {
+  TestBus test;
+  auto* device = test.add_device(0x10);
+
+  I2cTransfer transfer;
+  test.hold(*device, transfer);
+  CHECK(!transfer.done());
+  u8 const command = 1;
+  CHECK(device->start_transmit(transfer, &command, 1, TIMEOUT_MS) ==
+        ESP_ERR_INVALID_STATE);
+  test.release();
+  CHECK(transfer.wait() == ESP_OK);
+  CHECK(test.executed().size() == 1);
+}
+
+TEST(identical_reads_are_only_merged_on_devices_that_opt_in) {
+  TestBus test;
+  auto* blocking = test.add_device(0x10);
+  auto* merging = test.add_device(0x11, I2cPriority::Normal,
+                                  I2cReadMerging::IdenticalReads);
+  auto* plain = test.add_device(0x12);
+
+  I2cTransfer blocker;
+  test.hold(*blocking, blocker);
+
+  u8 const reg = 0x20, other_reg = 0x21;
+  u8 merged_a[2], merged_b[2], other[2], received_a[2], received_b[2];
+  u8 plain_a[2], plain_b[2];
+  I2cTransfer t[7];
+  merging->start_transmit_receive(t[0], &reg, 1, merged_a, 2, TIMEOUT_MS);
+  merging->start_transmit_receive(t[1], &reg, 1, merged_b, 2, TIMEOUT_MS);
+  merging->start_transmit_receive(t[2], &other_reg, 1, other, 2, TIMEOUT_MS);
+  // plain receives return the response to a previous command
+  merging->start_receive(t[3], received_a, 2, TIMEOUT_MS);
+  merging->start_receive(t[4], received_b, 2, TIMEOUT_MS);
+  plain->start_transmit_receive(t[5], &reg, 1, plain_a, 2, TIMEOUT_MS);
+  plain->start_transmit_receive(t[6], &reg, 1, plain_b, 2, TIMEOUT_MS);
+  test.release();
+
+  CHECK(blocker.wait() == ESP_OK);
+  for (auto& transfer : t)
+    CHECK(transfer.wait() == ESP_OK);
+
+  CHECK(test.fake->executed_count(0x11, reg) == 1);
+  CHECK(test.fake->executed_count(0x11, other_reg) == 1);
+  CHECK(test.fake->executed_count(0x11, 0) == 2);
+  CHECK(test.fake->executed_count(0x12, reg) == 2);
+  CHECK(memcmp(merged_a, merged_b, 2) == 0);
+  CHECK(merged_a[1] == reg && other[1] == other_reg);
+  CHECK(received_a[0] != received_b[0]);
+  CHECK(plain_a[0] != plain_b[0]);
+  CHECK(merging->statistics().merged == 1);
+  CHECK(merging->statistics().transactions == 5);
+  CHECK(plain->statistics().merged == 0);
+}
+
+TEST(failing_devices_back_off_and_recover) {
+  TestBus test;
+  auto* device = test.add_device(0x10);
+  auto* handle = test.fake->devices.back();
+  handle->result = ESP_FAIL;
+  u8 const command = 1;
+  auto transmit = [&] { return device->transmit(&command, 1, TIMEOUT_MS); };
+
+  auto start_us = g_now_us.load();
+  for (u32 i = 0; i < I2cDevice::FAILURES_BEFORE_BACKOFF; ++i) {
+    CHECK(device->available());
+    CHECK(transmit() == ESP_FAIL);
+  }
+  CHECK(!device->available());
+  CHECK(test.fake->executed_count(0x10, command) == 3);
+
+  // rejected without touching the bus until the backoff has elapsed
+  CHECK(transmit() == ESP_ERR_INVALID_STATE);
+  g_now_us += (I2cDevice::MIN_BACKOFF_MS - 1) * 1000;
+  CHECK(transmit() == ESP_ERR_INVALID_STATE);
+  CHECK(test.fake->executed_count(0x10, command) == 3);
+  auto const& s = device->statistics();
+  CHECK(s.error_histogram[static_cast<size_t>(Error::Unavailable)] == 2);
+
+  // a failed probe doubles the backoff
+  g_now_us += 1000;
+  CHECK(transmit() == ESP_FAIL);
+  CHECK(test.fake->executed_count(0x10, command) == 4);
+  g_now_us += (2 * I2cDevice::MIN_BACKOFF_MS - 1) * 1000;
+  CHECK(transmit() == ESP_ERR_INVALID_STATE);
+  CHECK(!device->take_reinitialization_request());
+
+  g_now_us += 1000;
+  handle->result = ESP_OK;
+  CHECK(transmit() == ESP_OK);
+  CHECK(device->available());
+  CHECK(device->take_reinitialization_request());
+  CHECK(!device->take_reinitialization_request());
+  CHECK(s.recoveries == 1);
+  CHECK(s.unavailable_us == g_now_us - start_us);
+  CHECK(s.last_error == ESP_ERR_INVALID_STATE);
+}
+
+TEST(bus_is_reset_after_repeated_timeouts) {
+  TestBus test;
+  auto* device = test.add_device(0x10);
+  test.fake->devices.back()->result = ESP_ERR_TIMEOUT;
+  u8 const command = 1;
+
+  for (u32 i = 0; i < I2cBus::TIMEOUTS_BEFORE_BUS_RESET - 1; ++i)
+    CHECK(device->transmit(&command, 1, TIMEOUT_MS) == ESP_ERR_TIMEOUT);
+  CHECK(test.fake->resets == 0);
+  CHECK(device->transmit(&command, 1, TIMEOUT_MS) == ESP_ERR_TIMEOUT);
+  CHECK(test.fake->resets == 1);
+  CHECK(device->statistics()
+            .error_histogram[static_cast<size_t>(Error::Timeout)] == 2);
+}
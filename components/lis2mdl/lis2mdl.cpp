@@ -1,5 +1,6 @@
 #include "lis2mdl.h"
 #include <cstring>
+#include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 
 /// Platform dependent functions for ST drivers
@@ -11,16 +12,16 @@ int32_t Lis2mdl::platform_write(void* handle, uint8_t reg, uint8_t const* bufp,
   buf[0] = reg;
   memcpy(&buf[1], bufp, len);
   auto res = ESP_ERROR_CHECK_WITHOUT_ABORT(
-      i2c_master_transmit(static_cast<i2c_master_dev_handle_t>(handle), buf, 2,
-                          Lis2mdl::I2C_TIMEOUT_MS));
+      static_cast<I2cDevice*>(handle)->transmit(buf, sizeof(buf),
+                                                Lis2mdl::I2C_TIMEOUT_MS));
   return res == ESP_OK ? 0 : 1;
 }
 
 int32_t Lis2mdl::platform_read(void* handle, uint8_t reg, uint8_t* bufp,
                                uint16_t len) {
   auto res = ESP_ERROR_CHECK_WITHOUT_ABORT(
-      i2c_master_transmit_receive(static_cast<i2c_master_dev_handle_t>(handle),
-                                  &reg, 1, bufp, len, Lis2mdl::I2C_TIMEOUT_MS));
+      static_cast<I2cDevice*>(handle)->transmit_receive(
+          &reg, 1, bufp, len, Lis2mdl::I2C_TIMEOUT_MS));
   return res == ESP_OK ? 0 : 1;
 }
 
@@ -28,44 +29,105 @@ void Lis2mdl::platform_delay(uint32_t millisec) {
   vTaskDelay(pdMS_TO_TICKS(millisec));
 }
 
-Lis2mdl::Lis2mdl(i2c_master_bus_handle_t i2c_handle, u16 address) {
-  i2c_device_config_t dev = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = address,
-      .scl_speed_hz = 400000,
-  };
-  i2c_master_dev_handle_t dev_handle;
-  ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_handle, &dev, &dev_handle));
-
+Lis2mdl::Lis2mdl(I2cBus& bus, u16 address) {
   m_device.write_reg = platform_write;
   m_device.read_reg = platform_read;
   m_device.mdelay = platform_delay;
-  m_device.handle = dev_handle;
+  m_device.handle =
+      bus.add_device(address, 400000, "LIS2MDL", I2cPriority::High);
+
+  initialize();
+}
+
+bool Lis2mdl::reinitialize_if_requested() {
+  if (!static_cast<I2cDevice*>(m_device.handle)
+           ->take_reinitialization_request()) {
+    return false;
+  }
+  ESP_LOGW("LIS2MDL", "Sensor recovered, restoring configuration");
+  initialize();
+  return true;
+}
 
+void Lis2mdl::initialize() {
   platform_delay(10);
 
   lis2mdl_reset_set(&m_device, PROPERTY_ENABLE);
   platform_delay(10);
 
-  lis2mdl_block_data_update_set(&m_device, PROPERTY_ENABLE);
-  lis2mdl_set_rst_mode_set(&m_device, LIS2MDL_SENS_OFF_CANC_EVERY_ODR);
-  lis2mdl_operating_mode_set(&m_device, LIS2MDL_CONTINUOUS_MODE);
-  lis2mdl_offset_temp_comp_set(&m_device, PROPERTY_ENABLE);
-  set_data_rate(DataRate::Rate100Hz);
+  // CFG_REG_A to CFG_REG_C are written in one transaction. They were just
+  // reset, so all bits that aren't set here are at their defaults.
+  lis2mdl_cfg_reg_a_t cfg_reg_a{};
+  cfg_reg_a.md = LIS2MDL_CONTINUOUS_MODE;
+  cfg_reg_a.odr = static_cast<u8>(m_data_rate);
+  cfg_reg_a.comp_temp_en = PROPERTY_ENABLE;
+  lis2mdl_cfg_reg_b_t cfg_reg_b{};
+  cfg_reg_b.set_rst = LIS2MDL_SENS_OFF_CANC_EVERY_ODR;
+  lis2mdl_cfg_reg_c_t cfg_reg_c{};
+  cfg_reg_c.bdu = PROPERTY_ENABLE;
+
+  u8 config[3];
+  memcpy(&config[0], &cfg_reg_a, 1);
+  memcpy(&config[1], &cfg_reg_b, 1);
+  memcpy(&config[2], &cfg_reg_c, 1);
+  write_registers(LIS2MDL_CFG_REG_A, config, sizeof(config));
+}
+
+bool Lis2mdl::write_registers(u8 first_register, u8 const* values,
+                              size_t count) {
+  return lis2mdl_write_reg(&m_device, first_register, const_cast<u8*>(values),
+                           count) == 0;
 }
 
 void Lis2mdl::set_data_rate(DataRate rate) {
   lis2mdl_data_rate_set(&m_device, static_cast<lis2mdl_odr_t>(rate));
+  m_data_rate = rate;
+}
+
+void Lis2mdl::set_data_ready_on_pin(bool enable) {
+  lis2mdl_drdy_on_pin_set(&m_device,
+                          enable ? PROPERTY_ENABLE : PROPERTY_DISABLE);
 }
 
-std::optional<Lis2mdl::Data> Lis2mdl::read_sensor() {
-  u8 mag_ready;
-  lis2mdl_mag_data_ready_get(&m_device, &mag_ready);
-  if (!mag_ready)
+std::optional<Lis2mdl::Data> Lis2mdl::read_sensor(bool check_data_ready) {
+  if (check_data_ready) {
+    u8 mag_ready;
+    lis2mdl_mag_data_ready_get(&m_device, &mag_ready);
+    if (!mag_ready)
+      return std::nullopt;
+  }
+
+  i16 raw[3];
+  if (lis2mdl_magnetic_raw_get(&m_device, raw) != 0)
+    return std::nullopt;
+  return convert(raw);
+}
+
+void Lis2mdl::start_read_sensor() {
+  static constexpr u8 OUTPUT_REGISTER = LIS2MDL_OUTX_L_REG;
+  auto* device = static_cast<I2cDevice*>(m_device.handle);
+  m_read_started =
+      ESP_ERROR_CHECK_WITHOUT_ABORT(device->start_transmit_receive(
+          m_transfer, &OUTPUT_REGISTER, 1, m_raw, sizeof(m_raw),
+          I2C_TIMEOUT_MS)) == ESP_OK;
+}
+
+std::optional<Lis2mdl::Data> Lis2mdl::finish_read_sensor() {
+  if (!m_read_started)
+    return std::nullopt;
+  m_read_started = false;
+  if (ESP_ERROR_CHECK_WITHOUT_ABORT(m_transfer.wait()) != ESP_OK)
     return std::nullopt;
 
   i16 raw[3];
-  lis2mdl_magnetic_raw_get(&m_device, raw);
+  for (size_t axis = 0; axis < 3; ++axis) {
+    raw[axis] =
+        static_cast<i16>(m_raw[axis * 2] | (m_raw[axis * 2 + 1] << 8));
+  }
+  return convert(raw);
+}
+
+Lis2mdl::Data Lis2mdl::convert(i16 const* raw) {
   return Data{
       .x = lis2mdl_from_lsb_to_mgauss(raw[0]) / 1000.f,
       .y = lis2mdl_from_lsb_to_mgauss(raw[1]) / 1000.f,
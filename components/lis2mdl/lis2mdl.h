@@ -1,7 +1,7 @@
 #pragma once
 
 #include "lis2mdl_pid/lis2mdl_reg.h"
-#include <driver/i2c_master.h>
+#include <i2c_bus.h>
 #include <types.h>
 
 class Lis2mdl {
@@ -27,14 +27,49 @@ public:
                                uint16_t len);
   static void platform_delay(uint32_t millisec);
 
-  Lis2mdl(i2c_master_bus_handle_t i2c_handle, u16 address = DEFAULT_ADDRESS);
+  Lis2mdl(I2cBus& bus, u16 address = DEFAULT_ADDRESS);
+
+  /// Returns true once after the device recovered from a bus fault (see
+  /// `I2cDevice::take_reinitialization_request()`), after resetting it and
+  /// restoring the configuration of the constructor and the data rate. The
+  /// caller then has to restore everything else it configured, e.g. the
+  /// data-ready signal.
+  bool reinitialize_if_requested();
 
   void set_data_rate(DataRate rate);
+  /// Writes `count` consecutive registers starting at `first_register` in a
+  /// single transaction, relying on the address auto-increment. Returns false
+  /// on a bus error.
+  bool write_registers(u8 first_register, u8 const* values, size_t count);
+  /// Drives the data-ready signal on the INT/DRDY pin. It is high while new
+  /// data is available and cleared by reading the output registers.
+  void set_data_ready_on_pin(bool enable);
 
-  std::optional<Data> read_sensor();
+  /// Reads the latest measurement. If `check_data_ready` is false, the caller
+  /// is responsible for knowing new data is available (e.g. from the DRDY
+  /// pin), which saves reading the status register.
+  std::optional<Data> read_sensor(bool check_data_ready = true);
+  /// Starts reading the latest measurement in the background, without
+  /// checking whether new data is available. The result is collected with
+  /// `finish_read_sensor()`, so the caller can e.g. read another sensor in the
+  /// meantime.
+  void start_read_sensor();
+  /// Waits for the read started by `start_read_sensor()` and returns its
+  /// result, or `std::nullopt` on a bus error or if no read was started.
+  std::optional<Data> finish_read_sensor();
 
   void power_down();
 
 private:
+  /// Resets the device and configures continuous mode at `m_data_rate`.
+  void initialize();
+  static Data convert(i16 const* raw);
+
   stmdev_ctx_t m_device;
+  DataRate m_data_rate = DataRate::Rate100Hz;
+
+  I2cTransfer m_transfer;
+  bool m_read_started = false;
+  /// OUTX_L_REG to OUTZ_H_REG
+  u8 m_raw[6];
 };
@@ -2,6 +2,7 @@
 #include <cstring>
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
+#include <sys/param.h>
 #include <util.h>
 
 /// Platform dependent functions for ST drivers
@@ -12,42 +13,65 @@ i32 platform_write(void* handle, u8 reg, u8 const* bufp, uint16_t len) {
   buf[0] = reg;
   memcpy(&buf[1], bufp, len);
   auto res = ESP_ERROR_CHECK_WITHOUT_ABORT(
-      i2c_master_transmit(static_cast<i2c_master_dev_handle_t>(handle), buf, 2,
-                          Lsm6dsox::I2C_TIMEOUT_MS));
+      static_cast<I2cDevice*>(handle)->transmit(buf, sizeof(buf),
+                                                Lsm6dsox::I2C_TIMEOUT_MS));
   return res == ESP_OK ? 0 : 1;
 }
 
 i32 platform_read(void* handle, u8 reg, u8* bufp, u16 len) {
-  auto res = ESP_ERROR_CHECK_WITHOUT_ABORT(i2c_master_transmit_receive(
-      static_cast<i2c_master_dev_handle_t>(handle), &reg, 1, bufp, len,
-      Lsm6dsox::I2C_TIMEOUT_MS));
+  auto res = ESP_ERROR_CHECK_WITHOUT_ABORT(
+      static_cast<I2cDevice*>(handle)->transmit_receive(
+          &reg, 1, bufp, len, Lsm6dsox::I2C_TIMEOUT_MS));
   return res == ESP_OK ? 0 : 1;
 }
 
 void platform_delay(uint32_t millisec) { vTaskDelay(pdMS_TO_TICKS(millisec)); }
 
-Lsm6dsox::Lsm6dsox(i2c_master_bus_handle_t i2c_handle, u16 address) {
-  i2c_device_config_t dev = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = address,
-      .scl_speed_hz = 400000,
-  };
-  i2c_master_dev_handle_t dev_handle;
-  ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_handle, &dev, &dev_handle));
-
+Lsm6dsox::Lsm6dsox(I2cBus& bus, u16 address) {
   m_device.write_reg = platform_write;
   m_device.read_reg = platform_read;
   m_device.mdelay = platform_delay;
-  m_device.handle = dev_handle;
+  m_device.handle =
+      bus.add_device(address, 400000, "LSM6DSOX", I2cPriority::High);
 
   // wait sensor boot time
   platform_delay(10);
 
-  set_accelerometer_data_rate(DataRate::Rate104Hz);
-  set_accelerometer_range(AccelerometerRange::Range4g);
+  initialize();
+}
+
+bool Lsm6dsox::reinitialize_if_requested() {
+  if (!static_cast<I2cDevice*>(m_device.handle)
+           ->take_reinitialization_request()) {
+    return false;
+  }
+  ESP_LOGW("LSM6DSOX", "Sensor recovered, restoring configuration");
+  initialize();
+  return true;
+}
+
+void Lsm6dsox::initialize() {
+  update_registers<2>(LSM6DSOX_CTRL1_XL, [this](u8* values) {
+    lsm6dsox_ctrl1_xl_t ctrl1_xl;
+    lsm6dsox_ctrl2_g_t ctrl2_g;
+    memcpy(&ctrl1_xl, &values[0], 1);
+    memcpy(&ctrl2_g, &values[1], 1);
+    ctrl1_xl.odr_xl = static_cast<u8>(DataRate::Rate104Hz);
+    ctrl1_xl.fs_xl = static_cast<u8>(m_accel_range);
+    ctrl2_g.odr_g = static_cast<u8>(DataRate::Rate104Hz);
+    ctrl2_g.fs_g = static_cast<u8>(m_gyro_range);
+    memcpy(&values[0], &ctrl1_xl, 1);
+    memcpy(&values[1], &ctrl2_g, 1);
+  });
+  m_accel_scale =
+      accelerometer_sensitivity(m_accel_range) / 1000.f * GRAVITY_STANDARD;
+  m_rot_scale = gyroscope_sensitivity(m_gyro_range) / 1000.f;
+}
 
-  set_gyroscope_data_rate(DataRate::Rate104Hz);
-  set_gyroscope_range(GyroscopeRange::Range2000dps);
+bool Lsm6dsox::write_registers(u8 first_register, u8 const* values,
+                               size_t count) const {
+  return lsm6dsox_write_reg(&m_device, first_register,
+                            const_cast<u8*>(values), count) == 0;
 }
 
 void Lsm6dsox::set_accelerometer_data_rate(DataRate rate) const {
@@ -56,6 +80,8 @@ void Lsm6dsox::set_accelerometer_data_rate(DataRate rate) const {
 
 void Lsm6dsox::set_accelerometer_range(AccelerometerRange range) {
   lsm6dsox_xl_full_scale_set(&m_device, static_cast<lsm6dsox_fs_xl_t>(range));
+  m_accel_range = range;
+  m_accel_scale = accelerometer_sensitivity(range) / 1000.f * GRAVITY_STANDARD;
 }
 
 void Lsm6dsox::set_gyroscope_data_rate(DataRate rate) const {
@@ -64,88 +90,273 @@ void Lsm6dsox::set_gyroscope_data_rate(DataRate rate) const {
 
 void Lsm6dsox::set_gyroscope_range(GyroscopeRange range) {
   lsm6dsox_gy_full_scale_set(&m_device, static_cast<lsm6dsox_fs_g_t>(range));
+  m_gyro_range = range;
+  m_rot_scale = gyroscope_sensitivity(range) / 1000.f;
+}
+
+void Lsm6dsox::set_data_rates(DataRate accel_rate, DataRate gyro_rate,
+                              PowerMode power_mode) {
+  static_assert(LSM6DSOX_CTRL7_G - LSM6DSOX_CTRL1_XL == 6);
+  // The high-performance mode disable bits are in CTRL6_C and CTRL7_G, so
+  // CTRL3_C to CTRL5_C are written back unchanged.
+  update_registers<7>(LSM6DSOX_CTRL1_XL, [&](u8* values) {
+    lsm6dsox_ctrl1_xl_t ctrl1_xl;
+    lsm6dsox_ctrl2_g_t ctrl2_g;
+    lsm6dsox_ctrl6_c_t ctrl6_c;
+    lsm6dsox_ctrl7_g_t ctrl7_g;
+    memcpy(&ctrl1_xl, &values[0], 1);
+    memcpy(&ctrl2_g, &values[1], 1);
+    memcpy(&ctrl6_c, &values[5], 1);
+    memcpy(&ctrl7_g, &values[6], 1);
+    ctrl1_xl.odr_xl = static_cast<u8>(accel_rate);
+    ctrl2_g.odr_g = static_cast<u8>(gyro_rate);
+    auto low_power = power_mode == PowerMode::LowPower;
+    ctrl6_c.xl_hm_mode = low_power;
+    ctrl7_g.g_hm_mode = low_power;
+    memcpy(&values[0], &ctrl1_xl, 1);
+    memcpy(&values[1], &ctrl2_g, 1);
+    memcpy(&values[5], &ctrl6_c, 1);
+    memcpy(&values[6], &ctrl7_g, 1);
+  });
+}
+
+void Lsm6dsox::convert(i16 const* raw_accel, i16 const* raw_rot,
+                       Data& result) const {
+  result.acc_x = raw_accel[0] * m_accel_scale;
+  result.acc_y = raw_accel[1] * m_accel_scale;
+  result.acc_z = raw_accel[2] * m_accel_scale;
+  result.pitch = raw_rot[0] * m_rot_scale;
+  result.roll = raw_rot[1] * m_rot_scale;
+  result.yaw = raw_rot[2] * m_rot_scale;
 }
 
 std::optional<Lsm6dsox::Data> Lsm6dsox::read_sensor() const {
-  lsm6dsox_all_sources_t all_sources;
-  lsm6dsox_all_sources_get(&m_device, &all_sources);
-
-  u8 xl_ready;
-  lsm6dsox_xl_flag_data_ready_get(&m_device, &xl_ready);
-  u8 gy_ready;
-  lsm6dsox_gy_flag_data_ready_get(&m_device, &gy_ready);
-  if (!xl_ready || !gy_ready) {
+  // read STATUS_REG together with the gyroscope and accelerometer output
+  // registers in a single transaction
+  u8 buf[OUTPUT_BLOCK_SIZE];
+  if (lsm6dsox_read_reg(&m_device, LSM6DSOX_STATUS_REG, buf, sizeof(buf)) != 0)
+    return std::nullopt;
+
+  lsm6dsox_status_reg_t status;
+  memcpy(&status, &buf[0], 1);
+  if (!status.xlda || !status.gda) {
     ESP_LOGW("LSM", "Accelerometer or gyroscope not ready");
     return std::nullopt;
   }
 
+  auto raw_at = [&buf](u8 reg) {
+    auto i = reg - LSM6DSOX_STATUS_REG;
+    return static_cast<i16>(buf[i] | (buf[i + 1] << 8));
+  };
+
+  i16 raw_rot[3] = {raw_at(LSM6DSOX_OUTX_L_G), raw_at(LSM6DSOX_OUTY_L_G),
+                    raw_at(LSM6DSOX_OUTZ_L_G)};
+  i16 raw_accel[3] = {raw_at(LSM6DSOX_OUTX_L_A), raw_at(LSM6DSOX_OUTY_L_A),
+                      raw_at(LSM6DSOX_OUTZ_L_A)};
+
   Data result;
+  convert(raw_accel, raw_rot, result);
+  return result;
+}
 
-  // accelerometer readout
-  {
-    lsm6dsox_fs_xl_t xl_range;
-    lsm6dsox_xl_full_scale_get(&m_device, &xl_range);
+void Lsm6dsox::enable_fifo(DataRate rate, u16 watermark) {
+  // FIFO_CTRL1 to FIFO_CTRL4 hold the watermark, the batch data rates and the
+  // mode
+  lsm6dsox_fifo_ctrl4_t ctrl4;
+  auto configured = update_registers<4>(LSM6DSOX_FIFO_CTRL1, [&](u8* values) {
+    lsm6dsox_fifo_ctrl2_t ctrl2;
+    lsm6dsox_fifo_ctrl3_t ctrl3;
+    memcpy(&ctrl2, &values[1], 1);
+    memcpy(&ctrl3, &values[2], 1);
+    memcpy(&ctrl4, &values[3], 1);
+    values[0] = watermark & 0xFF;
+    ctrl2.wtm = (watermark >> 8) & 0x01;
+    // the batch data rate register values are the same as the ODR ones
+    ctrl3.bdr_xl = static_cast<u8>(rate);
+    ctrl3.bdr_gy = static_cast<u8>(rate);
+    // bypass mode empties the FIFO
+    ctrl4.fifo_mode = LSM6DSOX_BYPASS_MODE;
+    memcpy(&values[1], &ctrl2, 1);
+    memcpy(&values[2], &ctrl3, 1);
+    memcpy(&values[3], &ctrl4, 1);
+  });
+  m_fifo_has_accel = m_fifo_has_rot = false;
+  if (!configured)
+    return;
 
-    i16 raw_accel[3] = {0};
-    lsm6dsox_acceleration_raw_get(&m_device, raw_accel);
+  ctrl4.fifo_mode = LSM6DSOX_STREAM_MODE;
+  u8 value;
+  memcpy(&value, &ctrl4, 1);
+  write_registers(LSM6DSOX_FIFO_CTRL4, &value, 1);
+}
 
-    float (*xl_conv)(i16);
-    switch (static_cast<AccelerometerRange>(xl_range)) {
-    case AccelerometerRange::Range16g:
-      xl_conv = lsm6dsox_from_fs16_to_mg;
-      break;
-    case AccelerometerRange::Range8g:
-      xl_conv = lsm6dsox_from_fs8_to_mg;
+void Lsm6dsox::disable_fifo() {
+  update_registers<2>(LSM6DSOX_FIFO_CTRL3, [](u8* values) {
+    lsm6dsox_fifo_ctrl3_t ctrl3;
+    lsm6dsox_fifo_ctrl4_t ctrl4;
+    memcpy(&ctrl3, &values[0], 1);
+    memcpy(&ctrl4, &values[1], 1);
+    ctrl3.bdr_xl = LSM6DSOX_XL_NOT_BATCHED;
+    ctrl3.bdr_gy = LSM6DSOX_GY_NOT_BATCHED;
+    ctrl4.fifo_mode = LSM6DSOX_BYPASS_MODE;
+    memcpy(&values[0], &ctrl3, 1);
+    memcpy(&values[1], &ctrl4, 1);
+  });
+  m_fifo_has_accel = m_fifo_has_rot = false;
+}
+
+void Lsm6dsox::set_fifo_watermark_interrupt(bool enable) {
+  lsm6dsox_pin_int1_route_t route;
+  lsm6dsox_pin_int1_route_get(&m_device, &route);
+  route.fifo_th = enable ? PROPERTY_ENABLE : PROPERTY_DISABLE;
+  lsm6dsox_pin_int1_route_set(&m_device, route);
+}
+
+std::optional<size_t> Lsm6dsox::read_fifo(Data* samples, size_t max_samples) {
+  // FIFO_STATUS1 and FIFO_STATUS2 hold the number of unread words
+  u8 status[2];
+  if (lsm6dsox_read_reg(&m_device, LSM6DSOX_FIFO_STATUS1, status, 2) != 0)
+    return std::nullopt;
+
+  lsm6dsox_fifo_status2_t status2;
+  memcpy(&status2, &status[1], 1);
+  if (status2.fifo_ovr_ia)
+    ESP_LOGW("LSM", "FIFO overrun, samples were lost");
+
+  size_t words = status[0] | ((status[1] & 0x03) << 8);
+  words = MIN(words, max_samples * 2);
+  if (words == 0)
+    return 0;
+
+  auto* device = static_cast<I2cDevice*>(m_device.handle);
+  static constexpr u8 FIFO_DATA_REGISTER = LSM6DSOX_FIFO_DATA_OUT_TAG;
+  // the next burst is read while the previous one is decoded, so the bus
+  // transfer overlaps with the conversion
+  u8 buffers[2][FIFO_MAX_BURST_WORDS * FIFO_WORD_SIZE];
+  I2cTransfer transfers[2];
+  size_t burst_words[2] = {};
+
+  auto start_burst = [&](size_t index) {
+    burst_words[index] = MIN(words, FIFO_MAX_BURST_WORDS);
+    words -= burst_words[index];
+    // the address automatically wraps around from FIFO_DATA_OUT_Z_H to
+    // FIFO_DATA_OUT_TAG, so multiple words can be read in one transaction
+    device->start_transmit_receive(transfers[index], &FIFO_DATA_REGISTER, 1,
+                                   buffers[index],
+                                   burst_words[index] * FIFO_WORD_SIZE,
+                                   I2C_TIMEOUT_MS);
+  };
+
+  size_t sample_count = 0;
+  size_t current = 0;
+  start_burst(current);
+  while (true) {
+    auto res = ESP_ERROR_CHECK_WITHOUT_ABORT(transfers[current].wait());
+    if (res != ESP_OK)
+      return std::nullopt;
+
+    auto has_next = words > 0;
+    if (has_next)
+      start_burst(1 - current);
+
+    decode_fifo_words(buffers[current], burst_words[current], samples,
+                      max_samples, sample_count);
+    if (!has_next)
       break;
-    case AccelerometerRange::Range4g:
-      xl_conv = lsm6dsox_from_fs4_to_mg;
+    current = 1 - current;
+  }
+
+  return sample_count;
+}
+
+void Lsm6dsox::decode_fifo_words(u8 const* words, size_t count, Data* samples,
+                                 size_t max_samples, size_t& sample_count) {
+  for (size_t i = 0; i < count; ++i) {
+    u8 const* word = &words[i * FIFO_WORD_SIZE];
+    i16* raw;
+    switch (static_cast<lsm6dsox_fifo_tag_t>(word[0] >> 3)) {
+    case LSM6DSOX_XL_NC_TAG:
+      raw = m_fifo_raw_accel;
+      m_fifo_has_accel = true;
       break;
-    case AccelerometerRange::Range2g:
-      xl_conv = lsm6dsox_from_fs2_to_mg;
+    case LSM6DSOX_GYRO_NC_TAG:
+      raw = m_fifo_raw_rot;
+      m_fifo_has_rot = true;
       break;
     default:
-      xl_conv = lsm6dsox_from_fs2_to_mg;
-      break;
+      continue;
     }
 
-    result.acc_x = xl_conv(raw_accel[0]) / 1000.f * GRAVITY_STANDARD;
-    result.acc_y = xl_conv(raw_accel[1]) / 1000.f * GRAVITY_STANDARD;
-    result.acc_z = xl_conv(raw_accel[2]) / 1000.f * GRAVITY_STANDARD;
-  }
+    for (size_t axis = 0; axis < 3; ++axis) {
+      raw[axis] =
+          static_cast<i16>(word[1 + axis * 2] | (word[2 + axis * 2] << 8));
+    }
 
-  // gyroscope readout
-  {
-    lsm6dsox_fs_g_t gy_range;
-    lsm6dsox_gy_full_scale_get(&m_device, &gy_range);
+    if (!m_fifo_has_accel || !m_fifo_has_rot || sample_count >= max_samples)
+      continue;
+    m_fifo_has_accel = m_fifo_has_rot = false;
 
-    i16 raw_rot[3] = {0};
-    lsm6dsox_angular_rate_raw_get(&m_device, raw_rot);
+    convert(m_fifo_raw_accel, m_fifo_raw_rot, samples[sample_count++]);
+  }
+}
 
-    float (*gy_conv)(i16);
-    switch (static_cast<GyroscopeRange>(gy_range)) {
-    case GyroscopeRange::Range2000dps:
-      gy_conv = lsm6dsox_from_fs2000_to_mdps;
-      break;
-    case GyroscopeRange::Range1000dps:
-      gy_conv = lsm6dsox_from_fs1000_to_mdps;
-      break;
-    case GyroscopeRange::Range500dps:
-      gy_conv = lsm6dsox_from_fs500_to_mdps;
-      break;
-    case GyroscopeRange::Range250dps:
-      gy_conv = lsm6dsox_from_fs250_to_mdps;
-      break;
-    default:
-      gy_conv = lsm6dsox_from_fs250_to_mdps;
-      break;
+bool Lsm6dsox::load_ucf(UcfLine const* lines, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    if (lsm6dsox_write_reg(&m_device, lines[i].address,
+                           const_cast<u8*>(&lines[i].data), 1) != 0) {
+      ESP_LOGE("LSM", "Failed writing UCF line %u", i);
+      return false;
     }
+  }
+  return true;
+}
 
-    result.pitch = gy_conv(raw_rot[0]) / 1000.f;
-    result.roll = gy_conv(raw_rot[1]) / 1000.f;
-    result.yaw = gy_conv(raw_rot[2]) / 1000.f;
+void Lsm6dsox::enable_single_tap(Axis axis, u8 threshold) {
+  lsm6dsox_tap_detection_on_x_set(&m_device, axis == Axis::X);
+  lsm6dsox_tap_detection_on_y_set(&m_device, axis == Axis::Y);
+  lsm6dsox_tap_detection_on_z_set(&m_device, axis == Axis::Z);
+
+  switch (axis) {
+  case Axis::X:
+    lsm6dsox_tap_threshold_x_set(&m_device, threshold);
+    break;
+  case Axis::Y:
+    lsm6dsox_tap_threshold_y_set(&m_device, threshold);
+    break;
+  case Axis::Z:
+    lsm6dsox_tap_threshold_z_set(&m_device, threshold);
+    break;
   }
 
-  return result;
+  // shortest shock and quiet windows, so setting the device down only results
+  // in a single event
+  lsm6dsox_tap_shock_set(&m_device, 0x02);
+  lsm6dsox_tap_quiet_set(&m_device, 0x01);
+  lsm6dsox_tap_mode_set(&m_device, LSM6DSOX_ONLY_SINGLE);
+  lsm6dsox_int_notification_set(&m_device, LSM6DSOX_BASE_LATCHED_EMB_PULSED);
+}
+
+void Lsm6dsox::disable_single_tap() {
+  set_single_tap_interrupt(false);
+  lsm6dsox_tap_detection_on_x_set(&m_device, PROPERTY_DISABLE);
+  lsm6dsox_tap_detection_on_y_set(&m_device, PROPERTY_DISABLE);
+  lsm6dsox_tap_detection_on_z_set(&m_device, PROPERTY_DISABLE);
+}
+
+void Lsm6dsox::set_single_tap_interrupt(bool enable) {
+  lsm6dsox_pin_int2_route_t route;
+  lsm6dsox_pin_int2_route_get(&m_device, NULL, &route);
+  route.single_tap = enable ? PROPERTY_ENABLE : PROPERTY_DISABLE;
+  lsm6dsox_pin_int2_route_set(&m_device, NULL, route);
+}
+
+bool Lsm6dsox::single_tap_detected() const {
+  lsm6dsox_tap_src_t tap_src;
+  if (lsm6dsox_read_reg(&m_device, LSM6DSOX_TAP_SRC,
+                        reinterpret_cast<u8*>(&tap_src), 1) != 0) {
+    return false;
+  }
+  return tap_src.single_tap;
 }
 
 void Lsm6dsox::reset() const {
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "lsm6dsox_pid/lsm6dsox_reg.h"
-#include <driver/i2c_master.h>
+#include <i2c_bus.h>
 #include <types.h>
 
 class Lsm6dsox {
@@ -10,6 +10,8 @@ public:
   static constexpr u16 DEFAULT_ADDRESS = 0x6A;
   static constexpr u16 ALTERNATIVE_ADDRESS = 0x6B;
 
+  /// The modes listed for the rates apply with `PowerMode::LowPower`. With
+  /// `PowerMode::HighPerformance`, every rate uses high-performance mode.
   enum class DataRate : u8 {
     Off = LSM6DSOX_XL_ODR_OFF,
     /// Low-power mody only
@@ -36,6 +38,13 @@ public:
     Rate6667kHz = LSM6DSOX_XL_ODR_6667Hz,
   };
 
+  enum class PowerMode : u8 {
+    HighPerformance,
+    /// Low-power or normal mode, depending on the data rate. Trades noise for
+    /// current consumption.
+    LowPower,
+  };
+
   /// Range in `g`
   enum class AccelerometerRange : u8 {
     Range2g = LSM6DSOX_2g,
@@ -52,6 +61,16 @@ public:
     Range2000dps = LSM6DSOX_2000dps,
   };
 
+  enum class Axis : u8 { X, Y, Z };
+
+  /// A single register write of a configuration generated by ST's tools
+  /// (e.g. a finite state machine or machine learning core program). Matches
+  /// the layout of the `.ucf`/`.h` files they export.
+  struct UcfLine {
+    u8 address;
+    u8 data;
+  };
+
   /// Accelerometer readings in m/s^2
   ///
   /// Gyroscope readings in °/s
@@ -64,7 +83,14 @@ public:
     float roll;
   };
 
-  Lsm6dsox(i2c_master_bus_handle_t i2c_handle, u16 address = DEFAULT_ADDRESS);
+  Lsm6dsox(I2cBus& bus, u16 address = DEFAULT_ADDRESS);
+
+  /// Returns true once after the device recovered from a bus fault (see
+  /// `I2cDevice::take_reinitialization_request()`), after restoring the
+  /// configuration of the constructor and the ranges. The caller then has to
+  /// restore everything else it configured, e.g. the data rates, the FIFO and
+  /// the interrupts.
+  bool reinitialize_if_requested();
 
   void set_accelerometer_data_rate(DataRate rate) const;
   void set_accelerometer_range(AccelerometerRange range);
@@ -72,13 +98,133 @@ public:
   void set_gyroscope_data_rate(DataRate rate) const;
   void set_gyroscope_range(GyroscopeRange range);
 
+  /// Sets both data rates and the power mode of both sensors with a single
+  /// read and write of CTRL1_XL to CTRL7_G. Unlike the individual setters,
+  /// this doesn't raise the rates to what a loaded FSM/MLC program requires.
+  void set_data_rates(DataRate accel_rate, DataRate gyro_rate,
+                      PowerMode power_mode = PowerMode::HighPerformance);
+
+  /// Writes `count` consecutive registers starting at `first_register` in a
+  /// single transaction, relying on the address auto-increment (CTRL3_C
+  /// IF_INC, enabled by default). Returns false on a bus error.
+  bool write_registers(u8 first_register, u8 const* values,
+                       size_t count) const;
+
   std::optional<Data> read_sensor() const;
 
+  /// Starts batching accelerometer and gyroscope samples at `rate` into the
+  /// FIFO (stream mode). `watermark` is the FIFO level in words at which the
+  /// watermark flag is raised. Every sample occupies two words (one for the
+  /// accelerometer and one for the gyroscope). Samples that are still in the
+  /// FIFO are discarded, so after changing the rate, every sample read was
+  /// taken at the new one.
+  void enable_fifo(DataRate rate, u16 watermark);
+  /// Stops batching and empties the FIFO.
+  void disable_fifo();
+  /// Routes the FIFO watermark flag to the INT1 pin. The pin stays high while
+  /// the FIFO level is at or above the watermark.
+  void set_fifo_watermark_interrupt(bool enable);
+  /// Reads all samples currently in the FIFO into `samples`, oldest first, and
+  /// returns how many were read, or `std::nullopt` on a bus error. A sample is
+  /// only returned once both its accelerometer and gyroscope words were read.
+  std::optional<size_t> read_fifo(Data* samples, size_t max_samples);
+
+  /// Writes an FSM/MLC configuration to the device. The configuration is
+  /// expected to contain its own interrupt routing. Returns false on a bus
+  /// error.
+  bool load_ucf(UcfLine const* lines, size_t count);
+
+  /// Enables single tap recognition on `axis`. `threshold` is in units of
+  /// full scale / 32 (5 bits). The interrupt is latched until the tap source
+  /// is read through `single_tap_detected()`.
+  void enable_single_tap(Axis axis, u8 threshold);
+  void disable_single_tap();
+  /// Routes single tap events to the INT2 pin.
+  void set_single_tap_interrupt(bool enable);
+  /// Returns whether a single tap was detected since the last call. This also
+  /// clears the latched interrupt.
+  bool single_tap_detected() const;
+
   void reset() const;
 
 private:
   /// Earth's gravity in m/s^2 (i.e. 1g)
   static constexpr float GRAVITY_STANDARD = 9.80665f;
 
+  /// Size of a single FIFO word (tag + 3 axes)
+  static constexpr size_t FIFO_WORD_SIZE = 7;
+  /// Maximum number of FIFO words read in a single burst
+  static constexpr size_t FIFO_MAX_BURST_WORDS = 24;
+
+  /// Registers from STATUS_REG up to OUTZ_H_A, which are read in one burst
+  static constexpr size_t OUTPUT_BLOCK_SIZE =
+      LSM6DSOX_OUTZ_H_A - LSM6DSOX_STATUS_REG + 1;
+
+  /// Sensitivity in mg/LSB
+  static constexpr float accelerometer_sensitivity(AccelerometerRange range) {
+    switch (range) {
+    case AccelerometerRange::Range2g:
+      return 0.061f;
+    case AccelerometerRange::Range4g:
+      return 0.122f;
+    case AccelerometerRange::Range8g:
+      return 0.244f;
+    case AccelerometerRange::Range16g:
+      return 0.488f;
+    }
+    return 0.061f;
+  }
+
+  /// Sensitivity in mdps/LSB
+  static constexpr float gyroscope_sensitivity(GyroscopeRange range) {
+    switch (range) {
+    case GyroscopeRange::Range250dps:
+      return 8.75f;
+    case GyroscopeRange::Range500dps:
+      return 17.5f;
+    case GyroscopeRange::Range1000dps:
+      return 35.f;
+    case GyroscopeRange::Range2000dps:
+      return 70.f;
+    }
+    return 8.75f;
+  }
+
+  /// Writes the default data rates and the configured ranges.
+  void initialize();
+
+  /// Reads `N` consecutive registers starting at `first_register`, lets
+  /// `modify` change them and writes them back, i.e. one transaction each
+  /// way instead of one pair per register. Returns false on a bus error.
+  template <size_t N, typename Modify>
+  bool update_registers(u8 first_register, Modify modify) {
+    u8 values[N];
+    if (lsm6dsox_read_reg(&m_device, first_register, values, N) != 0)
+      return false;
+    modify(values);
+    return write_registers(first_register, values, N);
+  }
+
+  void convert(i16 const* raw_accel, i16 const* raw_rot, Data& result) const;
+  /// Decodes `count` FIFO words into `samples`, starting at `sample_count`,
+  /// which is advanced for every completed sample.
+  void decode_fifo_words(u8 const* words, size_t count, Data* samples,
+                         size_t max_samples, size_t& sample_count);
+
   stmdev_ctx_t m_device;
+
+  AccelerometerRange m_accel_range = AccelerometerRange::Range4g;
+  GyroscopeRange m_gyro_range = GyroscopeRange::Range2000dps;
+  /// Conversion factors from raw values to m/s^2 and °/s for the configured
+  /// ranges. They are cached to avoid reading the ranges back from the device
+  /// for every sample.
+  float m_accel_scale = 0.f;
+  float m_rot_scale = 0.f;
+
+  /// Raw accelerometer and gyroscope words of the FIFO sample currently being
+  /// assembled.
+  i16 m_fifo_raw_accel[3] = {};
+  i16 m_fifo_raw_rot[3] = {};
+  bool m_fifo_has_accel = false;
+  bool m_fifo_has_rot = false;
 };
@@ -2,11 +2,43 @@
 #include "scd4x_i2c.h"
 #include "sensirion_i2c_hal.h"
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 
-Scd41::Scd41(i2c_master_bus_handle_t i2c_handle) {
-  sensirion_i2c_hal_init(i2c_handle, DEFAULT_ADDRESS);
+/// Commands that are sent directly, since the driver blocks until the
+/// measurement is done.
+constexpr u16 MEASURE_SINGLE_SHOT = 0x219D;
+constexpr u16 MEASURE_SINGLE_SHOT_RHT_ONLY = 0x2196;
 
+/// Interval between measurements in a periodic mode, 0 otherwise.
+static u32 measurement_interval_ms(Scd41::Mode mode) {
+  switch (mode) {
+  case Scd41::Mode::Periodic:
+    return Scd41::PERIODIC_MEASUREMENT_INTERVAL_MS;
+  case Scd41::Mode::LowPowerPeriodic:
+    return Scd41::LOW_POWER_PERIODIC_MEASUREMENT_INTERVAL_MS;
+  default:
+    return 0;
+  }
+}
+
+char const* Scd41::mode_name(Mode mode) {
+  switch (mode) {
+  case Mode::Idle:
+    return "idle";
+  case Mode::Periodic:
+    return "periodic";
+  case Mode::LowPowerPeriodic:
+    return "low power periodic";
+  case Mode::SingleShot:
+    return "single shot";
+  }
+  return "";
+}
+
+Scd41::Scd41(I2cBus& bus)
+    : m_device(sensirion_i2c_hal_init(bus, DEFAULT_ADDRESS, "SCD41",
+                                      I2C_SCL_SPEED_HZ)) {
   // clean up potential SCD41 states
   scd4x_init(DEFAULT_ADDRESS);
   scd4x_wake_up();
@@ -14,40 +46,176 @@ Scd41::Scd41(i2c_master_bus_handle_t i2c_handle) {
   scd4x_reinit();
 }
 
-void Scd41::start_periodic_measurement() { scd4x_start_periodic_measurement(); }
+void Scd41::set_mode(Mode mode) {
+  // The sensor may have been power cycled while it wasn't responding, or still
+  // be measuring if only the bus failed. Either way, it is brought back to
+  // idle, so `mode` is entered from scratch.
+  if (m_device->take_reinitialization_request() && m_mode != Mode::Idle) {
+    ESP_LOGW("SCD41", "Sensor recovered, leaving %s mode", mode_name(m_mode));
+    if (m_mode == Mode::Periodic || m_mode == Mode::LowPowerPeriodic)
+      scd4x_stop_periodic_measurement();
+    m_mode = Mode::Idle;
+    m_discard_next_single_shot = true;
+  }
+
+  if (mode == m_mode)
+    return;
+
+  if (m_mode == Mode::Periodic || m_mode == Mode::LowPowerPeriodic)
+    scd4x_stop_periodic_measurement();
+
+  m_mode = mode;
+  m_measurement_started_us.reset();
+  m_next_measurement_us.reset();
+
+  switch (mode) {
+  case Mode::Periodic:
+    scd4x_start_periodic_measurement();
+    break;
+  case Mode::LowPowerPeriodic:
+    scd4x_start_low_power_periodic_measurement();
+    break;
+  case Mode::Idle:
+  case Mode::SingleShot:
+    return;
+  }
+
+  // the sensor was measuring since waking up, so single shot measurements
+  // are accurate from now on
+  m_discard_next_single_shot = false;
+  mark_measurement_started(measurement_interval_ms(mode));
+}
+
+void Scd41::measure_single_shot() {
+  restore_mode_if_lost();
+  if (m_mode != Mode::SingleShot) {
+    ESP_LOGE("SCD41", "Single shot measurement requires single shot mode");
+    return;
+  }
+  if (send_command(MEASURE_SINGLE_SHOT))
+    mark_measurement_started(SINGLE_SHOT_DURATION_MS);
+}
 
-void Scd41::start_low_power_periodic_measurement() {
-  scd4x_start_low_power_periodic_measurement();
+void Scd41::measure_single_shot_rht_only() {
+  restore_mode_if_lost();
+  if (m_mode != Mode::SingleShot) {
+    ESP_LOGE("SCD41", "Single shot measurement requires single shot mode");
+    return;
+  }
+  if (send_command(MEASURE_SINGLE_SHOT_RHT_ONLY))
+    mark_measurement_started(SINGLE_SHOT_RHT_ONLY_DURATION_MS);
 }
 
-std::optional<Scd41::Data> Scd41::read() {
+std::optional<bool> Scd41::data_ready() {
+  restore_mode_if_lost();
   bool data_ready;
   if (auto res = scd4x_get_data_ready_status(&data_ready); res != 0) {
     ESP_LOGE("SCD41", "Getting data ready flag failed: %d", res);
     return std::nullopt;
   }
-  if (!data_ready) {
-    ESP_LOGW("SCD41", "No data available!");
-    return std::nullopt;
+  return data_ready;
+}
+
+u32 Scd41::time_until_data_ready_ms() const {
+  if (!m_next_measurement_us)
+    return 0;
+  auto remaining_us = *m_next_measurement_us - esp_timer_get_time();
+  return remaining_us > 0 ? static_cast<u32>(remaining_us / 1000) : 0;
+}
+
+Scd41::WaitResult Scd41::wait_for_data(WaitFunction const& wait) {
+  if (auto ms = time_until_data_ready_ms(); ms > 0 && wait(pdMS_TO_TICKS(ms)))
+    return WaitResult::Aborted;
+
+  auto deadline = esp_timer_get_time() + DATA_READY_TIMEOUT_MS * 1000;
+  // bus errors are retried like a measurement that isn't ready yet
+  bool failed = false;
+  while (true) {
+    auto ready = data_ready();
+    if (ready && *ready)
+      return WaitResult::Ready;
+    failed = !ready;
+
+    if (esp_timer_get_time() >= deadline) {
+      ESP_LOGW("SCD41", "No data available!");
+      return failed ? WaitResult::Failed : WaitResult::TimedOut;
+    }
+    if (wait(pdMS_TO_TICKS(DATA_READY_POLL_INTERVAL_MS)))
+      return WaitResult::Aborted;
+  }
+}
+
+Scd41::ReadResult Scd41::read(Data& data, bool check_data_ready) {
+  restore_mode_if_lost();
+  if (check_data_ready) {
+    auto ready = data_ready();
+    if (!ready)
+      return ReadResult::Failed;
+    if (!*ready) {
+      ESP_LOGW("SCD41", "No data available!");
+      return ReadResult::NotReady;
+    }
   }
 
   u16 co2;
   i32 temp, hum;
   if (auto res = scd4x_read_measurement(&co2, &temp, &hum); res != 0) {
-    ESP_LOGE("SCD41", "Getting data ready flag failed: %d", res);
-    return std::nullopt;
+    ESP_LOGE("SCD41", "Reading measurement failed: %d", res);
+    return ReadResult::Failed;
+  }
+
+  auto now = esp_timer_get_time();
+  if (m_measurement_started_us) {
+    ESP_LOGI("SCD41", "First measurement in %s mode after %lld ms",
+             mode_name(m_mode), (now - *m_measurement_started_us) / 1000);
+    m_measurement_started_us.reset();
+  }
+
+  // The sensor measures on its own clock, so anchor the next measurement to
+  // this one. It was read at most one poll interval after it became available.
+  if (auto interval = measurement_interval_ms(m_mode); interval > 0) {
+    m_next_measurement_us =
+        now + (interval - DATA_READY_POLL_INTERVAL_MS) * 1000;
+  } else {
+    m_next_measurement_us.reset();
+  }
+
+  if (m_mode == Mode::SingleShot && m_discard_next_single_shot) {
+    ESP_LOGI("SCD41", "Discarding first single shot measurement");
+    m_discard_next_single_shot = false;
+    // instead of leaving the caller without a measurement for its interval
+    measure_single_shot();
+    return ReadResult::Discarded;
   }
 
-  return Data{
+  data = Data{
       .co2 = co2,
       .temperature = static_cast<float>(temp) / 1000.f,
       .humidity = static_cast<float>(hum) / 1000.f,
   };
+  return ReadResult::Ok;
 }
 
-void Scd41::stop_periodic_measurement() { scd4x_stop_periodic_measurement(); }
-
 void Scd41::power_down() {
-  scd4x_stop_periodic_measurement();
+  set_mode(Mode::Idle);
   scd4x_power_down();
+  m_discard_next_single_shot = true;
+}
+
+void Scd41::restore_mode_if_lost() { set_mode(m_mode); }
+
+bool Scd41::send_command(u16 command) {
+  u8 buf[] = {static_cast<u8>(command >> 8), static_cast<u8>(command & 0xFF)};
+  if (auto res = m_device->transmit(buf, sizeof(buf), I2C_TIMEOUT_MS);
+      res != ESP_OK) {
+    ESP_LOGE("SCD41", "Sending command 0x%04X failed: %s", command,
+             esp_err_to_name(res));
+    return false;
+  }
+  return true;
+}
+
+void Scd41::mark_measurement_started(u32 duration_ms) {
+  m_measurement_started_us = esp_timer_get_time();
+  m_next_measurement_us = *m_measurement_started_us + duration_ms * 1000;
 }
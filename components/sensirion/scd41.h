@@ -1,6 +1,8 @@
 #pragma once
 
-#include <driver/i2c_master.h>
+#include <freertos/FreeRTOS.h>
+#include <functional>
+#include <i2c_bus.h>
 #include <optional>
 #include <types.h>
 
@@ -8,9 +10,47 @@ class Scd41 {
 public:
   static constexpr u16 DEFAULT_ADDRESS = 0x62;
   static constexpr u32 I2C_TIMEOUT_MS = 50;
+  static constexpr u32 I2C_SCL_SPEED_HZ = 400000;
+
+  enum class Mode {
+    /// No measurement is running
+    Idle,
+    /// A new measurement every 5 s
+    Periodic,
+    /// A new measurement every 30 s
+    LowPowerPeriodic,
+    /// Measurements are triggered individually using `measure_single_shot()`
+    /// or `measure_single_shot_rht_only()`.
+    SingleShot,
+  };
+
+  /// Time until the first measurement is available after entering the
+  /// respective periodic mode or triggering a single shot measurement.
+  static constexpr u32 PERIODIC_MEASUREMENT_INTERVAL_MS = 5000;
+  static constexpr u32 LOW_POWER_PERIODIC_MEASUREMENT_INTERVAL_MS = 30000;
+  static constexpr u32 SINGLE_SHOT_DURATION_MS = 5000;
+  static constexpr u32 SINGLE_SHOT_RHT_ONLY_DURATION_MS = 50;
+
+  /// Interval the data ready flag is polled at once a measurement is due
+  static constexpr u32 DATA_READY_POLL_INTERVAL_MS = 100;
+  /// How long after a measurement was due to keep polling for it
+  static constexpr u32 DATA_READY_TIMEOUT_MS = 2000;
+
+  enum class WaitResult { Ready, Aborted, TimedOut, Failed };
+  enum class ReadResult {
+    Ok,
+    /// No new measurement was available
+    NotReady,
+    /// The measurement was the inaccurate first single shot after waking the
+    /// sensor up. The single shot measurement replacing it was triggered.
+    Discarded,
+    Failed,
+  };
+  /// Sleeps for the given number of ticks. Returns true to abort waiting.
+  using WaitFunction = std::function<bool(TickType_t)>;
 
   struct Data {
-    /// CO2 concentration in ppm
+    /// CO2 concentration in ppm. 0 after a `measure_single_shot_rht_only()`.
     u16 co2;
     /// Temperature in °C
     float temperature;
@@ -18,13 +58,61 @@ public:
     float humidity;
   };
 
-  Scd41(i2c_master_bus_handle_t i2c_handle);
+  static char const* mode_name(Mode mode);
+
+  Scd41(I2cBus& bus);
 
-  void start_periodic_measurement();
-  void start_low_power_periodic_measurement();
-  std::optional<Data> read();
-  /// Stops the period measurement (both normal and low power).
-  void stop_periodic_measurement();
+  /// Stops the current periodic measurement, if any, and starts the one of
+  /// `mode`. Does nothing if the sensor is already in `mode`, unless it
+  /// recovered from a bus fault since (see
+  /// `I2cDevice::take_reinitialization_request()`).
+  void set_mode(Mode mode);
+  Mode mode() const { return m_mode; }
+
+  /// Triggers a single CO2, temperature and humidity measurement. Its result
+  /// can be read after `SINGLE_SHOT_DURATION_MS`. Requires `Mode::SingleShot`.
+  void measure_single_shot();
+  /// Triggers a single temperature and humidity measurement. Its result can be
+  /// read after `SINGLE_SHOT_RHT_ONLY_DURATION_MS`. Requires
+  /// `Mode::SingleShot`.
+  void measure_single_shot_rht_only();
+
+  /// Returns whether a new measurement can be read.
+  std::optional<bool> data_ready();
+  /// Time until the next measurement is expected to be available, or 0 if it
+  /// is due or no measurement is running.
+  u32 time_until_data_ready_ms() const;
+  /// Waits until a new measurement is available. Sleeps until the
+  /// measurement is due and only polls the data ready flag from then on, so
+  /// the bus and the CPU stay idle in between.
+  WaitResult wait_for_data(WaitFunction const& wait);
+
+  /// Reads the latest measurement into `data`, which is only written if the
+  /// result is `ReadResult::Ok`. If `check_data_ready` is false, the caller
+  /// is responsible for knowing a new measurement is available (e.g. from
+  /// `wait_for_data()`), which saves reading the data ready flag.
+  ReadResult read(Data& data, bool check_data_ready = true);
 
   void power_down();
+
+private:
+  /// Enters the current mode again if the sensor recovered from a bus fault.
+  /// Called before every transfer, so the mode isn't lost until the next
+  /// `set_mode()`.
+  void restore_mode_if_lost();
+  /// Sends a command without arguments.
+  bool send_command(u16 command);
+  void mark_measurement_started(u32 duration_ms);
+
+  I2cDevice* m_device;
+
+  Mode m_mode = Mode::Idle;
+  /// The first single shot measurement after waking the sensor up is not
+  /// accurate and has to be discarded.
+  bool m_discard_next_single_shot = true;
+  /// When the current mode was entered or the last single shot measurement
+  /// was triggered, until the first measurement was read.
+  std::optional<i64> m_measurement_started_us;
+  /// When the next measurement is expected to be available
+  std::optional<i64> m_next_measurement_us;
 };
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <types.h>
+
+namespace sensirion {
+
+/// CRC-8 with polynomial 0x31 (x^8 + x^5 + x^4 + 1) for every byte value
+constexpr std::array<u8, 256> CRC8_TABLE = [] {
+  std::array<u8, 256> table{};
+  for (size_t i = 0; i < table.size(); ++i) {
+    auto crc = static_cast<u8>(i);
+    for (size_t bit = 0; bit < 8; ++bit)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+    table[i] = crc;
+  }
+  return table;
+}();
+
+/// CRC Sensirion sensors protect every transferred word with: CRC-8 with
+/// polynomial 0x31, initialized with 0xFF and without a final XOR.
+constexpr u8 crc8(u8 const* data, size_t count) {
+  u8 crc = 0xFF;
+  for (size_t i = 0; i < count; ++i)
+    crc = CRC8_TABLE[crc ^ data[i]];
+  return crc;
+}
+
+} // namespace sensirion
@@ -0,0 +1,6 @@
+#pragma once
+
+// Force-included into sensirion_i2c.c (see CMakeLists.txt). Makes its bitwise
+// CRC implementation weak, so the table-driven one in sensirion_i2c_hal.cpp
+// replaces it, including the calls from within sensirion_i2c.c.
+#pragma weak sensirion_i2c_generate_crc
@@ -32,14 +32,13 @@
 #include "sensirion_i2c_hal.h"
 #include "sensirion_common.h"
 #include "sensirion_config.h"
+#include "sensirion_crc.h"
 
+#include <array>
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <sys/unistd.h>
 
-#include <scd41.h>
-#include <sgp41.h>
-
 /*
  * INSTRUCTIONS
  * ============
@@ -48,16 +47,43 @@
  * Follow the function specification in the comments.
  */
 
-i2c_master_dev_handle_t* get_device_for_address(u16 address) {
-  switch (address) {
-  case Scd41::DEFAULT_ADDRESS:
-    return &g_scd41_device;
-  case Sgp41::DEFAULT_ADDRESS:
-    return &g_sgp41_device;
-  default:
-    ESP_LOGE("Sensirion HAL", "Device for address %d not found", address);
-    return NULL;
+namespace {
+
+/// Sensor registered through `sensirion_i2c_hal_init()`
+struct Registration {
+  u16 address;
+  I2cBus* bus;
+  I2cDevice* device;
+};
+
+constexpr size_t MAX_REGISTRATIONS = 4;
+
+portMUX_TYPE g_registrations_lock = portMUX_INITIALIZER_UNLOCKED;
+std::array<Registration, MAX_REGISTRATIONS> g_registrations{};
+/// Entries are only appended and never change once their device is set, so
+/// lookups don't need the lock.
+size_t g_registration_count = 0;
+
+I2cDevice* find_device(u16 address) {
+  for (size_t i = 0; i < g_registration_count; ++i) {
+    auto const& registration = g_registrations[i];
+    if (registration.address == address && registration.device)
+      return registration.device;
   }
+  ESP_LOGE("Sensirion HAL", "Device for address %d not found", address);
+  return nullptr;
+}
+
+} // namespace
+
+/**
+ * Replaces the bitwise implementation in sensirion_i2c.c, which is declared
+ * weak (see CMakeLists.txt). Every word that is sent to or received from a
+ * sensor is protected by this CRC, so it runs for every transfer.
+ */
+extern "C" uint8_t sensirion_i2c_generate_crc(uint8_t const* data,
+                                              uint16_t count) {
+  return sensirion::crc8(data, count);
 }
 
 /**
@@ -76,20 +102,43 @@ int16_t sensirion_i2c_hal_select_bus(uint8_t bus_idx) { return 0; }
  * Initialize all hard- and software components that are needed for the I2C
  * communication.
  */
-void sensirion_i2c_hal_init(i2c_master_bus_handle_t i2c_handle, u16 address) {
-  i2c_device_config_t dev = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = address,
-      .scl_speed_hz = 100000,
-  };
-  ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_handle, &dev,
-                                            get_device_for_address(address)));
+I2cDevice* sensirion_i2c_hal_init(I2cBus& bus, u16 address, char const* name,
+                                  u32 scl_speed_hz) {
+  Registration* registration = nullptr;
+  auto result = ESP_OK;
+  taskENTER_CRITICAL(&g_registrations_lock);
+  for (size_t i = 0; i < g_registration_count; ++i) {
+    if (g_registrations[i].address == address) {
+      registration = &g_registrations[i];
+      break;
+    }
+  }
+  if (registration) {
+    // the same address on two buses couldn't be told apart by the driver
+    if (registration->bus != &bus)
+      result = ESP_ERR_INVALID_STATE;
+  } else if (g_registration_count < g_registrations.size()) {
+    // reserve the entry, the device is added outside of the critical section
+    // since that may block
+    registration = &g_registrations[g_registration_count++];
+    *registration = {.address = address, .bus = &bus, .device = nullptr};
+  } else {
+    result = ESP_ERR_NO_MEM;
+  }
+  taskEXIT_CRITICAL(&g_registrations_lock);
+  ESP_ERROR_CHECK(result);
+
+  if (!registration->device)
+    registration->device = bus.add_device(address, scl_speed_hz, name);
+  return registration->device;
 }
 
 /**
  * Release all resources initialized by sensirion_i2c_hal_init().
+ *
+ * NOTE: Devices are owned by their `I2cBus`, so there is nothing to release.
  */
-void sensirion_i2c_hal_free(void) { i2c_master_bus_rm_device(g_scd41_device); }
+void sensirion_i2c_hal_free(void) {}
 
 /**
  * Execute one read transaction on the I2C bus, reading a given number of bytes.
@@ -102,8 +151,10 @@ void sensirion_i2c_hal_free(void) { i2c_master_bus_rm_device(g_scd41_device); }
  * @returns 0 on success, error code otherwise
  */
 int8_t sensirion_i2c_hal_read(uint8_t address, uint8_t* data, uint16_t count) {
-  return i2c_master_receive(*get_device_for_address(address), data, count,
-                            I2C_TIMEOUT_MS);
+  auto* device = find_device(address);
+  if (!device)
+    return -1;
+  return device->receive(data, count, I2C_TIMEOUT_MS);
 }
 
 /**
@@ -119,8 +170,10 @@ int8_t sensirion_i2c_hal_read(uint8_t address, uint8_t* data, uint16_t count) {
  */
 int8_t sensirion_i2c_hal_write(uint8_t address, uint8_t const* data,
                                uint16_t count) {
-  return i2c_master_transmit(*get_device_for_address(address), data, count,
-                             I2C_TIMEOUT_MS);
+  auto* device = find_device(address);
+  if (!device)
+    return -1;
+  return device->transmit(data, count, I2C_TIMEOUT_MS);
 }
 
 /**
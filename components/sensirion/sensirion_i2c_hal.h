@@ -33,20 +33,15 @@
 #define SENSIRION_I2C_HAL_H
 
 #include "sensirion_config.h"
-#include <driver/i2c_master.h>
+#include <i2c_bus.h>
 #include <types.h>
 
 constexpr u32 I2C_TIMEOUT_MS = 50;
 
-static i2c_master_dev_handle_t g_scd41_device;
-static i2c_master_dev_handle_t g_sgp41_device;
-
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
-i2c_master_dev_handle_t* get_device_for_address(u16 address);
-
 /**
  * Select the current i2c bus by index.
  * All following i2c operations will be directed at that bus.
@@ -63,9 +58,14 @@ int16_t sensirion_i2c_hal_select_bus(uint8_t bus_idx);
  * Initialize all hard- and software components that are needed for the I2C
  * communication.
  *
- * NOTE: Changed to take necessary arguments to initialize I2C device handle.
+ * NOTE: Changed to register a sensor on `bus`, which all following transfers
+ * to `address` are directed at. Sensors may be on different buses, but their
+ * addresses have to be unique. Registering an address again on the same bus
+ * returns the existing device. The device is also returned, so drivers can
+ * talk to it directly.
  */
-void sensirion_i2c_hal_init(i2c_master_bus_handle_t i2c_handle, u16 address);
+I2cDevice* sensirion_i2c_hal_init(I2cBus& bus, u16 address, char const* name,
+                                  u32 scl_speed_hz);
 
 /**
  * Release all resources initialized by sensirion_i2c_hal_init().
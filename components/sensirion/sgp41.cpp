@@ -4,31 +4,9 @@
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 
-void Sgp41::GasIndexAlgorithm::initialize(float sampling_interval_s) {
-  GasIndexAlgorithm_init_with_sampling_interval(
-      &m_voc_params, GasIndexAlgorithm_ALGORITHM_TYPE_VOC, sampling_interval_s);
-  GasIndexAlgorithm_init_with_sampling_interval(
-      &m_nox_params, GasIndexAlgorithm_ALGORITHM_TYPE_NOX, sampling_interval_s);
-}
-
-Sgp41::Data Sgp41::GasIndexAlgorithm::process(u16 sraw_voc, u16 sraw_nox) {
-  i32 voc_index, nox_index;
-  GasIndexAlgorithm_process(&m_voc_params, sraw_voc, &voc_index);
-  GasIndexAlgorithm_process(&m_nox_params, sraw_nox, &nox_index);
-  return Data{
-      .voc_index = static_cast<u16>(voc_index),
-      .nox_index = static_cast<u16>(nox_index),
-  };
-}
-
-void Sgp41::GasIndexAlgorithm::reset() {
-  GasIndexAlgorithm_reset(&m_voc_params);
-  GasIndexAlgorithm_reset(&m_nox_params);
-}
-
-Sgp41::Sgp41(i2c_master_bus_handle_t i2c_handle, u16 address) {
-  sensirion_i2c_hal_init(i2c_handle, address);
-
+Sgp41::Sgp41(I2cBus& bus, u16 address)
+    : m_device(
+          sensirion_i2c_hal_init(bus, address, "SGP41", I2C_SCL_SPEED_HZ)) {
   // u16 serial_number[3];
   // if (auto error = sgp41_get_serial_number(serial_number); error != 0) {
   //   ESP_LOGE("SGP41", "Error getting serial number: %d", error);
@@ -50,7 +28,14 @@ void Sgp41::perform_conditioning(float temperature, float humidity) {
 }
 
 std::optional<Sgp41::Data> Sgp41::read(float temperature, float humidity,
-                                       GasIndexAlgorithm& gia) {
+                                       GasIndexAlgorithm& gia, u32 samples) {
+  // the sensor may have been power cycled while it wasn't responding, which
+  // turned its heater off
+  if (m_device->take_reinitialization_request()) {
+    ESP_LOGW("SGP41", "Sensor recovered, heating up again");
+    heat_up(temperature, humidity);
+  }
+
   u16 sraw_voc, sraw_nox;
   if (sgp41_measure_raw_signals(compensation_rh(humidity),
                                 compensation_t(temperature), &sraw_voc,
@@ -58,7 +43,18 @@ std::optional<Sgp41::Data> Sgp41::read(float temperature, float humidity,
     return std::nullopt;
   }
 
-  return gia.process(sraw_voc, sraw_nox);
+  return gia.bridge(sraw_voc, sraw_nox, samples);
+}
+
+void Sgp41::heat_up(float temperature, float humidity) {
+  // heating up restores everything a fault could have reset
+  m_device->take_reinitialization_request();
+
+  // the first measurement turns the heater on and is not representative
+  u16 sraw_voc, sraw_nox;
+  sgp41_measure_raw_signals(compensation_rh(humidity),
+                            compensation_t(temperature), &sraw_voc, &sraw_nox);
+  vTaskDelay(pdMS_TO_TICKS(HEAT_UP_DURATION_MS));
 }
 
 void Sgp41::turn_heater_off() { sgp41_turn_heater_off(); }
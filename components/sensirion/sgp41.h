@@ -1,6 +1,6 @@
 #pragma once
 
-#include <driver/i2c_master.h>
+#include <i2c_bus.h>
 #include <optional>
 #include <sensirion_gas_index_algorithm.h>
 #include <types.h>
@@ -9,26 +9,44 @@ class Sgp41 {
 public:
   static constexpr u16 DEFAULT_ADDRESS = 0x59;
   static constexpr u32 I2C_TIMEOUT_MS = 50;
+  static constexpr u32 I2C_SCL_SPEED_HZ = 400000;
+  /// Time the heater needs after being turned on until measurements are
+  /// representative (see Sensirion's low power mode for the SGP40).
+  static constexpr u32 HEAT_UP_DURATION_MS = 170;
 
   struct Data {
     u16 voc_index = 0;
     u16 nox_index = 0;
   };
 
+  /// VOC and NOx gas index algorithm state. Trivially copyable, so it can be
+  /// kept in RTC memory or stored in flash as is.
   class GasIndexAlgorithm {
   public:
     void initialize(float sampling_interval_s);
 
+    float sampling_interval_s() const;
+
     Data process(u16 sraw_voc, u16 sraw_nox);
 
+    /// Processes `samples` raw values that ramp linearly from the previously
+    /// processed ones to these, standing in for the sampling intervals that
+    /// were missed since then. This keeps the algorithm's time constants in
+    /// sync with real time without feeding a single measurement over and
+    /// over (see components/sensirion/test/test_gas_index_gaps.cpp).
+    Data bridge(u16 sraw_voc, u16 sraw_nox, u32 samples);
+
     void reset();
 
   private:
     GasIndexAlgorithmParams m_voc_params;
     GasIndexAlgorithmParams m_nox_params;
+    /// Raw values of the last `process()`, 0 before the first one
+    u16 m_last_sraw_voc;
+    u16 m_last_sraw_nox;
   };
 
-  Sgp41(i2c_master_bus_handle_t i2c_handle, u16 address = DEFAULT_ADDRESS);
+  Sgp41(I2cBus& bus, u16 address = DEFAULT_ADDRESS);
 
   /// Performs sensor conditioning. This will execute the
   /// sgp41_execute_conditioning command every second for 10s.
@@ -37,12 +55,26 @@ public:
   /// NOTE: This takes 10 seconds!
   void perform_conditioning(float temperature, float humidity);
 
+  /// Measures and feeds the raw values to `gia`. If the sensor wasn't sampled
+  /// for a while (e.g. during deep sleep), `samples` can be larger than 1 to
+  /// bridge the missed sampling intervals (see `GasIndexAlgorithm::bridge()`).
+  ///
+  /// NOTE: After the sensor recovered from a bus fault, this heats it up again
+  /// first (see `heat_up()`).
   std::optional<Data> read(float temperature, float humidity,
-                           GasIndexAlgorithm& gia);
+                           GasIndexAlgorithm& gia, u32 samples = 1);
+
+  /// Turns the heater on and waits until it is hot enough for `read()`.
+  /// Required when the heater was turned off before.
+  ///
+  /// NOTE: This takes `HEAT_UP_DURATION_MS`!
+  void heat_up(float temperature, float humidity);
 
   void turn_heater_off();
 
 private:
+  I2cDevice* m_device;
+
   u16 compensation_t(float temperature);
   u16 compensation_rh(float humidity);
 };
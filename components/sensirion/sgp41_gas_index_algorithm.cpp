@@ -0,0 +1,59 @@
+#include "sgp41.h"
+#include <cmath>
+#include <fast_math.h>
+
+/// Used by the gas index algorithm instead of `expf` (see CMakeLists.txt).
+extern "C" float gas_index_algorithm_expf(float x) {
+  return fast_math::expf(x);
+}
+
+void Sgp41::GasIndexAlgorithm::initialize(float sampling_interval_s) {
+  GasIndexAlgorithm_init_with_sampling_interval(
+      &m_voc_params, GasIndexAlgorithm_ALGORITHM_TYPE_VOC, sampling_interval_s);
+  GasIndexAlgorithm_init_with_sampling_interval(
+      &m_nox_params, GasIndexAlgorithm_ALGORITHM_TYPE_NOX, sampling_interval_s);
+  m_last_sraw_voc = 0;
+  m_last_sraw_nox = 0;
+}
+
+float Sgp41::GasIndexAlgorithm::sampling_interval_s() const {
+  float sampling_interval;
+  GasIndexAlgorithm_get_sampling_interval(&m_voc_params, &sampling_interval);
+  return sampling_interval;
+}
+
+Sgp41::Data Sgp41::GasIndexAlgorithm::process(u16 sraw_voc, u16 sraw_nox) {
+  i32 voc_index, nox_index;
+  GasIndexAlgorithm_process(&m_voc_params, sraw_voc, &voc_index);
+  GasIndexAlgorithm_process(&m_nox_params, sraw_nox, &nox_index);
+  m_last_sraw_voc = sraw_voc;
+  m_last_sraw_nox = sraw_nox;
+  return Data{
+      .voc_index = static_cast<u16>(voc_index),
+      .nox_index = static_cast<u16>(nox_index),
+  };
+}
+
+Sgp41::Data Sgp41::GasIndexAlgorithm::bridge(u16 sraw_voc, u16 sraw_nox,
+                                             u32 samples) {
+  // without a previous measurement, there is nothing to ramp from
+  u16 from_voc = m_last_sraw_voc != 0 ? m_last_sraw_voc : sraw_voc;
+  u16 from_nox = m_last_sraw_nox != 0 ? m_last_sraw_nox : sraw_nox;
+
+  Data data;
+  for (u32 i = 1; i <= samples; ++i) {
+    auto t = static_cast<float>(i) / samples;
+    auto ramp = [t](u16 from, u16 to) {
+      return static_cast<u16>(lroundf(from + (to - from) * t));
+    };
+    data = process(ramp(from_voc, sraw_voc), ramp(from_nox, sraw_nox));
+  }
+  return data;
+}
+
+void Sgp41::GasIndexAlgorithm::reset() {
+  GasIndexAlgorithm_reset(&m_voc_params);
+  GasIndexAlgorithm_reset(&m_nox_params);
+  m_last_sraw_voc = 0;
+  m_last_sraw_nox = 0;
+}
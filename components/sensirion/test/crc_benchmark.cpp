@@ -0,0 +1,81 @@
+// Measures the CRC work per sensor read with the table-driven CRC and with
+// the bitwise one of the vendored driver, next to the time the same read
+// occupies the bus at 100 and 400 kHz.
+
+#include "reference_crc8.h"
+#include <array>
+#include <benchmark.h>
+#include <random>
+#include <sensirion_crc.h>
+
+namespace {
+
+constexpr size_t WORD_COUNT = 1024;
+constexpr long ITERATIONS = 20'000'000;
+
+/// A read, as the vendored driver transfers it: every 16-bit word that is
+/// sent after a command or received is followed by its CRC.
+struct Read {
+  char const* name;
+  size_t commands;
+  size_t sent_words;
+  size_t received_words;
+};
+
+/// `Scd41::read()`: get_data_ready_status, then read_measurement
+constexpr Read SCD41_READ = {"SCD41 data ready + measurement", 2, 0,
+                             1 + 3};
+/// `Sgp41::sample()`: measure_raw_signals with the compensation arguments
+constexpr Read SGP41_READ = {"SGP41 raw signals", 1, 2, 2};
+constexpr std::array<Read, 2> READS = {SCD41_READ, SGP41_READ};
+/// Both sensors wait between the command and the read
+constexpr size_t TRANSFERS_PER_COMMAND = 2;
+
+/// Bus time of `read` in µs: 9 clocks per byte including the ACK, and a
+/// start and a stop condition per transfer. Every transfer starts with the
+/// address byte, every command has 2 bytes.
+double bus_time_us(Read const& read, double scl_hz) {
+  auto transfers = read.commands * TRANSFERS_PER_COMMAND;
+  auto bytes = transfers + read.commands * 2 +
+               (read.sent_words + read.received_words) * 3;
+  auto clocks = bytes * 9 + transfers * 2;
+  return clocks / scl_hz * 1e6;
+}
+
+} // namespace
+
+int main() {
+  using namespace host_benchmark;
+  std::mt19937 random(6);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::array<u8, WORD_COUNT * 2> words;
+  for (auto& b : words)
+    b = static_cast<u8>(byte(random));
+
+  // one CRC per word, as sensirion_i2c.c checks and generates them
+  size_t i = 0;
+  u8 sum = 0;
+  auto bitwise_ns = ns_per_call(ITERATIONS, [&] {
+    sum += reference_crc8(&words[i++ % WORD_COUNT * 2], 2);
+  });
+  keep(sum);
+  i = 0;
+  sum = 0;
+  auto table_ns = ns_per_call(ITERATIONS, [&] {
+    sum += sensirion::crc8(&words[i++ % WORD_COUNT * 2], 2);
+  });
+  keep(sum);
+
+  std::printf("CRC time per 16-bit word:\n");
+  report("bitwise (before)", bitwise_ns);
+  report("table", table_ns, bitwise_ns);
+  for (auto const& read : READS) {
+    auto crcs = read.sent_words + read.received_words;
+    std::printf("%s, %zu CRCs:\n", read.name, crcs);
+    report("bitwise CRCs (before)", bitwise_ns * crcs);
+    report("table CRCs", table_ns * crcs, bitwise_ns * crcs);
+    std::printf("  bus time: %.0f us at 100 kHz (before), %.0f us at 400 kHz\n",
+                bus_time_us(read, 100'000), bus_time_us(read, 400'000));
+  }
+  return 0;
+}
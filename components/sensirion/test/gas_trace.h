@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+#include <types.h>
+#include <vector>
+
+/// Raw SGP41 signals of a synthetic room, for feeding the gas index algorithm
+/// on the host. No recording of the sensor is in the repository.
+struct GasTraceSample {
+  u16 sraw_voc;
+  u16 sraw_nox;
+};
+
+/// One sample per second over `seconds`: a baseline that drifts with the time
+/// of day, sensor noise, and events that decay over minutes, e.g. cooking or
+/// cleaning. More VOCs lower the VOC signal, more NOx raises the NOx signal.
+inline std::vector<GasTraceSample> synthetic_gas_trace(u32 seconds,
+                                                       u32 seed = 7) {
+  constexpr float SECONDS_PER_DAY = 24 * 60 * 60;
+  constexpr float VOC_BASELINE = 30000;
+  constexpr float NOX_BASELINE = 15000;
+  /// Mean time between two events
+  constexpr float EVENT_INTERVAL_S = 3 * 60 * 60;
+
+  std::mt19937 random(seed);
+  std::normal_distribution<float> noise;
+  std::exponential_distribution<float> next_event(1 / EVENT_INTERVAL_S);
+  std::uniform_real_distribution<float> uniform;
+
+  std::vector<GasTraceSample> trace(seconds);
+  float voc_event = 0;
+  float nox_event = 0;
+  float event_decay = 1;
+  float event_in_s = next_event(random);
+  for (u32 t = 0; t < seconds; ++t) {
+    if (--event_in_s <= 0) {
+      voc_event = 1000 + 4000 * uniform(random);
+      nox_event = 200 * uniform(random);
+      // decays to 1/e in 5 to 30 minutes
+      event_decay = expf(-1 / (60 * (5 + 25 * uniform(random))));
+      event_in_s = next_event(random);
+    }
+    voc_event *= event_decay;
+    nox_event *= event_decay;
+
+    auto day = sinf(2 * static_cast<float>(M_PI) * t / SECONDS_PER_DAY);
+    auto voc = VOC_BASELINE + 600 * day - voc_event + 20 * noise(random);
+    auto nox = NOX_BASELINE - 100 * day + nox_event + 10 * noise(random);
+    trace[t] = {
+        .sraw_voc = static_cast<u16>(lroundf(voc)),
+        .sraw_nox = static_cast<u16>(lroundf(nox)),
+    };
+  }
+  return trace;
+}
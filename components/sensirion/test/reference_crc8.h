@@ -0,0 +1,20 @@
+#pragma once
+
+#include <types.h>
+
+/// The bitwise implementation from Sensirion's sensirion_i2c.c, which
+/// `sensirion::crc8()` replaces
+inline u8 reference_crc8(u8 const* data, size_t count) {
+  constexpr u8 POLYNOMIAL = 0x31;
+  u8 crc = 0xFF;
+  for (size_t current_byte = 0; current_byte < count; ++current_byte) {
+    crc ^= data[current_byte];
+    for (u8 bit = 8; bit > 0; --bit) {
+      if (crc & 0x80)
+        crc = (crc << 1) ^ POLYNOMIAL;
+      else
+        crc = (crc << 1);
+    }
+  }
+  return crc;
+}
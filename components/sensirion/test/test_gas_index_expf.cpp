@@ -0,0 +1,82 @@
+#include "gas_trace.h"
+#include <algorithm>
+#include <benchmark.h>
+#include <fast_math.h>
+#include <sensirion_gas_index_algorithm.h>
+#include <test.h>
+
+namespace {
+
+/// Three days, long enough for the adaptive estimators to settle
+constexpr u32 TRACE_S = 3 * 24 * 60 * 60;
+/// The indices are integers, so a last digit may be rounded differently
+constexpr i32 MAX_INDEX_DEVIATION = 1;
+
+bool g_use_fast_expf = false;
+
+struct Indices {
+  std::vector<i32> voc;
+  std::vector<i32> nox;
+  double ns_per_sample;
+};
+
+/// Runs the VOC and NOx algorithms over the whole trace, as
+/// `Sgp41::GasIndexAlgorithm::process()` does every second.
+Indices process(std::vector<GasTraceSample> const& trace, bool fast_expf) {
+  g_use_fast_expf = fast_expf;
+  GasIndexAlgorithmParams voc_params, nox_params;
+  GasIndexAlgorithm_init(&voc_params, GasIndexAlgorithm_ALGORITHM_TYPE_VOC);
+  GasIndexAlgorithm_init(&nox_params, GasIndexAlgorithm_ALGORITHM_TYPE_NOX);
+
+  Indices indices;
+  indices.voc.resize(trace.size());
+  indices.nox.resize(trace.size());
+  size_t i = 0;
+  indices.ns_per_sample =
+      host_benchmark::ns_per_call(static_cast<long>(trace.size()), [&] {
+        GasIndexAlgorithm_process(&voc_params, trace[i].sraw_voc,
+                                  &indices.voc[i]);
+        GasIndexAlgorithm_process(&nox_params, trace[i].sraw_nox,
+                                  &indices.nox[i]);
+        ++i;
+      });
+  return indices;
+}
+
+i32 max_deviation(std::vector<i32> const& a, std::vector<i32> const& b) {
+  i32 deviation = 0;
+  for (size_t i = 0; i < a.size(); ++i)
+    deviation = std::max(deviation, std::abs(a[i] - b[i]));
+  return deviation;
+}
+
+} // namespace
+
+/// The algorithm is compiled with `expf` routed here (see CMakeLists.txt), so
+/// both implementations run the same code, including the call.
+extern "C" float gas_index_test_expf(float x) {
+  return g_use_fast_expf ? fast_math::expf(x) : std::exp(x);
+}
+
+TEST(fast_expf_matches_libm_over_a_long_trace) {
+  auto trace = synthetic_gas_trace(TRACE_S);
+  auto libm = process(trace, false);
+  auto fast = process(trace, true);
+
+  auto voc_deviation = max_deviation(fast.voc, libm.voc);
+  auto nox_deviation = max_deviation(fast.nox, libm.nox);
+  std::printf("max index deviation over %lu s: VOC %d, NOx %d\n",
+              static_cast<unsigned long>(TRACE_S), voc_deviation,
+              nox_deviation);
+  std::printf("time per sample (VOC + NOx):\n");
+  host_benchmark::report("libm expf", libm.ns_per_sample);
+  host_benchmark::report("fast_math::expf", fast.ns_per_sample,
+                         libm.ns_per_sample);
+  CHECK(voc_deviation <= MAX_INDEX_DEVIATION);
+  CHECK(nox_deviation <= MAX_INDEX_DEVIATION);
+
+  // the trace has to actually move the indices, or there is nothing to compare
+  auto [voc_min, voc_max] = std::minmax_element(libm.voc.begin() + 3600,
+                                                libm.voc.end());
+  CHECK(*voc_max - *voc_min > 100);
+}
@@ -0,0 +1,135 @@
+// Compares the gas indices of an SGP41 that is only sampled once per deep
+// sleep wakeup against continuous sampling, for different ways of bridging
+// the sampling intervals missed in between.
+
+#include "gas_trace.h"
+#include <algorithm>
+#include <fast_math.h>
+#include <sampling_scheduler.h>
+#include <sgp41.h>
+#include <test.h>
+
+namespace {
+
+constexpr u32 TRACE_S = 2 * 24 * 60 * 60;
+/// The device is in use and samples every second before it goes to sleep
+constexpr u32 AWAKE_S = 6 * 60 * 60;
+/// `SamplingScheduler::WAKEUP_PERIOD_MS` and `LOW_BATTERY_WAKEUP_PERIOD_MS`
+constexpr u32 WAKEUP_PERIOD_S = 60;
+constexpr u32 LOW_BATTERY_WAKEUP_PERIOD_S = 5 * 60;
+
+enum class Bridging {
+  /// Only the wakeup's measurement is processed
+  None,
+  /// The wakeup's measurement is processed once per missed interval, as
+  /// before `Sgp41::GasIndexAlgorithm::bridge()`
+  Repeated,
+  /// `Sgp41::GasIndexAlgorithm::bridge()`
+  Ramped,
+};
+
+struct Deviation {
+  double mean = 0;
+  i32 max = 0;
+
+  void add(i32 deviation) {
+    mean += std::abs(deviation);
+    max = std::max(max, std::abs(deviation));
+  }
+};
+
+struct Result {
+  Deviation voc;
+  Deviation nox;
+};
+
+/// Samples the trace every second while awake, then once per wakeup, and
+/// bridges the gaps like the firmware. The indices after every wakeup are
+/// compared to those of continuous sampling at that time.
+Result compare_to_continuous(std::vector<GasTraceSample> const& trace,
+                             u32 wakeup_period_s, Bridging bridging) {
+  Sgp41::GasIndexAlgorithm continuous, sleeping;
+  continuous.initialize(SamplingScheduler::SGP_READ_INTERVAL_MS / 1000.f);
+  sleeping.initialize(SamplingScheduler::SGP_READ_INTERVAL_MS / 1000.f);
+
+  Result result;
+  u32 wakeups = 0;
+  u32 last_sample_s = 0;
+  for (u32 t = 0; t < trace.size(); ++t) {
+    auto const& sample = trace[t];
+    auto expected = continuous.process(sample.sraw_voc, sample.sraw_nox);
+    if (t < AWAKE_S) {
+      sleeping.process(sample.sraw_voc, sample.sraw_nox);
+      last_sample_s = t;
+      continue;
+    }
+    if ((t - AWAKE_S) % wakeup_period_s != 0)
+      continue;
+
+    auto samples = SamplingScheduler::sgp_samples_for_gap(
+        static_cast<i64>(t - last_sample_s) * 1000);
+    last_sample_s = t;
+    Sgp41::Data actual;
+    switch (bridging) {
+    case Bridging::None:
+      actual = sleeping.process(sample.sraw_voc, sample.sraw_nox);
+      break;
+    case Bridging::Repeated:
+      for (u32 i = 0; i < samples; ++i)
+        actual = sleeping.process(sample.sraw_voc, sample.sraw_nox);
+      break;
+    case Bridging::Ramped:
+      actual = sleeping.bridge(sample.sraw_voc, sample.sraw_nox, samples);
+      break;
+    }
+
+    result.voc.add(actual.voc_index - expected.voc_index);
+    result.nox.add(actual.nox_index - expected.nox_index);
+    ++wakeups;
+  }
+  result.voc.mean /= wakeups;
+  result.nox.mean /= wakeups;
+  return result;
+}
+
+void print(char const* name, Result const& result) {
+  std::printf("  %-30s VOC %6.2f (max %3d), NOx %6.2f (max %3d)\n", name,
+              result.voc.mean, result.voc.max, result.nox.mean,
+              result.nox.max);
+}
+
+void compare_bridging(u32 wakeup_period_s) {
+  auto trace = synthetic_gas_trace(TRACE_S);
+  auto none = compare_to_continuous(trace, wakeup_period_s, Bridging::None);
+  auto repeated =
+      compare_to_continuous(trace, wakeup_period_s, Bridging::Repeated);
+  auto ramped = compare_to_continuous(trace, wakeup_period_s, Bridging::Ramped);
+
+  std::printf("Index deviation from continuous sampling, mean and max, waking "
+              "up every %lu s:\n",
+              static_cast<unsigned long>(wakeup_period_s));
+  print("not bridged", none);
+  print("measurement repeated (before)", repeated);
+  print("ramped from the previous one", ramped);
+  CHECK(ramped.voc.mean <= repeated.voc.mean);
+  CHECK(ramped.nox.mean <= repeated.nox.mean);
+  CHECK(ramped.voc.mean <= none.voc.mean);
+  CHECK(ramped.nox.mean <= none.nox.mean);
+}
+
+} // namespace
+
+/// The algorithm's expf calls are routed here (see CMakeLists.txt), and to
+/// `fast_math::expf()` in the firmware
+extern "C" float gas_index_test_expf(float x) { return fast_math::expf(x); }
+
+/// For `millis()` in util.cpp, which the scheduler's gap bridging doesn't use
+int64_t esp_timer_get_time() { return 0; }
+
+TEST(bridged_gaps_track_continuous_sampling) {
+  compare_bridging(WAKEUP_PERIOD_S);
+}
+
+TEST(bridged_gaps_track_continuous_sampling_on_low_battery) {
+  compare_bridging(LOW_BATTERY_WAKEUP_PERIOD_S);
+}
@@ -0,0 +1,315 @@
+// Drives `Scd41` against a simulated sensor on a simulated clock, to measure
+// how long its mode handling keeps the device awake until a measurement is
+// read, and how often it polls the sensor for it.
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <scd41.h>
+#include <scd4x_i2c.h>
+#include <sensirion_i2c_hal.h>
+#include <test.h>
+
+namespace {
+
+// Typical currents at 3.3 V, as in sampling_scheduler_simulation.cpp, in mA
+constexpr double SCD_PERIODIC_MA = 15;
+constexpr double WAKEUP_CPU_MA = 25;
+
+/// What the silent wakeup waited for before retrying a measurement that
+/// wasn't ready yet, before `Scd41::wait_for_data()`
+constexpr u32 LEGACY_RETRY_INTERVAL_MS = 5500;
+
+constexpr u16 MEASURE_SINGLE_SHOT = 0x219D;
+constexpr u16 MEASURE_SINGLE_SHOT_RHT_ONLY = 0x2196;
+
+std::atomic<i64> g_now_us = 0;
+
+/// Simulated SCD41. Its measurements take `clock_scale` times as long as
+/// specified, as the sensor runs on its own oscillator.
+class FakeScd41 {
+public:
+  void reset(double clock_scale) {
+    std::lock_guard lock(m_mutex);
+    m_clock_scale = clock_scale;
+    m_interval_us = 0;
+    m_next_measurement_us.reset();
+    m_data_ready = false;
+    m_polls = m_reads = m_missed = 0;
+  }
+
+  void start_periodic(u32 interval_ms) {
+    std::lock_guard lock(m_mutex);
+    m_interval_us = scaled_us(interval_ms);
+    m_next_measurement_us = g_now_us + m_interval_us;
+  }
+
+  void start_single_shot(u32 duration_ms) {
+    std::lock_guard lock(m_mutex);
+    m_interval_us = 0;
+    m_next_measurement_us = g_now_us + scaled_us(duration_ms);
+  }
+
+  void stop() {
+    std::lock_guard lock(m_mutex);
+    m_next_measurement_us.reset();
+    m_data_ready = false;
+  }
+
+  bool poll_data_ready() {
+    std::lock_guard lock(m_mutex);
+    update();
+    ++m_polls;
+    return m_data_ready;
+  }
+
+  void read() {
+    std::lock_guard lock(m_mutex);
+    update();
+    ++m_reads;
+    m_data_ready = false;
+  }
+
+  /// Data ready flag reads
+  u32 polls() const { return m_polls; }
+  u32 reads() const { return m_reads; }
+  /// Measurements replaced by the next one before they were read
+  u32 missed() const { return m_missed; }
+
+private:
+  std::mutex m_mutex;
+  double m_clock_scale = 1;
+  i64 m_interval_us = 0;
+  std::optional<i64> m_next_measurement_us;
+  bool m_data_ready = false;
+  u32 m_polls = 0;
+  u32 m_reads = 0;
+  u32 m_missed = 0;
+
+  i64 scaled_us(u32 ms) const {
+    return static_cast<i64>(ms * 1000 * m_clock_scale);
+  }
+
+  void update() {
+    while (m_next_measurement_us && *m_next_measurement_us <= g_now_us) {
+      m_missed += m_data_ready;
+      m_data_ready = true;
+      if (m_interval_us > 0)
+        *m_next_measurement_us += m_interval_us;
+      else
+        m_next_measurement_us.reset();
+    }
+  }
+};
+
+FakeScd41 g_sensor;
+
+/// Sleeps on the simulated clock
+bool wait(TickType_t ticks) {
+  g_now_us += static_cast<i64>(ticks) * 1000 / pdMS_TO_TICKS(1);
+  return false;
+}
+
+/// The bus the sensor is on. Never destroyed, as its arbiter task runs
+/// forever.
+I2cBus& bus() {
+  static auto* bus = new I2cBus(nullptr, "test", 1);
+  return *bus;
+}
+
+struct Wakeup {
+  i64 latency_ms;
+  u32 polls;
+
+  /// Charge the CPU and the sensor in periodic mode draw while awake
+  double charge_mas() const {
+    return (WAKEUP_CPU_MA + SCD_PERIODIC_MA) * latency_ms / 1000.;
+  }
+};
+
+/// Enters periodic mode after a deep sleep wakeup and reads the first
+/// measurement, like `perform_environment_check_with_notification_interrupt()`
+/// does and did before `wait_for_data()`.
+Wakeup silent_wakeup(double clock_scale, bool legacy) {
+  g_now_us = 0;
+  g_sensor.reset(clock_scale);
+  Scd41 scd(bus());
+  scd.set_mode(Scd41::Mode::Periodic);
+
+  Scd41::Data data;
+  if (legacy) {
+    while (scd.read(data) != Scd41::ReadResult::Ok)
+      wait(pdMS_TO_TICKS(LEGACY_RETRY_INTERVAL_MS));
+  } else {
+    while (scd.wait_for_data(wait) != Scd41::WaitResult::Ready ||
+           scd.read(data, false) != Scd41::ReadResult::Ok) {
+    }
+  }
+  return {.latency_ms = g_now_us / 1000, .polls = g_sensor.polls()};
+}
+
+/// Reads `count` measurements in `mode` like the environment task, from
+/// entering the mode or triggering the first single shot. Returns the time
+/// until the first valid measurement in ms.
+i64 read_measurements(Scd41::Mode mode, double clock_scale, u32 count) {
+  g_now_us = 0;
+  g_sensor.reset(clock_scale);
+  Scd41 scd(bus());
+  scd.set_mode(mode);
+
+  std::optional<i64> first_ms;
+  for (u32 valid = 0; valid < count;) {
+    if (mode == Scd41::Mode::SingleShot)
+      scd.measure_single_shot();
+    Scd41::Data data;
+    while (scd.wait_for_data(wait) != Scd41::WaitResult::Ready) {
+    }
+    auto result = scd.read(data, false);
+    // the discarded first single shot triggers its replacement
+    while (result == Scd41::ReadResult::Discarded) {
+      while (scd.wait_for_data(wait) != Scd41::WaitResult::Ready) {
+      }
+      result = scd.read(data, false);
+    }
+    if (result != Scd41::ReadResult::Ok)
+      continue;
+    if (!first_ms)
+      first_ms = g_now_us / 1000;
+    ++valid;
+  }
+  return *first_ms;
+}
+
+} // namespace
+
+int64_t esp_timer_get_time() { return g_now_us; }
+
+/// The bus is only used for the commands `Scd41` sends directly
+struct i2c_master_dev_t {};
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t,
+                                    i2c_device_config_t const*,
+                                    i2c_master_dev_handle_t* handle) {
+  *handle = new i2c_master_dev_t();
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t) { return ESP_OK; }
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t, uint8_t const* data,
+                              size_t length, int) {
+  auto command = length == 2 ? static_cast<u16>(data[0] << 8 | data[1]) : 0;
+  if (command == MEASURE_SINGLE_SHOT)
+    g_sensor.start_single_shot(Scd41::SINGLE_SHOT_DURATION_MS);
+  else if (command == MEASURE_SINGLE_SHOT_RHT_ONLY)
+    g_sensor.start_single_shot(Scd41::SINGLE_SHOT_RHT_ONLY_DURATION_MS);
+  else
+    return ESP_FAIL;
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t, uint8_t*, size_t, int) {
+  return ESP_FAIL;
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t,
+                                      uint8_t const*, size_t, uint8_t*,
+                                      size_t, int) {
+  return ESP_FAIL;
+}
+
+/// Like the HAL, registering the sensor again returns the existing device
+I2cDevice* sensirion_i2c_hal_init(I2cBus& bus, u16 address, char const* name,
+                                  u32 scl_speed_hz) {
+  static auto* device = bus.add_device(address, scl_speed_hz, name);
+  return device;
+}
+
+void scd4x_init(uint8_t) {}
+int16_t scd4x_wake_up() { return 0; }
+int16_t scd4x_reinit() { return 0; }
+int16_t scd4x_power_down() { return 0; }
+
+int16_t scd4x_stop_periodic_measurement() {
+  g_sensor.stop();
+  return 0;
+}
+
+int16_t scd4x_start_periodic_measurement() {
+  g_sensor.start_periodic(Scd41::PERIODIC_MEASUREMENT_INTERVAL_MS);
+  return 0;
+}
+
+int16_t scd4x_start_low_power_periodic_measurement() {
+  g_sensor.start_periodic(Scd41::LOW_POWER_PERIODIC_MEASUREMENT_INTERVAL_MS);
+  return 0;
+}
+
+int16_t scd4x_get_data_ready_status(bool* data_ready) {
+  *data_ready = g_sensor.poll_data_ready();
+  return 0;
+}
+
+int16_t scd4x_read_measurement(uint16_t* co2, int32_t* temperature_m_deg_c,
+                               int32_t* humidity_m_percent_rh) {
+  g_sensor.read();
+  *co2 = 800;
+  *temperature_m_deg_c = 21000;
+  *humidity_m_percent_rh = 45000;
+  return 0;
+}
+
+TEST(silent_wakeup_reads_the_first_measurement_when_it_is_due) {
+  std::printf(
+      "Silent wakeup until the first periodic measurement is read:\n"
+      "  sensor clock     before  polls   mAs      after  polls   mAs\n");
+  for (auto clock_scale : {0.98, 1.0, 1.02, 1.15}) {
+    auto before = silent_wakeup(clock_scale, true);
+    auto after = silent_wakeup(clock_scale, false);
+    std::printf("  %+11.0f%% %7lld ms %6lu %5.0f %7lld ms %6lu %5.0f\n",
+                (clock_scale - 1) * 100,
+                static_cast<long long>(before.latency_ms),
+                static_cast<unsigned long>(before.polls), before.charge_mas(),
+                static_cast<long long>(after.latency_ms),
+                static_cast<unsigned long>(after.polls), after.charge_mas());
+
+    auto due_ms = static_cast<i64>(Scd41::PERIODIC_MEASUREMENT_INTERVAL_MS *
+                                   clock_scale);
+    CHECK(after.latency_ms >= due_ms);
+    CHECK(after.latency_ms <=
+          std::max<i64>(due_ms + Scd41::DATA_READY_POLL_INTERVAL_MS,
+                        Scd41::PERIODIC_MEASUREMENT_INTERVAL_MS));
+    CHECK(after.latency_ms <= before.latency_ms);
+  }
+}
+
+TEST(periodic_reads_catch_every_measurement) {
+  constexpr u32 MEASUREMENTS = 200;
+  std::printf("Periodic mode, %lu measurements:\n"
+              "  sensor clock  polls per measurement  missed\n",
+              static_cast<unsigned long>(MEASUREMENTS));
+  for (auto clock_scale : {0.98, 1.0, 1.02}) {
+    read_measurements(Scd41::Mode::Periodic, clock_scale, MEASUREMENTS);
+    auto polls_per_read =
+        static_cast<double>(g_sensor.polls()) / g_sensor.reads();
+    std::printf("  %+11.0f%% %22.2f %7lu\n", (clock_scale - 1) * 100,
+                polls_per_read, static_cast<unsigned long>(g_sensor.missed()));
+    CHECK(g_sensor.missed() == 0);
+    CHECK(polls_per_read <= 3);
+  }
+}
+
+TEST(first_measurement_latency_per_mode) {
+  auto low_power = read_measurements(Scd41::Mode::LowPowerPeriodic, 1, 1);
+  auto single_shot = read_measurements(Scd41::Mode::SingleShot, 1, 1);
+  auto polls = g_sensor.polls();
+  std::printf("First measurement after entering the mode:\n"
+              "  low power periodic %6lld ms\n"
+              "  single shot        %6lld ms (first one discarded, "
+              "%lu polls)\n",
+              static_cast<long long>(low_power),
+              static_cast<long long>(single_shot),
+              static_cast<unsigned long>(polls));
+  CHECK(low_power == Scd41::LOW_POWER_PERIODIC_MEASUREMENT_INTERVAL_MS);
+  CHECK(single_shot == 2 * Scd41::SINGLE_SHOT_DURATION_MS);
+}
@@ -0,0 +1,32 @@
+#include "reference_crc8.h"
+#include <random>
+#include <sensirion_crc.h>
+#include <test.h>
+
+TEST(datasheet_example) {
+  // from the SCD41 and SGP41 datasheets
+  constexpr u8 WORD[] = {0xBE, 0xEF};
+  static_assert(sensirion::crc8(WORD, 2) == 0x92);
+}
+
+TEST(matches_reference_for_all_words) {
+  for (u32 word = 0; word <= 0xFFFF; ++word) {
+    u8 bytes[] = {static_cast<u8>(word >> 8), static_cast<u8>(word)};
+    if (sensirion::crc8(bytes, 2) != reference_crc8(bytes, 2)) {
+      CHECK(sensirion::crc8(bytes, 2) == reference_crc8(bytes, 2));
+      return;
+    }
+  }
+}
+
+TEST(matches_reference_for_longer_buffers) {
+  std::mt19937 random(3);
+  std::uniform_int_distribution<int> byte(0, 255);
+  for (size_t length = 0; length < 64; ++length) {
+    std::vector<u8> data(length);
+    for (auto& b : data)
+      b = static_cast<u8>(byte(random));
+    CHECK(sensirion::crc8(data.data(), data.size()) ==
+          reference_crc8(data.data(), data.size()));
+  }
+}
@@ -84,21 +84,20 @@ void free_ndef_record(NdefRecord record) { free(record.data); }
 
 } // namespace nfc
 
-void add_device(i2c_master_bus_handle_t i2c_handle, u16 address,
-                i2c_master_dev_handle_t* handle) {
-  i2c_device_config_t dev = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = address,
-      .scl_speed_hz = 400000,
-  };
-  ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_handle, &dev, handle));
+St25dv16kc::St25dv16kc(I2cBus& bus)
+    // memory writes are long and not time critical
+    : m_user_device(bus.add_device(USER_MEMORY_ADDRESS, 400000, "ST25DV user",
+                                   I2cPriority::Low)),
+      m_system_device(bus.add_device(SYSTEM_MEMORY_ADDRESS, 400000,
+                                     "ST25DV system", I2cPriority::Low)) {
+  m_initialized = initialize();
+  if (!m_initialized)
+    ESP_LOGE("ST25DV", "Initialization failed, retrying on the next write");
 }
 
-St25dv16kc::St25dv16kc(i2c_master_bus_handle_t i2c_handle) {
-  add_device(i2c_handle, USER_MEMORY_ADDRESS, &m_user_device);
-  add_device(i2c_handle, SYSTEM_MEMORY_ADDRESS, &m_system_device);
-
-  write(m_user_device, 0x00, CC_FILE, sizeof(CC_FILE));
+bool St25dv16kc::initialize() {
+  if (!write(m_user_device, 0x00, CC_FILE, sizeof(CC_FILE)))
+    return false;
   vTaskDelay(pdMS_TO_TICKS(50));
 
   // Execute present password command
@@ -107,41 +106,53 @@ St25dv16kc::St25dv16kc(i2c_master_bus_handle_t i2c_handle) {
   // By default, the password is 0.
   u8 password[8 * 2 + 1] = {0};
   password[8] = 0x9;
-  write(m_system_device, REG_SECURITY_PASSWORD_START, password, 17);
+  if (!write(m_system_device, REG_SECURITY_PASSWORD_START, password, 17))
+    return false;
 
   // u8 value = 0;
   // read(m_user_device, REG_SECURITY_SESSION_STATUS, &value, 1);
   // ESP_LOGI("ST25DV", "I2C session started: %s", value & 1 ? "yes :O" : "no
   // D:");
+  return true;
 }
 
-void St25dv16kc::write_ndef_record(nfc::NdefRecord record) {
+bool St25dv16kc::write_ndef_record(nfc::NdefRecord record) {
+  // the tag may have lost its session while it wasn't responding
+  auto reinitialize = m_user_device->take_reinitialization_request() |
+                      m_system_device->take_reinitialization_request();
+  if (!m_initialized || reinitialize)
+    m_initialized = initialize();
+  if (!m_initialized)
+    return false;
+
   for (size_t address = 0; address < record.length;
        address += MAX_WRITE_LENGTH) {
     auto bytes_to_write = std::min(MAX_WRITE_LENGTH, record.length - address);
     ESP_LOGI("ST25DV", "Writing %d..%d", address, address + bytes_to_write);
-    write(m_user_device, address + sizeof(CC_FILE), &record.data[address],
-          bytes_to_write);
+    if (!write(m_user_device, address + sizeof(CC_FILE),
+               &record.data[address], bytes_to_write)) {
+      return false;
+    }
     vTaskDelay(pdMS_TO_TICKS(50));
   }
+  return true;
 }
 
-void St25dv16kc::write(i2c_master_dev_handle_t device, u16 address,
+bool St25dv16kc::write(I2cDevice* device, u16 address,
                        u8 const* data, u16 length) {
   u8 buf[length + 2];
   buf[0] = address >> 8;
   buf[1] = address & 0xFF;
   memcpy(&buf[2], data, length);
 
-  ESP_ERROR_CHECK(
-      i2c_master_transmit(device, buf, sizeof(buf), I2C_TIMEOUT_MS));
+  return ESP_ERROR_CHECK_WITHOUT_ABORT(device->transmit(
+             buf, sizeof(buf), I2C_TIMEOUT_MS)) == ESP_OK;
 }
 
-void St25dv16kc::read(i2c_master_dev_handle_t device, u16 address, u8* data,
-                      u16 length) {
+bool St25dv16kc::read(I2cDevice* device, u16 address, u8* data, u16 length) {
   u8 buf[2];
   buf[0] = address >> 8;
   buf[1] = address & 0xFF;
-  ESP_ERROR_CHECK(i2c_master_transmit_receive(device, buf, sizeof(buf), data,
-                                              length, I2C_TIMEOUT_MS));
+  return ESP_ERROR_CHECK_WITHOUT_ABORT(device->transmit_receive(
+             buf, sizeof(buf), data, length, I2C_TIMEOUT_MS)) == ESP_OK;
 }
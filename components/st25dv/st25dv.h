@@ -1,6 +1,6 @@
 #pragma once
 
-#include <driver/i2c_master.h>
+#include <i2c_bus.h>
 #include <string>
 #include <types.h>
 
@@ -40,9 +40,10 @@ class St25dv16kc {
 public:
   static constexpr u32 I2C_TIMEOUT_MS = 50;
 
-  St25dv16kc(i2c_master_bus_handle_t i2c_handle);
+  St25dv16kc(I2cBus& bus);
 
-  void write_ndef_record(nfc::NdefRecord record);
+  /// Returns false on a bus error, the record may then be partially written.
+  bool write_ndef_record(nfc::NdefRecord record);
 
 private:
   static constexpr u16 USER_MEMORY_ADDRESS = st25dv::device_address(0, 1);
@@ -66,10 +67,14 @@ private:
       0xFF,       // memory size
   };
 
-  void write(i2c_master_dev_handle_t device, u16 address, u8 const* data,
-             u16 length);
-  void read(i2c_master_dev_handle_t device, u16 address, u8* data, u16 length);
+  /// Writes the capability container and opens the security session. Returns
+  /// false on a bus error.
+  bool initialize();
 
-  i2c_master_dev_handle_t m_user_device;
-  i2c_master_dev_handle_t m_system_device;
+  bool write(I2cDevice* device, u16 address, u8 const* data, u16 length);
+  bool read(I2cDevice* device, u16 address, u8* data, u16 length);
+
+  I2cDevice* m_user_device;
+  I2cDevice* m_system_device;
+  bool m_initialized = false;
 };
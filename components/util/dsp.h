@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <tuple>
+#include <types.h>
+
+/// Allocation-free filters for sensor channels.
+///
+/// Every filter has a `T process(T const& value)` function returning the
+/// filtered value and can be chained using `Pipeline`. `T` is either `float`
+/// or a type behaving like one under +, - and scalar *, e.g. `Vector3`.
+namespace dsp {
+
+/// First order low-pass filter (exponential moving average).
+template <typename T>
+class OnePole {
+public:
+  /// `gain` in (0; 1]. 1 passes the input through unchanged.
+  explicit OnePole(float gain)
+      : m_gain(gain) {}
+
+  void set_gain(float gain) { m_gain = gain; }
+
+  T process(T const& value) {
+    if (!m_initialized) {
+      m_initialized = true;
+      m_out = value;
+    } else {
+      m_out += (value - m_out) * m_gain;
+    }
+    return m_out;
+  }
+
+  T const& value() const { return m_out; }
+
+private:
+  float m_gain;
+  T m_out{};
+  bool m_initialized = false;
+};
+
+/// Normalized coefficients of a second order IIR filter (a0 = 1).
+struct BiquadCoefficients {
+  float b0, b1, b2;
+  float a1, a2;
+
+  /// Low-pass filter from the RBJ audio EQ cookbook. A `q` of 1/sqrt(2)
+  /// results in a Butterworth response.
+  static BiquadCoefficients low_pass(float cutoff_hz, float sample_rate_hz,
+                                     float q = M_SQRT1_2) {
+    auto w0 = 2.f * static_cast<float>(M_PI) * cutoff_hz / sample_rate_hz;
+    auto cos_w0 = cosf(w0);
+    auto alpha = sinf(w0) / (2.f * q);
+    auto a0 = 1.f + alpha;
+    return {
+        .b0 = (1.f - cos_w0) / 2.f / a0,
+        .b1 = (1.f - cos_w0) / a0,
+        .b2 = (1.f - cos_w0) / 2.f / a0,
+        .a1 = -2.f * cos_w0 / a0,
+        .a2 = (1.f - alpha) / a0,
+    };
+  }
+};
+
+/// Second order IIR filter in transposed direct form II.
+template <typename T>
+class Biquad {
+public:
+  explicit Biquad(BiquadCoefficients const& coefficients)
+      : m_c(coefficients) {}
+
+  T process(T const& value) {
+    T out = value * m_c.b0 + m_z1;
+    m_z1 = value * m_c.b1 - out * m_c.a1 + m_z2;
+    m_z2 = value * m_c.b2 - out * m_c.a2;
+    return out;
+  }
+
+private:
+  BiquadCoefficients m_c;
+  T m_z1{};
+  T m_z2{};
+};
+
+/// Median of the last `N` values, to reject single spikes. Until `N` values
+/// have been seen, the median of the available ones is returned.
+template <typename T, size_t N>
+class Median {
+  static_assert(N % 2 == 1, "N must be odd");
+
+public:
+  T process(T const& value) {
+    m_values[m_next] = value;
+    m_next = (m_next + 1) % N;
+    m_size = std::min(m_size + 1, N);
+
+    auto sorted = m_values;
+    std::sort(sorted.begin(), sorted.begin() + m_size);
+    return sorted[m_size / 2];
+  }
+
+private:
+  std::array<T, N> m_values{};
+  size_t m_next = 0;
+  size_t m_size = 0;
+};
+
+/// Mean of the last `N` values. Until `N` values have been seen, the mean of
+/// the available ones is returned.
+template <typename T, size_t N>
+class MovingAverage {
+public:
+  T process(T const& value) {
+    if (m_size == N) {
+      m_sum -= m_values[m_next];
+    } else {
+      ++m_size;
+    }
+    m_values[m_next] = value;
+    m_sum += value;
+    m_next = (m_next + 1) % N;
+    return m_sum * (1.f / m_size);
+  }
+
+private:
+  std::array<T, N> m_values{};
+  T m_sum{};
+  size_t m_next = 0;
+  size_t m_size = 0;
+};
+
+/// One-dimensional Kalman filter for a value modelled as a random walk. For
+/// vector types, all components share the same variances.
+template <typename T>
+class Kalman {
+public:
+  /// `process_variance` is how much the true value is expected to change per
+  /// unit of time, `measurement_variance` how noisy the measurements are
+  /// (both as variances, i.e. squared units).
+  Kalman(float process_variance, float measurement_variance)
+      : m_q(process_variance),
+        m_r(measurement_variance) {}
+
+  /// `dt` is the time since the previous measurement, in the unit of time
+  /// `process_variance` was given for. The longer it is, the more the true
+  /// value may have changed in the meantime and the more `value` is trusted.
+  T process(T const& value, float dt = 1.f) {
+    if (!m_initialized) {
+      m_initialized = true;
+      m_x = value;
+      m_p = m_r;
+      return m_x;
+    }
+
+    m_p += m_q * dt;
+    auto gain = m_p / (m_p + m_r);
+    m_x += (value - m_x) * gain;
+    m_p *= 1.f - gain;
+    return m_x;
+  }
+
+private:
+  float m_q;
+  float m_r;
+  T m_x{};
+  float m_p = 0;
+  bool m_initialized = false;
+};
+
+/// Runs a value through `Stages` in order.
+template <typename T, typename... Stages>
+class Pipeline {
+public:
+  explicit Pipeline(Stages... stages)
+      : m_stages(std::move(stages)...) {}
+
+  /// `args`, e.g. the `dt` of `Kalman`, are passed to the stages that take
+  /// them.
+  template <typename... Args>
+  T process(T value, Args const&... args) {
+    std::apply(
+        [&](auto&... stage) {
+          ((value = process_stage(stage, value, args...)), ...);
+        },
+        m_stages);
+    return value;
+  }
+
+  template <size_t I>
+  auto& stage() {
+    return std::get<I>(m_stages);
+  }
+
+private:
+  template <typename Stage, typename... Args>
+  static T process_stage(Stage& stage, T const& value, Args const&... args) {
+    if constexpr (requires { stage.process(value, args...); })
+      return stage.process(value, args...);
+    else
+      return stage.process(value);
+  }
+
+  std::tuple<Stages...> m_stages;
+};
+
+} // namespace dsp
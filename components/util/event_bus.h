@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <optional>
+#include <types.h>
+
+/// In-process publish/subscribe bus for small enum events.
+///
+/// Events don't carry a payload. Subscribers are expected to read the current
+/// state from wherever it lives (e.g. `Data`) when handling an event, which
+/// allows multiple pending instances of the same event to be coalesced into
+/// one.
+///
+/// Every subscriber owns a lock-free SPSC ring of event ids. Publishers are
+/// serialized by a short critical section, so from the ring's point of view
+/// there is only ever one producer. Publishing never blocks: if an event is
+/// already pending for a subscriber it is coalesced, and if a subscriber's ring
+/// is full, the event is remembered in an overflow mask and delivered once the
+/// ring has been drained. Both cases are counted per subscriber.
+///
+/// Tasks are notified outside of the critical section. Every subscriber counts
+/// the publishers that are about to notify its task, and `unsubscribe()`
+/// blocks on the subscriber's semaphore until the last of them is done.
+///
+/// `E` must be an enum whose values are in the range [0; 32).
+template <typename E, size_t MaxSubscribers = 8, size_t QueueLength = 16>
+class EventBus {
+  static_assert((QueueLength & (QueueLength - 1)) == 0,
+                "QueueLength must be a power of two");
+
+public:
+  using Mask = u32;
+
+  static constexpr Mask ALL_EVENTS = ~static_cast<Mask>(0);
+
+  static constexpr Mask mask(E event) {
+    return static_cast<Mask>(1) << static_cast<u32>(event);
+  }
+
+  template <typename... Es>
+  static constexpr Mask mask(E event, Es... events) {
+    return mask(event) | mask(events...);
+  }
+
+  EventBus() {
+    for (auto& s : m_subscribers)
+      s.m_released = xSemaphoreCreateBinaryStatic(&s.m_released_buffer);
+  }
+
+  class Subscriber {
+  public:
+    /// Returns the next pending event, or `std::nullopt` if there is none.
+    /// Must only be called from the subscribing task.
+    std::optional<E> poll() {
+      auto head = m_head.load(std::memory_order_relaxed);
+      if (head != m_tail.load(std::memory_order_acquire)) {
+        auto event = m_ring[head % QueueLength];
+        m_head.store(head + 1, std::memory_order_release);
+        m_pending.fetch_and(~mask(event), std::memory_order_acq_rel);
+        return event;
+      }
+
+      // events that didn't fit into the ring are delivered in order of their
+      // ids once the ring is empty
+      auto overflowed = m_overflowed.load(std::memory_order_acquire);
+      if (overflowed == 0)
+        return std::nullopt;
+
+      auto event = static_cast<E>(__builtin_ctz(overflowed));
+      m_overflowed.fetch_and(~mask(event), std::memory_order_acq_rel);
+      m_pending.fetch_and(~mask(event), std::memory_order_acq_rel);
+      return event;
+    }
+
+    char const* name() const { return m_name; }
+    /// Number of events that were merged into an already pending one.
+    u32 coalesced_count() const {
+      return m_coalesced.load(std::memory_order_relaxed);
+    }
+    /// Number of events that didn't fit into the ring.
+    u32 overflow_count() const {
+      return m_overflows.load(std::memory_order_relaxed);
+    }
+
+  private:
+    friend class EventBus;
+
+    bool m_in_use = false;
+    char const* m_name = nullptr;
+    Mask m_mask = 0;
+    TaskHandle_t m_task = nullptr;
+    u32 m_notification_bits = 0;
+
+    /// Publishers that have left the lock but haven't notified m_task yet.
+    /// Only accessed with the bus's lock held.
+    u32 m_notifying_publishers = 0;
+    /// Whether `unsubscribe()` waits for m_released
+    bool m_releasing = false;
+    /// Given by the last notifying publisher if m_releasing is set
+    SemaphoreHandle_t m_released = nullptr;
+    StaticSemaphore_t m_released_buffer;
+
+    std::array<E, QueueLength> m_ring{};
+    std::atomic<u32> m_head = 0;
+    std::atomic<u32> m_tail = 0;
+
+    /// Events currently either in the ring or in m_overflowed
+    std::atomic<Mask> m_pending = 0;
+    std::atomic<Mask> m_overflowed = 0;
+
+    std::atomic<u32> m_coalesced = 0;
+    std::atomic<u32> m_overflows = 0;
+  };
+
+  /// Registers a subscriber for the events in `mask`. Whenever a new event is
+  /// queued, `task` is notified by setting `notification_bits` in its
+  /// notification value. Returns `nullptr` if all subscriber slots are taken.
+  Subscriber* subscribe(char const* name, Mask mask,
+                        TaskHandle_t task = xTaskGetCurrentTaskHandle(),
+                        u32 notification_bits = 1) {
+    Subscriber* result = nullptr;
+    taskENTER_CRITICAL(&m_lock);
+    for (auto& s : m_subscribers) {
+      if (s.m_in_use)
+        continue;
+
+      s.m_name = name;
+      s.m_mask = mask;
+      s.m_task = task;
+      s.m_notification_bits = notification_bits;
+      s.m_head = s.m_tail.load();
+      s.m_pending = 0;
+      s.m_overflowed = 0;
+      s.m_in_use = true;
+      result = &s;
+      break;
+    }
+    taskEXIT_CRITICAL(&m_lock);
+    return result;
+  }
+
+  /// Removes the subscriber. Once this returns, no publisher notifies its task
+  /// anymore, so the task may delete itself.
+  void unsubscribe(Subscriber* subscriber) {
+    taskENTER_CRITICAL(&m_lock);
+    subscriber->m_in_use = false;
+    subscriber->m_task = nullptr;
+    // publishers notify outside of the lock, and may still hold the task
+    bool wait = subscriber->m_notifying_publishers != 0;
+    subscriber->m_releasing = wait;
+    taskEXIT_CRITICAL(&m_lock);
+
+    // blocks instead of spinning, as the publishers may have a lower priority
+    if (wait)
+      xSemaphoreTake(subscriber->m_released, portMAX_DELAY);
+  }
+
+  /// Queues `event` for every interested subscriber. Never blocks and must not
+  /// be called from an ISR.
+  void publish(E event) {
+    auto bit = mask(event);
+
+    struct Notification {
+      Subscriber* subscriber;
+      TaskHandle_t task;
+      u32 bits;
+    };
+    std::array<Notification, MaxSubscribers> notifications;
+    size_t notification_count = 0;
+
+    taskENTER_CRITICAL(&m_lock);
+    for (auto& s : m_subscribers) {
+      if (!s.m_in_use || (s.m_mask & bit) == 0)
+        continue;
+
+      if ((s.m_pending.fetch_or(bit, std::memory_order_acq_rel) & bit) != 0) {
+        s.m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+
+      auto tail = s.m_tail.load(std::memory_order_relaxed);
+      if (tail - s.m_head.load(std::memory_order_acquire) >= QueueLength) {
+        s.m_overflowed.fetch_or(bit, std::memory_order_acq_rel);
+        s.m_overflows.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        s.m_ring[tail % QueueLength] = event;
+        s.m_tail.store(tail + 1, std::memory_order_release);
+      }
+
+      if (s.m_task) {
+        ++s.m_notifying_publishers;
+        notifications[notification_count++] = {&s, s.m_task,
+                                                s.m_notification_bits};
+      }
+    }
+    taskEXIT_CRITICAL(&m_lock);
+
+    // notifying may cause a context switch, which is not allowed inside a
+    // critical section. The tasks can't be deleted before
+    // m_notifying_publishers drops to zero, even if they unsubscribe.
+    for (size_t i = 0; i < notification_count; ++i) {
+      xTaskNotify(notifications[i].task, notifications[i].bits, eSetBits);
+    }
+
+    std::array<SemaphoreHandle_t, MaxSubscribers> released;
+    size_t released_count = 0;
+    taskENTER_CRITICAL(&m_lock);
+    for (size_t i = 0; i < notification_count; ++i) {
+      auto* s = notifications[i].subscriber;
+      if (--s->m_notifying_publishers == 0 && s->m_releasing) {
+        s->m_releasing = false;
+        released[released_count++] = s->m_released;
+      }
+    }
+    taskEXIT_CRITICAL(&m_lock);
+    for (size_t i = 0; i < released_count; ++i)
+      xSemaphoreGive(released[i]);
+  }
+
+  /// Calls `f` with every active subscriber, e.g. to log its counters.
+  template <typename F>
+  void for_each_subscriber(F&& f) const {
+    for (auto const& s : m_subscribers) {
+      if (s.m_in_use)
+        f(s);
+    }
+  }
+
+private:
+  portMUX_TYPE m_lock = portMUX_INITIALIZER_UNLOCKED;
+  std::array<Subscriber, MaxSubscribers> m_subscribers{};
+};
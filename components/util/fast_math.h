@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <types.h>
+
+/// Single precision replacements for math library functions that are hot
+/// enough to matter on the ESP32-S3, whose FPU only supports `float`.
+
+namespace fast_math {
+
+namespace detail {
+
+/// 2^(i / 32)
+constexpr std::array<float, 32> EXP2_TABLE = {
+    1.000000000e+00f, 1.021897149e+00f, 1.044273782e+00f, 1.067140401e+00f,
+    1.090507733e+00f, 1.114386743e+00f, 1.138788635e+00f, 1.163724859e+00f,
+    1.189207115e+00f, 1.215247360e+00f, 1.241857812e+00f, 1.269050957e+00f,
+    1.296839555e+00f, 1.325236643e+00f, 1.354255547e+00f, 1.383909882e+00f,
+    1.414213562e+00f, 1.445180807e+00f, 1.476826146e+00f, 1.509164428e+00f,
+    1.542210825e+00f, 1.575980845e+00f, 1.610490332e+00f, 1.645755478e+00f,
+    1.681792831e+00f, 1.718619298e+00f, 1.756252160e+00f, 1.794709075e+00f,
+    1.834008086e+00f, 1.874167634e+00f, 1.915206561e+00f, 1.957144124e+00f,
+};
+
+} // namespace detail
+
+/// e^x with an error below 2 ulp, computed entirely in single precision.
+///
+/// x is split into k * ln(2) / 32 + r with |r| <= ln(2) / 64. e^x is then
+/// 2^(k / 32) (exponent bits and a table lookup) times e^r (a short
+/// polynomial). Results that would be subnormal are flushed to 0.
+inline float expf(float x) {
+  static constexpr float INV_LN2_32 = 32.f / static_cast<float>(M_LN2);
+  // ln(2) / 32 split into two parts, so k * LN2_32_HI is exact
+  static constexpr float LN2_32_HI = 0.693359375f / 32.f;
+  static constexpr float LN2_32_LO = -2.12194440e-4f / 32.f;
+  // ln(FLT_MAX) and ln(FLT_MIN). As floats, the former is rounded up and the
+  // latter down, so their results are infinite and subnormal respectively.
+  static constexpr float MAX_X = 88.72283905f;
+  static constexpr float MIN_X = -87.33654475f;
+
+  if (x > MAX_X)
+    return INFINITY;
+  if (x <= MIN_X)
+    return 0.f;
+  if (x != x)
+    return x;
+
+  auto k = static_cast<i32>(lrintf(x * INV_LN2_32));
+  auto r = (x - k * LN2_32_HI) - k * LN2_32_LO;
+
+  // Taylor series of e^r, the error is below r^4 / 24 < 6e-10
+  auto p = 1.f + r * (1.f + r * (0.5f + r * (1.f / 6.f)));
+
+  // 2^(k / 32) = 2^(k >> 5) * 2^((k & 31) / 32), the former being added to the
+  // exponent bits of the table entry
+  auto exponent = k >> 5;
+  // Close to MAX_X, k is 128 * 32, whose 2^128 has no exponent bits. The
+  // result is then built from half of it and doubled.
+  bool halve = exponent > 127;
+  auto scale = std::bit_cast<u32>(detail::EXP2_TABLE[k & 31]) +
+               (static_cast<u32>(exponent - halve) << 23);
+  auto result = std::bit_cast<float>(scale) * p;
+  return halve ? result * 2.f : result;
+}
+
+} // namespace fast_math
@@ -0,0 +1,80 @@
+#include "irq_source.h"
+#include <esp_attr.h>
+#include <esp_log.h>
+
+GpioIrqSource::GpioIrqSource(gpio_num_t pin, gpio_int_type_t type)
+    : m_pin(pin) {
+  gpio_config_t config = {
+      .pin_bit_mask = 1ULL << pin,
+      .mode = GPIO_MODE_INPUT,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = type,
+  };
+  ESP_ERROR_CHECK(gpio_config(&config));
+}
+
+void IRAM_ATTR GpioIrqSource::isr_handler(void* arg) {
+  auto* source = static_cast<GpioIrqSource*>(arg);
+  source->m_irq_count.fetch_add(1, std::memory_order_relaxed);
+
+  BaseType_t higher_priority_task_woken = pdFALSE;
+  xTaskNotifyFromISR(source->m_task, source->m_notification_bits, eSetBits,
+                     &higher_priority_task_woken);
+  portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+void GpioIrqSource::attach(TaskHandle_t task, u32 notification_bits) {
+  m_task = task;
+  m_notification_bits = notification_bits;
+  ESP_ERROR_CHECK(gpio_isr_handler_add(m_pin, isr_handler, this));
+}
+
+void GpioIrqSource::detach() {
+  if (!m_task)
+    return;
+  gpio_isr_handler_remove(m_pin);
+  m_task = nullptr;
+}
+
+SimulatedIrqSource::SimulatedIrqSource(u64 period_us)
+    : m_period_us(period_us) {
+  esp_timer_create_args_t const args = {
+      .callback =
+          [](void* arg) {
+            auto* source = static_cast<SimulatedIrqSource*>(arg);
+            source->m_irq_count.fetch_add(1, std::memory_order_relaxed);
+            xTaskNotify(source->m_task, source->m_notification_bits,
+                        eSetBits);
+          },
+      .arg = this,
+      .name = "sim irq",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&args, &m_timer));
+}
+
+SimulatedIrqSource::~SimulatedIrqSource() {
+  detach();
+  esp_timer_delete(m_timer);
+}
+
+void SimulatedIrqSource::attach(TaskHandle_t task, u32 notification_bits) {
+  m_task = task;
+  m_notification_bits = notification_bits;
+  ESP_ERROR_CHECK(esp_timer_start_periodic(m_timer, m_period_us));
+}
+
+void SimulatedIrqSource::detach() {
+  if (!m_task)
+    return;
+  esp_timer_stop(m_timer);
+  m_task = nullptr;
+}
+
+void SimulatedIrqSource::set_period(u64 period_us) {
+  m_period_us = period_us;
+  if (!m_task)
+    return;
+  esp_timer_stop(m_timer);
+  ESP_ERROR_CHECK(esp_timer_start_periodic(m_timer, m_period_us));
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <types.h>
+
+/// Something that signals a task when new data is available, by setting
+/// notification bits in the task's notification value.
+class IrqSource {
+public:
+  virtual ~IrqSource() = default;
+
+  /// Starts notifying `task` by setting `notification_bits` whenever the
+  /// interrupt fires.
+  virtual void attach(TaskHandle_t task, u32 notification_bits) = 0;
+  virtual void detach() = 0;
+
+  /// Number of times the interrupt fired since construction.
+  u32 irq_count() const { return m_irq_count.load(std::memory_order_relaxed); }
+
+protected:
+  TaskHandle_t m_task = nullptr;
+  u32 m_notification_bits = 0;
+  std::atomic<u32> m_irq_count = 0;
+};
+
+/// Interrupt from a GPIO pin, e.g. a sensor's data-ready or FIFO watermark
+/// output. Requires the GPIO ISR service to be installed.
+class GpioIrqSource : public IrqSource {
+public:
+  explicit GpioIrqSource(gpio_num_t pin,
+                         gpio_int_type_t type = GPIO_INTR_POSEDGE);
+  ~GpioIrqSource() override { detach(); }
+
+  void attach(TaskHandle_t task, u32 notification_bits) override;
+  void detach() override;
+
+private:
+  static void isr_handler(void* arg);
+
+  gpio_num_t const m_pin;
+};
+
+/// Fires periodically from an esp_timer instead of a pin. Used where no
+/// interrupt line is connected and to compare wake counts against the
+/// hardware interrupt.
+class SimulatedIrqSource : public IrqSource {
+public:
+  explicit SimulatedIrqSource(u64 period_us);
+  ~SimulatedIrqSource() override;
+
+  void attach(TaskHandle_t task, u32 notification_bits) override;
+  void detach() override;
+
+  /// Changes the period, e.g. when the simulated sensor's data rate changes.
+  /// Takes effect immediately if attached.
+  void set_period(u64 period_us);
+
+private:
+  u64 m_period_us;
+  esp_timer_handle_t m_timer = nullptr;
+};
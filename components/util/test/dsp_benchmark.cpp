@@ -0,0 +1,114 @@
+// Measures the time per sample of every filter stage and of the pipelines the
+// environment channels use, compared to the ad-hoc low-pass filter data.cpp
+// used before.
+
+#include <array>
+#include <benchmark.h>
+#include <dsp.h>
+#include <random>
+
+namespace {
+
+constexpr size_t SAMPLE_COUNT = 1024;
+constexpr long ITERATIONS = 20'000'000;
+
+/// The low-pass filter data.cpp used before the pipeline existed
+template <typename T>
+T low_pass_filter(T noisy_signal, T out, float gain = 0.1) {
+  return out + (noisy_signal - out) * gain;
+}
+
+template <typename T>
+std::array<T, SAMPLE_COUNT> noisy_samples(std::mt19937& random) {
+  std::normal_distribution<float> normal(0.f, 20.f);
+  std::array<T, SAMPLE_COUNT> samples;
+  for (auto& sample : samples) {
+    if constexpr (std::is_same_v<T, Vector3>)
+      sample = Vector3(normal(random), normal(random), normal(random));
+    else
+      sample = 800.f + normal(random);
+  }
+  return samples;
+}
+
+/// Runs every sample through `filter` and returns the time per sample in ns.
+/// The outputs are summed, so none of them can be optimized away.
+template <typename T, typename Filter>
+double ns_per_sample(std::array<T, SAMPLE_COUNT> const& samples,
+                     Filter&& filter) {
+  T sum{};
+  size_t i = 0;
+  auto ns = host_benchmark::ns_per_call(ITERATIONS, [&] {
+    sum += filter(samples[i++ % SAMPLE_COUNT]);
+  });
+  host_benchmark::keep(sum);
+  return ns;
+}
+
+} // namespace
+
+int main() {
+  using namespace host_benchmark;
+  std::mt19937 random(5);
+  auto const samples = noisy_samples<float>(random);
+  auto const vector_samples = noisy_samples<Vector3>(random);
+
+  float out = 0;
+  auto before_ns = ns_per_sample(samples, [&](float value) {
+    return out = low_pass_filter(value, out, 0.25f);
+  });
+
+  dsp::OnePole<float> one_pole(0.25f);
+  auto one_pole_ns = ns_per_sample(
+      samples, [&](float value) { return one_pole.process(value); });
+  dsp::Biquad<float> biquad(dsp::BiquadCoefficients::low_pass(2.f, 104.f));
+  auto biquad_ns = ns_per_sample(
+      samples, [&](float value) { return biquad.process(value); });
+  dsp::Median<float, 3> median3;
+  auto median3_ns = ns_per_sample(
+      samples, [&](float value) { return median3.process(value); });
+  dsp::Median<float, 5> median5;
+  auto median5_ns = ns_per_sample(
+      samples, [&](float value) { return median5.process(value); });
+  dsp::MovingAverage<float, 8> average;
+  auto average_ns = ns_per_sample(
+      samples, [&](float value) { return average.process(value); });
+  dsp::Kalman<float> kalman(100, 900);
+  auto kalman_ns = ns_per_sample(
+      samples, [&](float value) { return kalman.process(value); });
+
+  // `Data::Co2Filter`
+  dsp::Pipeline<float, dsp::Median<float, 3>, dsp::Kalman<float>> co2(
+      dsp::Median<float, 3>(), dsp::Kalman<float>(100, 900));
+  auto co2_ns = ns_per_sample(
+      samples, [&](float value) { return co2.process(value, 5.f); });
+
+  Vector3 vector_out;
+  auto vector_before_ns = ns_per_sample(vector_samples, [&](Vector3 value) {
+    return vector_out = low_pass_filter(value, vector_out, 0.25f);
+  });
+  dsp::OnePole<Vector3> vector_one_pole(0.25f);
+  auto vector_one_pole_ns = ns_per_sample(vector_samples, [&](Vector3 value) {
+    return vector_one_pole.process(value);
+  });
+  dsp::Biquad<Vector3> vector_biquad(
+      dsp::BiquadCoefficients::low_pass(2.f, 104.f));
+  auto vector_biquad_ns = ns_per_sample(vector_samples, [&](Vector3 value) {
+    return vector_biquad.process(value);
+  });
+
+  std::printf("Time per float sample:\n");
+  report("low_pass_filter() (before)", before_ns);
+  report("OnePole", one_pole_ns, before_ns);
+  report("Biquad", biquad_ns, before_ns);
+  report("Median<3>", median3_ns, before_ns);
+  report("Median<5>", median5_ns, before_ns);
+  report("MovingAverage<8>", average_ns, before_ns);
+  report("Kalman", kalman_ns, before_ns);
+  report("CO2 pipeline (Median<3>, Kalman)", co2_ns, before_ns);
+  std::printf("Time per Vector3 sample:\n");
+  report("low_pass_filter() (before)", vector_before_ns);
+  report("OnePole", vector_one_pole_ns, vector_before_ns);
+  report("Biquad", vector_biquad_ns, vector_before_ns);
+  return 0;
+}
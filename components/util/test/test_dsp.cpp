@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <dsp.h>
+#include <test.h>
+
+namespace {
+
+/// Feeds `filter` a single 0 and then `steps` 1s, returning the outputs for
+/// the 1s.
+template <typename Filter>
+std::vector<float> step_response(Filter& filter, size_t steps) {
+  filter.process(0.f);
+  std::vector<float> response;
+  for (size_t i = 0; i < steps; ++i)
+    response.push_back(filter.process(1.f));
+  return response;
+}
+
+} // namespace
+
+TEST(one_pole_step_response) {
+  constexpr float GAIN = 0.25f;
+  dsp::OnePole<float> filter(GAIN);
+  auto response = step_response(filter, 20);
+  for (size_t i = 0; i < response.size(); ++i)
+    CHECK_NEAR(response[i], 1.f - powf(1.f - GAIN, i + 1), 1e-6);
+}
+
+TEST(one_pole_starts_at_first_value) {
+  dsp::OnePole<Vector3> filter(0.1f);
+  CHECK(filter.process(Vector3(1, 2, 3)) == Vector3(1, 2, 3));
+}
+
+TEST(biquad_low_pass_step_response) {
+  // a Butterworth low-pass overshoots a step by 4.3 % and settles at 1
+  dsp::Biquad<float> filter(dsp::BiquadCoefficients::low_pass(2, 100));
+  auto response = step_response(filter, 500);
+  auto peak = *std::max_element(response.begin(), response.end());
+  CHECK_NEAR(peak, 1.043f, 0.005f);
+  CHECK_NEAR(response.back(), 1.f, 1e-4);
+  CHECK(response.front() < 0.01f);
+}
+
+TEST(median_rejects_single_spikes) {
+  dsp::Median<float, 3> filter;
+  CHECK(filter.process(1.f) == 1.f);
+  CHECK(filter.process(100.f) == 100.f);
+  CHECK(filter.process(1.f) == 1.f);
+  CHECK(filter.process(1.f) == 1.f);
+  CHECK(filter.process(-50.f) == 1.f);
+  CHECK(filter.process(2.f) == 1.f);
+}
+
+TEST(median_step_response) {
+  dsp::Median<float, 5> filter;
+  for (int i = 0; i < 5; ++i)
+    filter.process(0.f);
+  auto response = step_response(filter, 5);
+  CHECK(response == (std::vector<float>{0, 0, 1, 1, 1}));
+}
+
+TEST(moving_average_step_response) {
+  dsp::MovingAverage<float, 4> filter;
+  for (int i = 0; i < 4; ++i)
+    filter.process(0.f);
+  auto response = step_response(filter, 5);
+  for (size_t i = 0; i < response.size(); ++i)
+    CHECK_NEAR(response[i], std::min(i + 1, size_t(4)) / 4.f, 1e-6);
+}
+
+TEST(kalman_step_response) {
+  dsp::Kalman<float> filter(1, 100);
+  auto response = step_response(filter, 200);
+  CHECK(std::is_sorted(response.begin(), response.end()));
+  CHECK(response.front() > 0.f);
+  // once the error variance converged, the gain for q = 1, r = 100 is
+  // (q + sqrt(q^2 + 4qr)) / 2 / ((q + sqrt(q^2 + 4qr)) / 2 + r) = 0.0951
+  auto gain = (response[41] - response[40]) / (1.f - response[40]);
+  CHECK_NEAR(gain, 0.0951f, 1e-3);
+  CHECK_NEAR(response.back(), 1.f, 1e-3);
+}
+
+TEST(kalman_trusts_measurements_more_after_long_intervals) {
+  // same filter history, only the time before the step differs
+  dsp::Kalman<float> short_interval(1, 100);
+  dsp::Kalman<float> long_interval(1, 100);
+  for (int i = 0; i < 50; ++i) {
+    short_interval.process(0.f);
+    long_interval.process(0.f);
+  }
+  // gains of (9.5 + 1) / (9.5 + 1 + 100) and (9.5 + 12) / (9.5 + 12 + 100)
+  // with the converged error variance of 9.5
+  CHECK_NEAR(short_interval.process(1.f, 1.f), 0.0951f, 1e-3);
+  CHECK_NEAR(long_interval.process(1.f, 12.f), 0.1770f, 1e-3);
+
+  // a dt of 1 is the same as not passing one
+  dsp::Kalman<float> implicit_interval(1, 100);
+  dsp::Kalman<float> explicit_interval(1, 100);
+  for (float value : {0.f, 3.f, -1.f, 2.f}) {
+    CHECK(implicit_interval.process(value) ==
+          explicit_interval.process(value, 1.f));
+  }
+}
+
+TEST(pipeline_passes_interval_to_kalman) {
+  using Filter =
+      dsp::Pipeline<float, dsp::Median<float, 3>, dsp::Kalman<float>>;
+  Filter short_interval(dsp::Median<float, 3>(), dsp::Kalman<float>(1, 100));
+  Filter long_interval(dsp::Median<float, 3>(), dsp::Kalman<float>(1, 100));
+  for (int i = 0; i < 50; ++i) {
+    short_interval.process(0.f, 1.f);
+    long_interval.process(0.f, 1.f);
+  }
+  // the median needs two 1s to let the step through
+  short_interval.process(1.f, 1.f);
+  long_interval.process(1.f, 12.f);
+  CHECK(long_interval.process(1.f, 12.f) > short_interval.process(1.f, 1.f));
+}
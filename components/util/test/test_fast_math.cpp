@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cfloat>
+#include <fast_math.h>
+#include <test.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Largest error of `fast_math::expf()` the documentation allows for
+constexpr double MAX_ERROR_ULP = 2;
+
+struct SweepResult {
+  double max_error_ulp = 0;
+  float worst_x = 0;
+  u32 mismatches = 0;
+  float first_mismatch = 0;
+};
+
+/// Distance between `expected` and the next float of larger magnitude
+double ulp(double expected) {
+  auto f = static_cast<float>(expected);
+  return std::nextafter(f, INFINITY) - f;
+}
+
+/// Checks `fast_math::expf()` for every float whose bit pattern is in
+/// [`begin`; `end`).
+SweepResult sweep(u64 begin, u64 end) {
+  SweepResult result;
+  auto mismatch = [&](float x) {
+    if (result.mismatches++ == 0)
+      result.first_mismatch = x;
+  };
+
+  for (auto bits = begin; bits < end; ++bits) {
+    auto x = std::bit_cast<float>(static_cast<u32>(bits));
+    auto actual = fast_math::expf(x);
+
+    if (std::isnan(x)) {
+      if (!std::isnan(actual))
+        mismatch(x);
+      continue;
+    }
+
+    auto expected = std::exp(static_cast<double>(x));
+    if (std::isinf(static_cast<float>(expected))) {
+      if (actual != INFINITY)
+        mismatch(x);
+      continue;
+    }
+    if (expected < FLT_MIN) {
+      if (actual != 0.f)
+        mismatch(x);
+      continue;
+    }
+
+    auto error = std::fabs(actual - expected) / ulp(expected);
+    if (error > result.max_error_ulp) {
+      result.max_error_ulp = error;
+      result.worst_x = x;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(expf_boundaries) {
+  CHECK(fast_math::expf(0.f) == 1.f);
+  CHECK(fast_math::expf(INFINITY) == INFINITY);
+  CHECK(fast_math::expf(-INFINITY) == 0.f);
+  CHECK(std::isnan(fast_math::expf(NAN)));
+
+  // the largest float whose e^x is finite builds its scale from 2^128
+  auto max_finite_x = std::nextafter(88.72283905f, 0.f);
+  CHECK(std::isfinite(fast_math::expf(max_finite_x)));
+  CHECK_NEAR(fast_math::expf(max_finite_x), FLT_MAX, 1e-5 * FLT_MAX);
+  CHECK(fast_math::expf(88.72283905f) == INFINITY);
+
+  auto min_normal_x = std::nextafter(-87.33654475f, 0.f);
+  CHECK(fast_math::expf(min_normal_x) >= FLT_MIN);
+  CHECK(fast_math::expf(-87.33654475f) == 0.f);
+}
+
+TEST(expf_exhaustive) {
+  constexpr u64 FLOAT_COUNT = u64(1) << 32;
+  auto thread_count = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<SweepResult> results(thread_count);
+  std::vector<std::thread> threads;
+  for (u32 i = 0; i < thread_count; ++i) {
+    threads.emplace_back([&, i] {
+      results[i] = sweep(FLOAT_COUNT * i / thread_count,
+                         FLOAT_COUNT * (i + 1) / thread_count);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  SweepResult total;
+  for (auto const& result : results) {
+    if (result.max_error_ulp > total.max_error_ulp) {
+      total.max_error_ulp = result.max_error_ulp;
+      total.worst_x = result.worst_x;
+    }
+    if (result.mismatches > 0 && total.mismatches == 0)
+      total.first_mismatch = result.first_mismatch;
+    total.mismatches += result.mismatches;
+  }
+
+  std::printf("max error %.3f ulp at x = %.9g\n", total.max_error_ulp,
+              total.worst_x);
+  CHECK(total.max_error_ulp <= MAX_ERROR_ULP);
+  if (total.mismatches > 0) {
+    std::printf("%u overflows, underflows or NaNs handled wrong, e.g. x = "
+                "%.9g\n",
+                total.mismatches, total.first_mismatch);
+  }
+  CHECK(total.mismatches == 0);
+}
@@ -0,0 +1,113 @@
+#include <cmath>
+#include <random>
+#include <test.h>
+#include <vector_math.h>
+
+namespace {
+
+constexpr float TOLERANCE = 1e-5f;
+
+std::mt19937 g_random(1);
+
+Quaternion random_rotation() {
+  std::normal_distribution<float> normal;
+  return Quaternion(normal(g_random), normal(g_random), normal(g_random),
+                    normal(g_random))
+      .normalized();
+}
+
+Vector3 random_vector() {
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+  return Vector3(uniform(g_random), uniform(g_random), uniform(g_random));
+}
+
+Quaternion axis_angle(Vector3 axis, float angle) {
+  auto v = axis.normalized() * sinf(angle / 2.f);
+  return Quaternion(cosf(angle / 2.f), v.x, v.y, v.z);
+}
+
+void check_near(Vector3 const& actual, Vector3 const& expected) {
+  CHECK_NEAR(actual.x, expected.x, TOLERANCE);
+  CHECK_NEAR(actual.y, expected.y, TOLERANCE);
+  CHECK_NEAR(actual.z, expected.z, TOLERANCE);
+}
+
+void check_near(Matrix3 const& actual, Matrix3 const& expected) {
+  for (size_t i = 0; i < 3; ++i)
+    check_near(actual.rows[i], expected.rows[i]);
+}
+
+/// q and -q describe the same rotation
+void check_same_rotation(Quaternion const& actual, Quaternion const& expected) {
+  auto dot = actual.w * expected.w + actual.x * expected.x +
+             actual.y * expected.y + actual.z * expected.z;
+  CHECK_NEAR(fabsf(dot), 1.f, TOLERANCE);
+}
+
+} // namespace
+
+static_assert(Vector3(1, 0, 0).cross(Vector3(0, 1, 0)) == Vector3(0, 0, 1));
+static_assert(Vector3(1, 2, 3).dot(Vector3(4, 5, 6)) == 32);
+static_assert(Matrix3::identity() * Vector3(1, 2, 3) == Vector3(1, 2, 3));
+static_assert(Quaternion().rotate(Vector3(1, 2, 3)) == Vector3(1, 2, 3));
+
+TEST(matrix_round_trip) {
+  for (int i = 0; i < 1000; ++i) {
+    auto q = random_rotation();
+    auto m = q.to_rotation_matrix();
+    check_same_rotation(Quaternion::from_rotation_matrix(m), q);
+  }
+}
+
+TEST(matrix_round_trip_near_half_turns) {
+  // a trace <= 0 takes the branches keyed on the largest diagonal element
+  for (auto axis : {Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1),
+                    Vector3(1, 1, 0), Vector3(0, 1, 1), Vector3(1, 0, 1),
+                    Vector3(1, -2, 3)}) {
+    for (auto angle : {2.2f, 2.9f, 3.1f, static_cast<float>(M_PI)}) {
+      auto q = axis_angle(axis, angle);
+      check_same_rotation(
+          Quaternion::from_rotation_matrix(q.to_rotation_matrix()), q);
+    }
+  }
+}
+
+TEST(rotation_matrix_is_orthonormal) {
+  for (int i = 0; i < 100; ++i) {
+    auto m = random_rotation().to_rotation_matrix();
+    check_near(m * m.transposed(), Matrix3::identity());
+  }
+}
+
+TEST(rotate_matches_rotation_matrix) {
+  for (int i = 0; i < 1000; ++i) {
+    auto q = random_rotation();
+    auto v = random_vector();
+    check_near(q.rotate(v), q.to_rotation_matrix() * v);
+  }
+}
+
+TEST(conjugate_is_inverse) {
+  for (int i = 0; i < 100; ++i) {
+    auto q = random_rotation();
+    auto v = random_vector();
+    check_near(q.conjugate().rotate(q.rotate(v)), v);
+    check_same_rotation(q * q.conjugate(), Quaternion());
+  }
+}
+
+TEST(product_composes_rotations) {
+  for (int i = 0; i < 1000; ++i) {
+    auto a = random_rotation();
+    auto b = random_rotation();
+    auto v = random_vector();
+    check_near((a * b).rotate(v), a.rotate(b.rotate(v)));
+    check_near((a * b).to_rotation_matrix(),
+               a.to_rotation_matrix() * b.to_rotation_matrix());
+  }
+}
+
+TEST(normalized_zero_vector) {
+  CHECK(Vector3().normalized() == Vector3());
+  CHECK_NEAR(Vector3(3, 4, 0).normalized().length(), 1.f, TOLERANCE);
+}
@@ -0,0 +1,168 @@
+// Measures the per-sample vector math of the IMU update path with the current
+// vector types and with the `Vector3` they replaced, which copied itself
+// through user-defined constructors and returned a new vector from every
+// operator.
+
+#include <array>
+#include <benchmark.h>
+#include <dsp.h>
+#include <random>
+
+namespace {
+
+constexpr size_t SAMPLE_COUNT = 1024;
+constexpr long ITERATIONS = 20'000'000;
+
+/// `Vector3` as it was in types.h, including its compound assignments that
+/// don't modify the vector
+struct LegacyVector3 {
+  constexpr LegacyVector3(float x, float y, float z)
+      : x(x),
+        y(y),
+        z(z) {}
+
+  constexpr LegacyVector3(LegacyVector3 const& other)
+      : LegacyVector3(other.x, other.y, other.z) {}
+
+  constexpr LegacyVector3(LegacyVector3& other)
+      : LegacyVector3(other.x, other.y, other.z) {}
+
+  constexpr LegacyVector3(LegacyVector3&& other)
+      : LegacyVector3(other.x, other.y, other.z) {}
+
+  constexpr LegacyVector3(float v)
+      : LegacyVector3(v, v, v) {}
+
+  constexpr LegacyVector3()
+      : LegacyVector3(0) {}
+
+  constexpr LegacyVector3 operator=(LegacyVector3 const& other) {
+    this->x = other.x;
+    this->y = other.y;
+    this->z = other.z;
+    return *this;
+  }
+
+  constexpr LegacyVector3 operator+(LegacyVector3 const& other) {
+    return LegacyVector3(x + other.x, y + other.y, z + other.z);
+  }
+  constexpr LegacyVector3 operator-(LegacyVector3 const& other) {
+    return LegacyVector3(x - other.x, y - other.y, z - other.z);
+  }
+  constexpr LegacyVector3 operator*(float s) {
+    return LegacyVector3(x * s, y * s, z * s);
+  }
+  constexpr LegacyVector3 operator*(LegacyVector3 const& other) {
+    return LegacyVector3(x * other.x, y * other.y, z * other.z);
+  }
+
+  float x;
+  float y;
+  float z;
+};
+
+/// The low-pass filter data.cpp used, so both types run the same code
+template <typename T>
+T low_pass_filter(T noisy_signal, T out, float gain = 0.1) {
+  return out + (noisy_signal - out) * gain;
+}
+
+struct Sample {
+  Vector3 acc;
+  Vector3 gyro;
+  Vector3 mag;
+};
+
+std::array<Sample, SAMPLE_COUNT> random_samples() {
+  std::mt19937 random(4);
+  std::normal_distribution<float> normal;
+  auto vector = [&] {
+    return Vector3(normal(random), normal(random), normal(random));
+  };
+  std::array<Sample, SAMPLE_COUNT> samples;
+  for (auto& sample : samples)
+    sample = {.acc = vector(), .gyro = vector(), .mag = vector()};
+  return samples;
+}
+
+LegacyVector3 legacy(Vector3 const& v) { return LegacyVector3(v.x, v.y, v.z); }
+
+} // namespace
+
+int main() {
+  using namespace host_benchmark;
+  auto const samples = random_samples();
+  std::array<LegacyVector3, SAMPLE_COUNT * 3> legacy_samples;
+  for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+    legacy_samples[i * 3] = legacy(samples[i].acc);
+    legacy_samples[i * 3 + 1] = legacy(samples[i].gyro);
+    legacy_samples[i * 3 + 2] = legacy(samples[i].mag);
+  }
+
+  // the three low-pass filters and the hard and soft iron correction of the
+  // magnetometer, as data.cpp applied them per sample
+  LegacyVector3 legacy_acc, legacy_gyro, legacy_mag;
+  LegacyVector3 legacy_offset(-23.f, 41.f, 12.5f);
+  LegacyVector3 legacy_scale(1.1f, 0.9f, 1.f);
+  size_t i = 0;
+  auto legacy_ns = ns_per_call(ITERATIONS, [&] {
+    auto* sample = &legacy_samples[i++ % SAMPLE_COUNT * 3];
+    legacy_gyro = low_pass_filter(sample[1], legacy_gyro, 0.5);
+    legacy_acc = low_pass_filter(sample[0], legacy_acc, 0.8);
+    legacy_mag = low_pass_filter((sample[2] + legacy_offset) * legacy_scale,
+                                 legacy_mag, 0.25);
+  });
+  // every iteration depends on the previous one, so keeping the last results
+  // is enough and doesn't add stores to every iteration
+  keep(legacy_acc);
+  keep(legacy_gyro);
+  keep(legacy_mag);
+
+  Vector3 acc, gyro, mag;
+  auto offset = Vector3(-23.f, 41.f, 12.5f);
+  auto scale = Vector3(1.1f, 0.9f, 1.f);
+  i = 0;
+  auto current_ns = ns_per_call(ITERATIONS, [&] {
+    auto const& sample = samples[i++ % SAMPLE_COUNT];
+    gyro = low_pass_filter(sample.gyro, gyro, 0.5);
+    acc = low_pass_filter(sample.acc, acc, 0.8);
+    mag = low_pass_filter((sample.mag + offset) * scale, mag, 0.25);
+  });
+  keep(acc);
+  keep(gyro);
+  keep(mag);
+
+  // what data.cpp does now, with gains that can be rescaled per sample
+  dsp::OnePole<Vector3> acc_filter(0.8f), gyro_filter(0.5f), mag_filter(0.25f);
+  i = 0;
+  auto one_pole_ns = ns_per_call(ITERATIONS, [&] {
+    auto const& sample = samples[i++ % SAMPLE_COUNT];
+    gyro_filter.process(sample.gyro);
+    acc_filter.process(sample.acc);
+    mag_filter.process((sample.mag + offset) * scale);
+  });
+  keep(acc_filter.value());
+  keep(gyro_filter.value());
+  keep(mag_filter.value());
+
+  // used per sample by the orientation filter and the magnetometer calibration
+  auto q = Quaternion(0.8f, 0.2f, -0.4f, 0.4f).normalized();
+  i = 0;
+  auto rotate_ns = ns_per_call(ITERATIONS, [&] {
+    keep(q.rotate(samples[i++ % SAMPLE_COUNT].acc));
+  });
+  auto m = q.to_rotation_matrix();
+  i = 0;
+  auto matrix_ns = ns_per_call(ITERATIONS, [&] {
+    keep(m * samples[i++ % SAMPLE_COUNT].mag);
+  });
+
+  std::printf("Time per IMU sample:\n");
+  report("filters with LegacyVector3 (before)", legacy_ns);
+  report("filters with Vector3", current_ns, legacy_ns);
+  report("dsp::OnePole<Vector3>", one_pole_ns, legacy_ns);
+  std::printf("For comparison:\n");
+  report("Quaternion::rotate()", rotate_ns);
+  report("Matrix3 * Vector3", matrix_ns);
+  return 0;
+}
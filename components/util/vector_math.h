@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cmath>
+
+/// Small constexpr vector, quaternion and matrix types for the inertial
+/// measurement code.
+///
+/// All types are trivially copyable and 16-byte aligned with four float lanes
+/// (vectors carry an unused fourth lane that is always 0), so they can be
+/// loaded with single aligned 128-bit accesses and host compilers can keep
+/// them in SSE/NEON registers. The operations themselves only touch the lanes
+/// that are in use, which is what the ESP32-S3's scalar FPU wants: its PIE
+/// SIMD extension only operates on integers.
+
+struct alignas(16) Vector3 {
+  constexpr Vector3() = default;
+  constexpr Vector3(float x, float y, float z)
+      : x(x),
+        y(y),
+        z(z) {}
+  constexpr Vector3(float v)
+      : Vector3(v, v, v) {}
+
+  constexpr Vector3& operator+=(Vector3 const& other) {
+    x += other.x;
+    y += other.y;
+    z += other.z;
+    return *this;
+  }
+  constexpr Vector3& operator-=(Vector3 const& other) {
+    x -= other.x;
+    y -= other.y;
+    z -= other.z;
+    return *this;
+  }
+  /// Component-wise multiplication.
+  constexpr Vector3& operator*=(Vector3 const& other) {
+    x *= other.x;
+    y *= other.y;
+    z *= other.z;
+    return *this;
+  }
+  constexpr Vector3& operator*=(float s) {
+    x *= s;
+    y *= s;
+    z *= s;
+    return *this;
+  }
+  constexpr Vector3& operator/=(float s) { return *this *= 1.f / s; }
+
+  constexpr Vector3 operator-() const { return Vector3(-x, -y, -z); }
+
+  constexpr float dot(Vector3 const& other) const {
+    return x * other.x + y * other.y + z * other.z;
+  }
+  constexpr Vector3 cross(Vector3 const& other) const {
+    return Vector3(y * other.z - z * other.y, z * other.x - x * other.z,
+                   x * other.y - y * other.x);
+  }
+  constexpr float length_squared() const { return dot(*this); }
+  float length() const { return sqrtf(length_squared()); }
+  /// Returns the zero vector if the length is 0.
+  Vector3 normalized() const {
+    auto len_sq = length_squared();
+    return len_sq == 0.f ? Vector3() : *this * (1.f / sqrtf(len_sq));
+  }
+
+  constexpr bool operator==(Vector3 const& other) const {
+    return x == other.x && y == other.y && z == other.z;
+  }
+
+  friend constexpr Vector3 operator+(Vector3 a, Vector3 const& b) {
+    return a += b;
+  }
+  friend constexpr Vector3 operator-(Vector3 a, Vector3 const& b) {
+    return a -= b;
+  }
+  friend constexpr Vector3 operator*(Vector3 a, Vector3 const& b) {
+    return a *= b;
+  }
+  friend constexpr Vector3 operator*(Vector3 a, float s) { return a *= s; }
+  friend constexpr Vector3 operator*(float s, Vector3 a) { return a *= s; }
+  friend constexpr Vector3 operator/(Vector3 a, float s) { return a /= s; }
+
+  float x = 0;
+  float y = 0;
+  float z = 0;
+
+private:
+  /// Pads the vector to four lanes.
+  float m_unused = 0;
+};
+
+static_assert(sizeof(Vector3) == 16);
+
+/// 3x3 matrix, stored as rows.
+struct alignas(16) Matrix3 {
+  static constexpr Matrix3 identity() {
+    return Matrix3(Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1));
+  }
+  static constexpr Matrix3 diagonal(Vector3 const& d) {
+    return Matrix3(Vector3(d.x, 0, 0), Vector3(0, d.y, 0), Vector3(0, 0, d.z));
+  }
+
+  constexpr Matrix3() = default;
+  constexpr Matrix3(Vector3 const& row0, Vector3 const& row1,
+                    Vector3 const& row2)
+      : rows{row0, row1, row2} {}
+
+  constexpr Matrix3 transposed() const {
+    return Matrix3(Vector3(rows[0].x, rows[1].x, rows[2].x),
+                   Vector3(rows[0].y, rows[1].y, rows[2].y),
+                   Vector3(rows[0].z, rows[1].z, rows[2].z));
+  }
+
+  constexpr Vector3 operator*(Vector3 const& v) const {
+    return Vector3(rows[0].dot(v), rows[1].dot(v), rows[2].dot(v));
+  }
+  constexpr Matrix3 operator*(Matrix3 const& other) const {
+    auto t = other.transposed();
+    return Matrix3(t * rows[0], t * rows[1], t * rows[2]);
+  }
+
+  Vector3 rows[3];
+};
+
+/// Unit quaternion describing a rotation.
+struct alignas(16) Quaternion {
+  /// Returns the rotation described by the orthonormal matrix `m`.
+  static Quaternion from_rotation_matrix(Matrix3 const& m) {
+    auto const& [r0, r1, r2] = m.rows;
+    auto trace = r0.x + r1.y + r2.z;
+    if (trace > 0.f) {
+      auto s = 0.5f / sqrtf(trace + 1.f);
+      return Quaternion(0.25f / s, (r2.y - r1.z) * s, (r0.z - r2.x) * s,
+                        (r1.x - r0.y) * s);
+    }
+    if (r0.x > r1.y && r0.x > r2.z) {
+      auto s = 2.f * sqrtf(1.f + r0.x - r1.y - r2.z);
+      return Quaternion((r2.y - r1.z) / s, 0.25f * s, (r0.y + r1.x) / s,
+                        (r0.z + r2.x) / s);
+    }
+    if (r1.y > r2.z) {
+      auto s = 2.f * sqrtf(1.f + r1.y - r0.x - r2.z);
+      return Quaternion((r0.z - r2.x) / s, (r0.y + r1.x) / s, 0.25f * s,
+                        (r1.z + r2.y) / s);
+    }
+    auto s = 2.f * sqrtf(1.f + r2.z - r0.x - r1.y);
+    return Quaternion((r1.x - r0.y) / s, (r0.z + r2.x) / s, (r1.z + r2.y) / s,
+                      0.25f * s);
+  }
+
+  constexpr Quaternion() = default;
+  constexpr Quaternion(float w, float x, float y, float z)
+      : w(w),
+        x(x),
+        y(y),
+        z(z) {}
+
+  constexpr Quaternion conjugate() const { return Quaternion(w, -x, -y, -z); }
+
+  constexpr float norm_squared() const {
+    return w * w + x * x + y * y + z * z;
+  }
+  Quaternion normalized() const {
+    auto s = 1.f / sqrtf(norm_squared());
+    return Quaternion(w * s, x * s, y * s, z * s);
+  }
+
+  /// Hamilton product, i.e. the rotation `other` followed by this one.
+  constexpr Quaternion operator*(Quaternion const& other) const {
+    return Quaternion(w * other.w - x * other.x - y * other.y - z * other.z,
+                      w * other.x + x * other.w + y * other.z - z * other.y,
+                      w * other.y - x * other.z + y * other.w + z * other.x,
+                      w * other.z + x * other.y - y * other.x + z * other.w);
+  }
+
+  constexpr Matrix3 to_rotation_matrix() const {
+    return Matrix3(Vector3(1.f - 2.f * (y * y + z * z), 2.f * (x * y - w * z),
+                           2.f * (x * z + w * y)),
+                   Vector3(2.f * (x * y + w * z), 1.f - 2.f * (x * x + z * z),
+                           2.f * (y * z - w * x)),
+                   Vector3(2.f * (x * z - w * y), 2.f * (y * z + w * x),
+                           1.f - 2.f * (x * x + y * y)));
+  }
+
+  /// Rotates `v` by this quaternion, which must be normalized.
+  constexpr Vector3 rotate(Vector3 const& v) const {
+    // v + 2w (u x v) + 2 u x (u x v), with u being the vector part
+    auto u = Vector3(x, y, z);
+    auto t = u.cross(v) * 2.f;
+    return v + t * w + u.cross(t);
+  }
+
+  float w = 1;
+  float x = 0;
+  float y = 0;
+  float z = 0;
+};
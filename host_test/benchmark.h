@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+/// Helpers for the host benchmarks. They are built like the tests, but aren't
+/// registered with CTest and only print their timings.
+///
+/// Host timings only show the relative cost of the variants a benchmark
+/// compares. The ESP32-S3 runs at 240 MHz without SIMD floats, so the absolute
+/// numbers on the device are a lot higher.
+
+namespace host_benchmark {
+
+/// Keeps the compiler from optimizing away the computation of `value`.
+template <typename T>
+inline void keep(T const& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Calls `f` `iterations` times and returns the average time per call in ns.
+template <typename F>
+double ns_per_call(long iterations, F&& f) {
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  for (long i = 0; i < iterations; ++i)
+    f();
+  auto elapsed = Clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         iterations;
+}
+
+/// Prints one result, aligned with the other ones.
+inline void report(char const* name, double ns, double baseline_ns = 0) {
+  if (baseline_ns > 0)
+    std::printf("  %-40s %9.2f ns (%.2fx)\n", name, ns, ns / baseline_ns);
+  else
+    std::printf("  %-40s %9.2f ns\n", name, ns);
+}
+
+} // namespace host_benchmark
@@ -0,0 +1,59 @@
+#pragma once
+
+// LVGL configuration of the host tests. The firmware configures LVGL through
+// the CONFIG_LV_* options in sdkconfig, these mirror the ones that change
+// what is rendered or how much memory it takes. Everything else keeps LVGL's
+// defaults, as in sdkconfig.
+
+#define LV_COLOR_DEPTH 16
+#define LV_DRAW_SW_SUPPORT_RGB565_SWAPPED 1
+
+#define LV_USE_STDLIB_MALLOC LV_STDLIB_BUILTIN
+#define LV_USE_STDLIB_STRING LV_STDLIB_BUILTIN
+#define LV_USE_STDLIB_SPRINTF LV_STDLIB_BUILTIN
+#define LV_MEM_SIZE (64 * 1024U)
+
+#define LV_DEF_REFR_PERIOD 33
+#define LV_DPI_DEF 130
+
+#define LV_USE_OS LV_OS_NONE
+
+#define LV_DRAW_BUF_STRIDE_ALIGN 1
+#define LV_DRAW_BUF_ALIGN 4
+#define LV_DRAW_LAYER_SIMPLE_BUF_SIZE (24 * 1024)
+#define LV_DRAW_SW_DRAW_UNIT_CNT 1
+#define LV_DRAW_SW_COMPLEX 1
+#define LV_DRAW_SW_SHADOW_CACHE_SIZE 0
+#define LV_DRAW_SW_CIRCLE_CACHE_SIZE 4
+
+#define LV_USE_LOG 0
+#define LV_USE_ASSERT_NULL 1
+#define LV_USE_ASSERT_MALLOC 1
+
+#define LV_CACHE_DEF_SIZE 0
+#define LV_IMAGE_HEADER_CACHE_DEF_CNT 0
+#define LV_GRADIENT_MAX_STOPS 2
+#define LV_COLOR_MIX_ROUND_OFS 128
+#define LV_USE_FLOAT 1
+
+#define LV_FONT_MONTSERRAT_14 0
+#define LV_FONT_MONTSERRAT_16 1
+#define LV_FONT_MONTSERRAT_20 1
+#define LV_FONT_MONTSERRAT_24 1
+#define LV_FONT_MONTSERRAT_32 1
+#define LV_FONT_MONTSERRAT_40 1
+#define LV_FONT_DEFAULT &lv_font_montserrat_20
+#define LV_USE_FONT_PLACEHOLDER 1
+
+#define LV_TXT_ENC LV_TXT_ENC_UTF8
+
+#define LV_USE_THEME_DEFAULT 1
+#define LV_THEME_DEFAULT_DARK 1
+#define LV_THEME_DEFAULT_GROW 1
+#define LV_THEME_DEFAULT_TRANSITION_TIME 80
+
+#define LV_USE_FLEX 1
+#define LV_USE_GRID 1
+#define LV_USE_OBSERVER 1
+
+#define LV_BUILD_EXAMPLES 0
@@ -0,0 +1,12 @@
+#include "test.h"
+
+int main() {
+  for (auto const& test : host_test::test_cases()) {
+    auto failures_before = host_test::failure_count();
+    test.run();
+    std::printf("%s %s\n",
+                host_test::failure_count() == failures_before ? "PASS" : "FAIL",
+                test.name);
+  }
+  return host_test::failure_count() == 0 ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <esp_err.h>
+
+// Stand-in for ESP-IDF's I2C master driver. The functions are defined by the
+// test, e.g. to simulate devices.
+
+struct i2c_master_bus_t;
+struct i2c_master_dev_t;
+using i2c_master_bus_handle_t = i2c_master_bus_t*;
+using i2c_master_dev_handle_t = i2c_master_dev_t*;
+
+enum i2c_addr_bit_len_t {
+  I2C_ADDR_BIT_LEN_7,
+  I2C_ADDR_BIT_LEN_10,
+};
+
+struct i2c_device_config_t {
+  i2c_addr_bit_len_t dev_addr_length;
+  uint16_t device_address;
+  uint32_t scl_speed_hz;
+};
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus,
+                                    i2c_device_config_t const* config,
+                                    i2c_master_dev_handle_t* handle);
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus);
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t device,
+                              uint8_t const* data, size_t length,
+                              int timeout_ms);
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t device, uint8_t* data,
+                             size_t length, int timeout_ms);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t device,
+                                      uint8_t const* tx_data,
+                                      size_t tx_length, uint8_t* rx_data,
+                                      size_t rx_length, int timeout_ms);
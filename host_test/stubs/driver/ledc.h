@@ -0,0 +1,24 @@
+#pragma once
+
+// Stand-in for ESP-IDF's LEDC driver, declaring the values constants.h uses
+// for the buzzer
+
+enum ledc_mode_t {
+  LEDC_LOW_SPEED_MODE,
+};
+
+enum ledc_timer_bit_t {
+  LEDC_TIMER_13_BIT = 13,
+};
+
+enum ledc_timer_t {
+  LEDC_TIMER_0,
+};
+
+enum ledc_clk_cfg_t {
+  LEDC_AUTO_CLK,
+};
+
+enum ledc_channel_t {
+  LEDC_CHANNEL_0,
+};
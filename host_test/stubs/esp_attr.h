@@ -0,0 +1,3 @@
+#pragma once
+
+#define RTC_DATA_ATTR
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+using esp_err_t = int;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_TIMEOUT 0x107
+
+inline char const* esp_err_to_name(esp_err_t error) {
+  switch (error) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  }
+  return "UNKNOWN ERROR";
+}
+
+#define ESP_ERROR_CHECK(x)                                                     \
+  do {                                                                         \
+    esp_err_t err_ = (x);                                                      \
+    if (err_ != ESP_OK) {                                                      \
+      std::printf("%s:%d: %s failed: %s\n", __FILE__, __LINE__, #x,            \
+                  esp_err_to_name(err_));                                      \
+      std::abort();                                                            \
+    }                                                                          \
+  } while (0)
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) (x)
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+/// Defined by the test, e.g. to return a simulated time
+int64_t esp_timer_get_time();
@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <freertos/timers.h>
+#include <new>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+Clock::time_point const g_start = Clock::now();
+
+/// Waits on `cv` until `ready` returns true or `ticks` have passed. Returns
+/// whether `ready` returned true.
+template <typename F>
+bool wait_for(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+              TickType_t ticks, F&& ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+Clock::time_point tick_time(TickType_t tick) {
+  return g_start + std::chrono::milliseconds(tick);
+}
+
+} // namespace
+
+struct HostTask {
+  char name[16] = {};
+  std::mutex mutex;
+  std::condition_variable notified;
+  uint32_t notification_value = 0;
+};
+
+struct HostQueue {
+  std::mutex mutex;
+  std::condition_variable changed;
+  size_t length;
+  size_t item_size;
+  std::deque<std::vector<unsigned char>> items;
+};
+
+struct HostSemaphore {
+  std::mutex mutex;
+  std::condition_variable given;
+  UBaseType_t count = 0;
+  bool is_static = false;
+  bool is_mutex = false;
+  std::thread::id holder;
+  /// Takes by the holder that haven't been given back yet
+  UBaseType_t depth = 0;
+};
+
+static_assert(sizeof(HostSemaphore) <= sizeof(StaticSemaphore_t));
+
+struct HostTimer {
+  char const* name;
+  TickType_t period;
+  bool auto_reload;
+  TimerCallbackFunction_t callback;
+  bool active = false;
+  TickType_t expiry = 0;
+};
+
+struct HostEventGroup {
+  std::mutex mutex;
+  std::condition_variable changed;
+  EventBits_t bits = 0;
+};
+
+namespace {
+
+/// Tasks are never freed, as FreeRTOS keeps their handles valid until they
+/// are deleted
+thread_local HostTask* t_current_task = nullptr;
+
+struct TaskStart {
+  TaskFunction_t function;
+  void* arg;
+  HostTask* task;
+};
+
+HostTask* new_task(char const* name) {
+  auto* task = new HostTask();
+  strncpy(task->name, name, sizeof(task->name) - 1);
+  return task;
+}
+
+/// State of the timer service. Never destroyed, as its task waits on it until
+/// the process exits.
+struct TimerService {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<HostTimer*> timers;
+};
+
+TimerService& g_service = *new TimerService();
+
+/// Calls the callbacks of expired timers, in the order of their expiry
+void timer_service_task(void*) {
+  std::unique_lock lock(g_service.mutex);
+  while (true) {
+    auto& timers = g_service.timers;
+    auto next = std::min_element(
+        timers.begin(), timers.end(), [](HostTimer* a, HostTimer* b) {
+          return a->active && (!b->active || a->expiry < b->expiry);
+        });
+    if (next == timers.end() || !(*next)->active) {
+      g_service.changed.wait(lock);
+      continue;
+    }
+
+    auto* timer = *next;
+    if (g_service.changed.wait_until(lock, tick_time(timer->expiry)) !=
+        std::cv_status::timeout) {
+      // the timer may have been changed or deleted
+      continue;
+    }
+    if (!timer->active || xTaskGetTickCount() < timer->expiry)
+      continue;
+
+    timer->active = timer->auto_reload;
+    timer->expiry += timer->period;
+    auto callback = timer->callback;
+    // the callback may change or delete timers itself
+    lock.unlock();
+    callback(timer);
+    lock.lock();
+  }
+}
+
+void start_timer_service() {
+  static bool started = [] {
+    xTaskCreate(timer_service_task, "Tmr Svc", 0, nullptr, 0, nullptr);
+    return true;
+  }();
+  (void)started;
+}
+
+} // namespace
+
+BaseType_t xTaskCreate(TaskFunction_t function, char const* name, uint32_t,
+                       void* arg, UBaseType_t, TaskHandle_t* handle) {
+  auto* task = new_task(name);
+  std::thread thread(
+      [](TaskStart start) {
+        t_current_task = start.task;
+        start.function(start.arg);
+      },
+      TaskStart{function, arg, task});
+  if (handle)
+    *handle = task;
+  thread.detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task != nullptr && task != xTaskGetCurrentTaskHandle()) {
+    std::printf("vTaskDelete: host tasks can only delete themselves\n");
+    std::abort();
+  }
+  pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               g_start)
+      .count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!t_current_task)
+    t_current_task = new_task("host");
+  return t_current_task;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+  if (!task)
+    task = xTaskGetCurrentTaskHandle();
+  return static_cast<HostTask*>(task)->name;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value,
+                       eNotifyAction action) {
+  auto* task = static_cast<HostTask*>(handle);
+  std::lock_guard lock(task->mutex);
+  switch (action) {
+  case eNoAction:
+    break;
+  case eSetBits:
+    task->notification_value |= value;
+    break;
+  case eIncrement:
+    ++task->notification_value;
+    break;
+  case eSetValueWithOverwrite:
+    task->notification_value = value;
+    break;
+  }
+  task->notified.notify_all();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+  auto* task = static_cast<HostTask*>(xTaskGetCurrentTaskHandle());
+  std::unique_lock lock(task->mutex);
+  wait_for(task->notified, lock, ticks,
+           [&] { return task->notification_value != 0; });
+  auto value = task->notification_value;
+  if (value != 0)
+    task->notification_value = clear_on_exit ? 0 : value - 1;
+  return value;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  auto* queue = new HostQueue();
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, void const* item, TickType_t ticks) {
+  std::unique_lock lock(queue->mutex);
+  if (!wait_for(queue->changed, lock, ticks,
+                [&] { return queue->items.size() < queue->length; })) {
+    return pdFALSE;
+  }
+  auto const* bytes = static_cast<unsigned char const*>(item);
+  queue->items.emplace_back(bytes, bytes + queue->item_size);
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+  std::unique_lock lock(queue->mutex);
+  if (!wait_for(queue->changed, lock, ticks,
+                [&] { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->item_size);
+  queue->items.pop_front();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore(); }
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer) {
+  auto* semaphore = new (buffer->storage) HostSemaphore();
+  semaphore->is_static = true;
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  auto* mutex = new HostSemaphore();
+  mutex->is_mutex = true;
+  mutex->count = 1;
+  return mutex;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  if (semaphore->is_static)
+    semaphore->~HostSemaphore();
+  else
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  std::unique_lock lock(semaphore->mutex);
+  if (!wait_for(semaphore->given, lock, ticks,
+                [&] { return semaphore->count > 0; })) {
+    return pdFALSE;
+  }
+  --semaphore->count;
+  if (semaphore->is_mutex) {
+    semaphore->holder = std::this_thread::get_id();
+    semaphore->depth = 1;
+  }
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  if (semaphore->is_mutex)
+    return xSemaphoreGiveRecursive(semaphore);
+
+  std::lock_guard lock(semaphore->mutex);
+  if (semaphore->count > 0)
+    return pdFALSE;
+  semaphore->count = 1;
+  semaphore->given.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+  std::lock_guard lock(semaphore->mutex);
+  return semaphore->count;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks) {
+  {
+    std::lock_guard lock(mutex->mutex);
+    if (mutex->depth > 0 && mutex->holder == std::this_thread::get_id()) {
+      ++mutex->depth;
+      return pdTRUE;
+    }
+  }
+  return xSemaphoreTake(mutex, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) {
+  std::lock_guard lock(mutex->mutex);
+  if (mutex->depth == 0 || mutex->holder != std::this_thread::get_id())
+    return pdFALSE;
+  if (--mutex->depth == 0) {
+    mutex->holder = {};
+    mutex->count = 1;
+    mutex->given.notify_all();
+  }
+  return pdTRUE;
+}
+
+TimerHandle_t xTimerCreate(char const* name, TickType_t period,
+                           UBaseType_t auto_reload, void*,
+                           TimerCallbackFunction_t callback) {
+  start_timer_service();
+  auto* timer = new HostTimer{
+      .name = name,
+      .period = period,
+      .auto_reload = auto_reload != pdFALSE,
+      .callback = callback,
+  };
+  std::lock_guard lock(g_service.mutex);
+  g_service.timers.push_back(timer);
+  return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t) {
+  std::lock_guard lock(g_service.mutex);
+  timer->active = true;
+  timer->expiry = xTaskGetTickCount() + timer->period;
+  g_service.changed.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t) {
+  std::lock_guard lock(g_service.mutex);
+  timer->active = false;
+  g_service.changed.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period,
+                              TickType_t ticks) {
+  {
+    std::lock_guard lock(g_service.mutex);
+    timer->period = period;
+  }
+  return xTimerStart(timer, ticks);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t) {
+  std::lock_guard lock(g_service.mutex);
+  auto& timers = g_service.timers;
+  timers.erase(std::find(timers.begin(), timers.end(), timer));
+  delete timer;
+  g_service.changed.notify_all();
+  return pdPASS;
+}
+
+TickType_t xTimerGetExpiryTime(TimerHandle_t timer) {
+  std::lock_guard lock(g_service.mutex);
+  return timer->expiry;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+  std::lock_guard lock(g_service.mutex);
+  return timer->active;
+}
+
+EventGroupHandle_t xEventGroupCreate() { return new HostEventGroup(); }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard lock(group->mutex);
+  group->bits |= bits;
+  group->changed.notify_all();
+  return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard lock(group->mutex);
+  auto before = group->bits;
+  group->bits &= ~bits;
+  return before;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks) {
+  std::unique_lock lock(group->mutex);
+  auto satisfied = [&] {
+    return wait_for_all ? (group->bits & bits) == bits
+                        : (group->bits & bits) != 0;
+  };
+  auto result = wait_for(group->changed, lock, ticks, satisfied);
+  auto value = group->bits;
+  if (result && clear_on_exit)
+    group->bits &= ~bits;
+  return value;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// Stand-in for the parts of FreeRTOS the host builds use, implemented on top of
+// the standard library in freertos.cpp. Ticks are milliseconds, as with
+// CONFIG_FREERTOS_HZ=1000.
+
+using TickType_t = uint32_t;
+using BaseType_t = int;
+using UBaseType_t = unsigned int;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portMAX_DELAY static_cast<TickType_t>(0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) static_cast<TickType_t>(ms)
+#define pdTICKS_TO_MS(ticks) static_cast<TickType_t>(ticks)
+
+/// Critical sections only exclude each other, as host threads can't disable
+/// preemption.
+struct portMUX_TYPE {
+  std::recursive_mutex mutex;
+};
+#define portMUX_INITIALIZER_UNLOCKED                                           \
+  {}
+#define taskENTER_CRITICAL(mux) (mux)->mutex.lock()
+#define taskEXIT_CRITICAL(mux) (mux)->mutex.unlock()
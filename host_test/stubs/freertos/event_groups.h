@@ -0,0 +1,14 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+struct HostEventGroup;
+using EventGroupHandle_t = HostEventGroup*;
+using EventBits_t = uint32_t;
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks);
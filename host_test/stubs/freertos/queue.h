@@ -0,0 +1,12 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+// as in FreeRTOS
+#include <freertos/task.h>
+
+struct HostQueue;
+using QueueHandle_t = HostQueue*;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, void const* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <freertos/FreeRTOS.h>
+
+struct HostSemaphore;
+using SemaphoreHandle_t = HostSemaphore*;
+
+/// Storage for a `HostSemaphore`
+struct StaticSemaphore_t {
+  alignas(std::max_align_t) unsigned char storage[128];
+};
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore);
+
+/// Mutexes remember the thread holding them, which may take them again with
+/// `xSemaphoreTakeRecursive()`. Either give function gives back one take.
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
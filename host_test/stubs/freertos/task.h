@@ -0,0 +1,29 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+using TaskFunction_t = void (*)(void*);
+using TaskHandle_t = void*;
+
+enum eNotifyAction {
+  eNoAction,
+  eSetBits,
+  eIncrement,
+  eSetValueWithOverwrite,
+};
+
+/// Runs `task` on a detached thread. Priorities and stack sizes are ignored.
+BaseType_t xTaskCreate(TaskFunction_t task, char const* name, uint32_t stack,
+                       void* arg, UBaseType_t priority, TaskHandle_t* handle);
+/// Only a task can delete itself, which ends its thread.
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+/// Milliseconds since the program started
+TickType_t xTaskGetTickCount();
+/// Threads that weren't created by `xTaskCreate()`, e.g. the test's main
+/// thread, are tasks as well.
+TaskHandle_t xTaskGetCurrentTaskHandle();
+char* pcTaskGetName(TaskHandle_t task);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value,
+                       eNotifyAction action);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
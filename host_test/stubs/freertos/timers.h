@@ -0,0 +1,21 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+struct HostTimer;
+using TimerHandle_t = HostTimer*;
+using TimerCallbackFunction_t = void (*)(TimerHandle_t);
+
+/// Callbacks run on a single timer service thread, like FreeRTOS's timer task.
+/// Commands take effect immediately instead of being queued to it.
+TimerHandle_t xTimerCreate(char const* name, TickType_t period,
+                           UBaseType_t auto_reload, void* id,
+                           TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks);
+/// Also starts the timer if it is dormant, as in FreeRTOS
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period,
+                              TickType_t ticks);
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks);
+TickType_t xTimerGetExpiryTime(TimerHandle_t timer);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
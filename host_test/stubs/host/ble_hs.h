@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+// Stand-in for NimBLE, declaring what ble_peripheral_manager.h needs to
+// compile. The host tests never start Bluetooth, so nothing is defined.
+
+#define BLE_HS_FOREVER INT32_MAX
+
+#define BLE_UUID_TYPE_128 128
+
+struct ble_uuid_t {
+  uint8_t type;
+};
+
+struct ble_uuid128_t {
+  ble_uuid_t u;
+  uint8_t value[16];
+};
+
+#define BLE_UUID128_INIT(uuid128...)                                           \
+  {                                                                            \
+    .u = {.type = BLE_UUID_TYPE_128}, .value = {uuid128},                      \
+  }
+
+struct ble_gap_event;
+struct ble_gatt_access_ctxt;
+
+using ble_gatt_access_fn = int(uint16_t conn_handle, uint16_t attr_handle,
+                               ble_gatt_access_ctxt* ctxt, void* arg);
+using ble_gatt_chr_flags = uint16_t;
+
+#define BLE_GATT_SVC_TYPE_PRIMARY 1
+
+#define BLE_GATT_CHR_F_READ 0x0002
+#define BLE_GATT_CHR_F_WRITE_NO_RSP 0x0004
+#define BLE_GATT_CHR_F_WRITE 0x0008
+#define BLE_GATT_CHR_F_WRITE_ENC 0x1000
+
+struct ble_gatt_chr_def {
+  ble_uuid_t const* uuid;
+  ble_gatt_access_fn* access_cb;
+  void* arg;
+  void* descriptors;
+  ble_gatt_chr_flags flags;
+  uint8_t min_key_size;
+  uint16_t* val_handle;
+};
+
+struct ble_gatt_svc_def {
+  uint8_t type;
+  ble_uuid_t const* uuid;
+  ble_gatt_svc_def const** includes;
+  ble_gatt_chr_def const* characteristics;
+};
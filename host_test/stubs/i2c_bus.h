@@ -0,0 +1,4 @@
+#pragma once
+
+class I2cBus;
+class I2cDevice;
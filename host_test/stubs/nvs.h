@@ -0,0 +1,15 @@
+#pragma once
+
+#include <esp_err.h>
+
+// Stand-in for ESP-IDF's NVS library. There is no flash on the host, entries
+// are kept in memory by `nvs::NVSHandle` (see nvs_handle.hpp).
+
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+enum nvs_open_mode_t {
+  NVS_READONLY,
+  NVS_READWRITE,
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <nvs.h>
+#include <string>
+#include <vector>
+
+namespace nvs {
+
+enum class ItemType {
+  BLOB,
+  ANY,
+};
+
+/// Entries of all namespaces, for as long as the test runs
+inline std::map<std::string, std::vector<unsigned char>>& host_entries() {
+  static std::map<std::string, std::vector<unsigned char>> entries;
+  return entries;
+}
+
+/// Stores items as the bytes of their value, like blobs
+class NVSHandle {
+public:
+  explicit NVSHandle(char const* ns)
+      : m_namespace(ns) {}
+
+  template <typename T>
+  esp_err_t set_item(char const* key, T value) {
+    return set_blob(key, &value, sizeof(T));
+  }
+
+  template <typename T>
+  esp_err_t get_item(char const* key, T& value) {
+    return get_blob(key, &value, sizeof(T));
+  }
+
+  esp_err_t set_blob(char const* key, void const* blob, size_t length) {
+    auto const* bytes = static_cast<unsigned char const*>(blob);
+    host_entries()[entry(key)].assign(bytes, bytes + length);
+    return ESP_OK;
+  }
+
+  esp_err_t get_blob(char const* key, void* blob, size_t length) {
+    auto it = host_entries().find(entry(key));
+    if (it == host_entries().end())
+      return ESP_ERR_NVS_NOT_FOUND;
+    if (it->second.size() != length)
+      return ESP_FAIL;
+    memcpy(blob, it->second.data(), length);
+    return ESP_OK;
+  }
+
+  esp_err_t get_item_size(ItemType, char const* key, size_t& size) {
+    auto it = host_entries().find(entry(key));
+    if (it == host_entries().end())
+      return ESP_ERR_NVS_NOT_FOUND;
+    size = it->second.size();
+    return ESP_OK;
+  }
+
+  esp_err_t erase_item(char const* key) {
+    return host_entries().erase(entry(key)) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+  }
+
+  esp_err_t commit() { return ESP_OK; }
+
+private:
+  std::string m_namespace;
+
+  std::string entry(char const* key) const { return m_namespace + "/" + key; }
+};
+
+inline std::unique_ptr<NVSHandle>
+open_nvs_handle(char const* ns, nvs_open_mode_t, esp_err_t* err = nullptr) {
+  if (err)
+    *err = ESP_OK;
+  return std::make_unique<NVSHandle>(ns);
+}
+
+} // namespace nvs
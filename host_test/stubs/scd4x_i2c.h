@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Stand-in for the vendored SCD4x driver, declaring the commands `Scd41` uses.
+// The functions are defined by the test, e.g. to simulate the sensor.
+
+void scd4x_init(uint8_t i2c_address);
+int16_t scd4x_wake_up();
+int16_t scd4x_stop_periodic_measurement();
+int16_t scd4x_reinit();
+int16_t scd4x_start_periodic_measurement();
+int16_t scd4x_start_low_power_periodic_measurement();
+int16_t scd4x_get_data_ready_status(bool* data_ready);
+int16_t scd4x_read_measurement(uint16_t* co2, int32_t* temperature_m_deg_c,
+                               int32_t* humidity_m_percent_rh);
+int16_t scd4x_power_down();
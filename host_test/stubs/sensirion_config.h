@@ -0,0 +1,5 @@
+#pragma once
+
+// Stand-in for the vendored Sensirion driver configuration
+#include <cstdint>
+#include <cstdlib>
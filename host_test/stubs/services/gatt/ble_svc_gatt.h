@@ -0,0 +1,3 @@
+#pragma once
+
+// Stand-in for NimBLE, see host/ble_hs.h
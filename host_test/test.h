@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/// Minimal test registry for the host tests. Every test file is linked with
+/// main.cpp into its own executable, which runs all `TEST`s it contains and
+/// fails if any check failed.
+
+namespace host_test {
+
+struct TestCase {
+  char const* name;
+  void (*run)();
+};
+
+inline std::vector<TestCase>& test_cases() {
+  static std::vector<TestCase> cases;
+  return cases;
+}
+
+inline int& failure_count() {
+  static int count = 0;
+  return count;
+}
+
+struct Registration {
+  Registration(char const* name, void (*run)()) {
+    test_cases().push_back({name, run});
+  }
+};
+
+inline void fail(char const* file, int line, char const* message) {
+  std::printf("%s:%d: check failed: %s\n", file, line, message);
+  ++failure_count();
+}
+
+} // namespace host_test
+
+#define TEST(name)                                                             \
+  static void test_##name();                                                   \
+  static host_test::Registration const registration_##name(#name,              \
+                                                           test_##name);       \
+  static void test_##name()
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition))                                                          \
+      host_test::fail(__FILE__, __LINE__, #condition);                         \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                \
+  do {                                                                         \
+    double actual_ = (actual);                                                 \
+    double expected_ = (expected);                                             \
+    double tolerance_ = (tolerance);                                           \
+    if (!(std::fabs(actual_ - expected_) <= tolerance_)) {                     \
+      std::printf("%s:%d: %s = %g, expected %g +- %g\n", __FILE__, __LINE__,   \
+                  #actual, actual_, expected_, tolerance_);                    \
+      ++host_test::failure_count();                                            \
+    }                                                                          \
+  } while (0)
@@ -10,7 +10,6 @@
 #include <wifi_manager.h>
 
 #include <data.h>
-#include <esp_event.h>
 
 char const* addr_str(u8* addr) {
   // 2 chars * 6 fields + 5x ':' + \0
@@ -142,8 +141,7 @@ void BlePeripheralManager::start(u32 advertisement_duration_ms) {
 
   lock();
 
-  esp_event_post(DATA_EVENT_BASE, Data::Event::BluetoothEnabled, NULL, 0,
-                 portMAX_DELAY);
+  Data::publish(Data::Event::BluetoothEnabled);
 
   ESP_LOGI("BLE", "Bluetooth enabled. Advertising for %ld ms...",
            advertisement_duration_ms);
@@ -165,8 +163,7 @@ void BlePeripheralManager::stop() {
   m_started = false;
   unlock();
 
-  esp_event_post(DATA_EVENT_BASE, Data::Event::BluetoothDisabled, NULL, 0,
-                 portMAX_DELAY);
+  Data::publish(Data::Event::BluetoothDisabled);
 
   ESP_LOGI("BLE", "Bluetooth disabled!");
 }
@@ -243,8 +240,7 @@ int BlePeripheralManager::on_gap_event(ble_gap_event* event, void* arg) {
       ESP_LOGI("BLE", "Connection established!");
       m_connected = true;
 
-      esp_event_post(DATA_EVENT_BASE, Data::Event::BluetoothConnected, NULL, 0,
-                     portMAX_DELAY);
+      Data::publish(Data::Event::BluetoothConnected);
       break;
     }
 
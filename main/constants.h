@@ -8,6 +8,22 @@
 #define BASE_PATH "/home"
 
 #define USING_CUSTOM_PCB true
+/// Sensor interrupt lines are only connected on the custom PCB. Otherwise, the
+/// sensor tasks are woken by a timer instead.
+#define SIMULATE_SENSOR_INTERRUPTS !USING_CUSTOM_PCB
+/// Detect the set-down gesture with the LSM6DSOX's tap recognition instead of
+/// in software. Requires the sensor's INT2 line.
+#define HARDWARE_SET_DOWN_GESTURE false
+/// Keep the set-down gesture recognition running during deep sleep and wake
+/// up when it is detected. Requires HARDWARE_SET_DOWN_GESTURE.
+#define SET_DOWN_GESTURE_DEEP_SLEEP_WAKEUP false
+
+#if HARDWARE_SET_DOWN_GESTURE && !USING_CUSTOM_PCB
+#error "The hardware set-down gesture requires the custom PCB's LSM_INT2 line"
+#endif
+#if SET_DOWN_GESTURE_DEEP_SLEEP_WAKEUP && !HARDWARE_SET_DOWN_GESTURE
+#error "SET_DOWN_GESTURE_DEEP_SLEEP_WAKEUP requires HARDWARE_SET_DOWN_GESTURE"
+#endif
 
 static constexpr u32 DEEP_SLEEP_DISPLAY_INACTIVITY_MS = 60 * 1000;
 
@@ -81,6 +97,10 @@ static constexpr gpio_num_t DP_SCK = GPIO_NUM_13;
 static constexpr gpio_num_t DP_MOSI = GPIO_NUM_17;
 static constexpr gpio_num_t DP_MISO = GPIO_NUM_12;
 static constexpr gpio_num_t DP_TOUCH_INT = GPIO_NUM_14;
+
+static constexpr gpio_num_t LSM_INT1 = GPIO_NUM_5;
+static constexpr gpio_num_t LSM_INT2 = GPIO_NUM_4;
+static constexpr gpio_num_t LIS_INT = GPIO_NUM_6;
 #else
 static constexpr gpio_num_t BATTERY_READ_PIN = GPIO_NUM_1;
 
@@ -102,7 +122,13 @@ static constexpr u16 DP_V_RES = 240;
 static constexpr u16 DP_CMD_BIT_WIDTH = 8;
 static constexpr u16 DP_PARAM_BIT_WIDTH = 8;
 static constexpr u32 DP_PIXEL_CLOCK = 20 * 1000 * 1000; // 20 MHz
-static constexpr size_t LVGL_DRAW_BUF_LINES = 100;
+/// The ESP32-S3's SPI DMA moves at most 32 KiB per transaction. 60 lines
+/// (28.8 KiB) fit any part of a flush into a single transaction and split a
+/// full screen into 4 equal flushes.
+static constexpr size_t LVGL_DRAW_BUF_LINES = 60;
+static constexpr size_t LVGL_DRAW_BUF_SIZE =
+    DP_H_RES * LVGL_DRAW_BUF_LINES * sizeof(u16);
+static_assert(LVGL_DRAW_BUF_SIZE <= 32 * 1024);
 
 constexpr ledc_mode_t BUZZER_LEDC_MODE = LEDC_LOW_SPEED_MODE;
 constexpr ledc_timer_bit_t BUZZER_LEDC_DUTY_RES = LEDC_TIMER_13_BIT;
@@ -114,7 +140,13 @@ static constexpr u32 MISC_TASK_PRIORITY = 0;
 static constexpr u32 ENV_TASK_PRIORITY = 1;
 static constexpr u32 BATTERY_TASK_PRIORITY = 1;
 static constexpr u32 LVGL_TASK_PRIORITY = 2;
+// Sends the bands of a flushed draw buffer while LVGL renders into the other
+// one, so it has to preempt LVGL as soon as a band has been transferred.
+static constexpr u32 DISPLAY_FLUSH_TASK_PRIORITY = LVGL_TASK_PRIORITY + 1;
 // This needs to be greater than or equal to LVGL's priority, since we need to
 // be executed periodically while LVGL is running to properly detect gestures.
 static constexpr u32 LSM_TASK_PRIORITY = LVGL_TASK_PRIORITY;
+// The I2C arbiter only runs while transactions are pending, and all sensor
+// tasks wait for it.
+static constexpr u32 I2C_BUS_TASK_PRIORITY = LSM_TASK_PRIORITY + 1;
 static constexpr u32 BEGIN_DEEP_SLEEP_PRIORITY = 10;
@@ -23,8 +23,7 @@ void UserTimer::recover(int original_duration, int remaining_duration) {
       m_timer = NULL;
     }
 
-    esp_event_post(DATA_EVENT_BASE, Data::Event::UserTimerExpired, NULL, 0,
-                   portMAX_DELAY);
+    Data::publish(Data::Event::UserTimerExpired);
     return;
   }
 
@@ -36,8 +35,7 @@ void UserTimer::start(int duration) {
   if (!m_timer) {
     m_timer =
         xTimerCreate("User Timer", 1, false, NULL, [](TimerHandle_t timer) {
-          esp_event_post(DATA_EVENT_BASE, Data::Event::UserTimerExpired, NULL,
-                         0, 10);
+          Data::publish(Data::Event::UserTimerExpired);
 
           // make sure to not block timer callback on Data mutex acquisition
           xTaskCreate(
@@ -51,10 +49,10 @@ void UserTimer::start(int duration) {
 
   xTimerStop(m_timer, portMAX_DELAY);
   xTimerChangePeriod(m_timer, pdMS_TO_TICKS(duration), portMAX_DELAY);
-  esp_event_post(DATA_EVENT_BASE, Data::Event::UserTimerStarted, &duration,
-                 sizeof(duration), portMAX_DELAY);
 
+  // subscribers read the duration back from the timer
   m_original_duration = duration;
+  Data::publish(Data::Event::UserTimerStarted);
 }
 
 void UserTimer::resume() const {
@@ -144,22 +142,97 @@ void initialize_nvs_flash() {
   ESP_LOGI("Data", "NVS successfully initialized");
 }
 
-ESP_EVENT_DEFINE_BASE(DATA_EVENT_BASE);
-
-template <typename T>
-T low_pass_filter(T noisy_signal, T out, float gain = 0.1) {
-  return out + (noisy_signal - out) * gain;
-}
-
 Mutex<Data>::Guard Data::the() {
   static Mutex<Data> data = Data();
   return data.lock();
 }
 
+Data::EventBus& Data::events() {
+  static EventBus bus;
+  return bus;
+}
+
+/// Bit in the environment data event group that is set once environment data
+/// has been published for the first time.
+constexpr EventBits_t ENVIRONMENT_DATA_AVAILABLE_BIT = 0x01;
+
+static EventGroupHandle_t environment_data_event_group() {
+  static EventGroupHandle_t event_group = xEventGroupCreate();
+  return event_group;
+}
+
+void Data::wait_for_environment_data() {
+  xEventGroupWaitBits(environment_data_event_group(),
+                      ENVIRONMENT_DATA_AVAILABLE_BIT, false, true,
+                      portMAX_DELAY);
+}
+
+/// Layout of the magnetometer calibration in the preferences.
+struct RawMagnetometerCalibration {
+  float offset[3];
+  float scale[3];
+};
+
 void Data::initialize() {
   m_muted =
       Preferences::instance().get_bool(PREFERENCES_IS_MUTED).value_or(false);
 
+  auto mag_calibration =
+      Preferences::instance().get_blob<RawMagnetometerCalibration>(
+          PREFERENCES_MAG_CALIBRATION);
+  if (mag_calibration) {
+    auto const& [offset, scale] = *mag_calibration;
+    m_mag_calibration = {
+        .offset = Vector3(offset[0], offset[1], offset[2]),
+        .scale = Vector3(scale[0], scale[1], scale[2]),
+    };
+  }
+
+  xTaskCreate(
+      [](void*) {
+        // too big for the stack
+        static MagnetometerCalibrator calibrator(
+            MAG_CALIBRATION_MIN_SAMPLE_DISTANCE);
+        std::optional<TickType_t> last_persisted;
+
+        while (true) {
+          vTaskDelay(pdMS_TO_TICKS(MAG_CALIBRATION_INTERVAL_S * 1000));
+
+          // copy the samples, so the IMU task isn't blocked while fitting
+          auto previous_generation = calibrator.generation();
+          calibrator = Data::the()->m_mag_calibrator;
+          if (calibrator.generation() == previous_generation)
+            continue;
+
+          auto calibration = calibrator.fit();
+          if (!calibration)
+            continue;
+
+          auto const& [offset, scale] = *calibration;
+          ESP_LOGI("Data",
+                   "Magnetometer calibration: offset (%.3f, %.3f, %.3f), "
+                   "scale (%.3f, %.3f, %.3f)",
+                   offset.x, offset.y, offset.z, scale.x, scale.y, scale.z);
+          Data::the()->m_mag_calibration = *calibration;
+
+          auto now = xTaskGetTickCount();
+          if (last_persisted &&
+              now - *last_persisted <
+                  pdMS_TO_TICKS(MAG_CALIBRATION_PERSIST_INTERVAL_S * 1000))
+            continue;
+
+          last_persisted = now;
+          RawMagnetometerCalibration raw = {
+              .offset = {offset.x, offset.y, offset.z},
+              .scale = {scale.x, scale.y, scale.z},
+          };
+          Preferences::instance().set_blob(PREFERENCES_MAG_CALIBRATION, raw);
+        }
+
+        vTaskDelete(NULL);
+      },
+      "MAG CAL", 1024 * 3, NULL, ENV_TASK_PRIORITY, NULL);
+
   xTaskCreate(
       [](void*) {
         {
@@ -175,18 +248,7 @@ void Data::initialize() {
         }
 
         // wait for data to be available before adding a history entry
-        esp_event_handler_t handler = [](void* user_data, esp_event_base_t, i32,
-                                         void*) {
-          xTaskNotify(static_cast<TaskHandle_t>(user_data), 1,
-                      eSetValueWithOverwrite);
-        };
-
-        esp_event_handler_register(DATA_EVENT_BASE,
-                                   Data::Event::EnvironmentDataUpdated, handler,
-                                   xTaskGetCurrentTaskHandle());
-        ulTaskNotifyTake(true, portMAX_DELAY);
-        esp_event_handler_unregister(
-            DATA_EVENT_BASE, Data::Event::EnvironmentDataUpdated, handler);
+        Data::wait_for_environment_data();
 
         while (true) {
           ESP_LOGI("Data", "Updating history");
@@ -210,8 +272,9 @@ void Data::disable_wifi() { WifiManager::the().disable_wifi(); }
 bool Data::wifi_enabled() { return WifiManager::the().wifi_enabled(); }
 
 void post_environment_data_updated_event() {
-  esp_event_post(DATA_EVENT_BASE, Data::Event::EnvironmentDataUpdated, NULL, 0,
-                 10);
+  xEventGroupSetBits(environment_data_event_group(),
+                     ENVIRONMENT_DATA_AVAILABLE_BIT);
+  Data::publish(Data::Event::EnvironmentDataUpdated);
 }
 
 void Data::update_battery_voltage(uint32_t voltage) {
@@ -219,59 +282,141 @@ void Data::update_battery_voltage(uint32_t voltage) {
       round((voltage - MIN_BATTERY_VOLTAGE) /
             (MAX_BATTERY_VOLTAGE - MIN_BATTERY_VOLTAGE) * 100.f);
   m_battery_percentage = MIN(m_battery_percentage, (uint8_t)100);
-  esp_event_post(DATA_EVENT_BASE, Event::BatteryChargeUpdated, NULL, 0, 10);
+  publish(Event::BatteryChargeUpdated);
 }
 
-void Data::update_inertial_measurements(Vector3 accel, Vector3 gyro,
-                                        Vector3 mag) {
-  m_gyroscope = low_pass_filter(gyro, m_gyroscope, 0.5);
-  m_acceleration = low_pass_filter(accel, m_acceleration, 0.8);
-  m_magnetic = low_pass_filter((mag + HARD_IRON_OFFSET) * SOFT_IRON_OFFSET,
-                               m_magnetic, 0.25);
+/// Converts a low pass filter `gain` that was tuned for a sample period of
+/// `Data::INERTIAL_REFERENCE_PERIOD_MS` to the equivalent gain for a sample
+/// period of `dt_ms`.
+float rescale_low_pass_gain(float gain, float dt_ms) {
+  return 1.f - powf(1.f - gain, dt_ms / Data::INERTIAL_REFERENCE_PERIOD_MS);
+}
 
-  m_compass_heading =
-      atan2f(m_magnetic.x, m_magnetic.z) * RAD_TO_DEG + COMPASS_HEADING_OFFSET;
-  // transform range from [-180° ; 180°] to [0° ; 360°]
-  if (m_compass_heading < 0)
-    m_compass_heading += 360.f;
+void Data::update_inertial_measurements(std::span<InertialSample const> samples,
+                                        std::optional<Vector3> mag) {
+  std::optional<Vector3> calibrated_mag;
+  if (mag) {
+    m_mag_calibrator.add_sample(*mag);
+    calibrated_mag = m_mag_calibration.apply(*mag);
+  }
+
+  bool sdg_detected = false;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    auto const& sample = samples[i];
+    auto dt_ms = (sample.timestamp_us - m_last_inertial_sample_us) / 1000.f;
+    // a sample that isn't newer than the previous one would make the filters
+    // extrapolate and the orientation filter integrate backwards
+    if (dt_ms <= 0.f)
+      continue;
+    dt_ms = MIN(dt_ms, INERTIAL_REFERENCE_PERIOD_MS);
+    m_last_inertial_sample_us = sample.timestamp_us;
+
+    m_gyroscope_filter.set_gain(
+        rescale_low_pass_gain(GYROSCOPE_FILTER_GAIN, dt_ms));
+    m_gyroscope = m_gyroscope_filter.process(sample.rotation);
+    m_acceleration_filter.set_gain(
+        rescale_low_pass_gain(ACCELERATION_FILTER_GAIN, dt_ms));
+    m_acceleration = m_acceleration_filter.process(sample.acceleration);
+
+    // the magnetometer reading belongs to the newest sample
+    update_orientation(sample,
+                       i == samples.size() - 1 ? calibrated_mag : std::nullopt,
+                       dt_ms / 1000.f);
+
+#if !HARDWARE_SET_DOWN_GESTURE
+    sdg_detected |= set_down_gesture_detected(sample.timestamp_us / 1000);
+#endif
+  }
+
+  if (calibrated_mag)
+    update_magnetic(*calibrated_mag);
+  update_compass_heading();
+
+  if (sdg_detected) {
+    publish(Event::SetDownGesture);
+  }
+}
+
+void Data::update_magnetic(Vector3 mag) {
+  m_magnetic = m_magnetic_filter.process(mag);
+}
 
-  m_compass_heading = 360.f - m_compass_heading;
+/// Converts a vector from the device's axes to the filter's axes. The filter
+/// needs a right-handed frame whose z-axis points up when the device lies flat.
+static Vector3 to_orientation_frame(Vector3 v) {
+  return Vector3(v.x, v.z, -v.y);
+}
+
+void Data::update_orientation(InertialSample const& sample,
+                              std::optional<Vector3> mag, float dt_s) {
+  auto acc = to_orientation_frame(sample.acceleration);
+
+  if (!m_orientation.initialized()) {
+    // start from the measured orientation instead of letting the filter
+    // converge from an arbitrary one
+    if (mag)
+      m_orientation.initialize(acc, to_orientation_frame(*mag));
+    return;
+  }
 
-  if (set_down_gesture_detected()) {
-    esp_event_post(DATA_EVENT_BASE, Event::SetDownGesture, NULL, 0, 10);
+  auto gyro = to_orientation_frame(sample.rotation) * DEG_TO_RAD;
+  if (mag) {
+    m_orientation.update(gyro, acc, to_orientation_frame(*mag), dt_s);
+  } else {
+    m_orientation.update(gyro, acc, dt_s);
   }
 }
 
+void Data::update_compass_heading() {
+  if (!m_orientation.initialized())
+    return;
+
+  // the positive z-axis of the device in earth coordinates (x: north, y: west)
+  auto forward = m_orientation.to_earth_frame(Vector3(0, 1, 0));
+  m_compass_heading =
+      atan2f(-forward.y, forward.x) * RAD_TO_DEG + COMPASS_HEADING_OFFSET;
+  // transform range from [-180° ; 180°] to [0° ; 360°]
+  m_compass_heading = fmodf(m_compass_heading + 360.f, 360.f);
+}
+
 void Data::set_muted(bool muted) {
   m_muted = muted;
   Preferences::instance().set_bool(PREFERENCES_IS_MUTED, muted);
-  esp_event_post(DATA_EVENT_BASE, Event::StatusUpdated, NULL, 0, 10);
+  publish(Event::StatusUpdated);
 }
 
-bool Data::set_down_gesture_detected() {
+void Data::report_set_down_gesture() {
+  if (m_disable_sdg_detection)
+    return;
+  ESP_LOGI("Data", "Detected SDG in hardware");
+  publish(Event::SetDownGesture);
+}
+
+bool Data::set_down_gesture_detected(u32 now_ms) {
   if (m_disable_sdg_detection)
     return false;
 
   auto acc = -m_acceleration - GRAVITATIONAL_ACCELERATION.y;
 
-  if (acc.y >= SDG_COOLDOWN_ACCELERATION_THRESHOLD && sdg_cooldown_exceeded()) {
-    m_sdg_cooldown = millis();
+  if (acc.y >= SDG_COOLDOWN_ACCELERATION_THRESHOLD &&
+      sdg_cooldown_exceeded(now_ms)) {
+    m_sdg_cooldown = now_ms;
   }
 
   if (-acc.y >= SDG_DOWNWARDS_ACCELERATION_THRESHOLD &&
-      sdg_cooldown_exceeded()) {
-    if (millis() - m_set_down_gesture_start >
+      sdg_cooldown_exceeded(now_ms)) {
+    if (now_ms - m_set_down_gesture_start >
         SDG_DOWNWARDS_ACCELERATION_MAX_DURATION_MS) {
-      m_set_down_gesture_start = millis();
+      m_set_down_gesture_start = now_ms;
     }
   }
 
-  auto elapsed = millis() - m_set_down_gesture_start;
+  auto elapsed = now_ms - m_set_down_gesture_start;
 
   if (elapsed <= SDG_DOWNWARDS_ACCELERATION_MIN_DURATION_MS &&
       abs(acc.y) <= SDG_END_ACCELERATION) {
     m_set_down_gesture_start = 0;
-    elapsed = millis() - m_set_down_gesture_start;
+    elapsed = now_ms - m_set_down_gesture_start;
   }
 
   if (elapsed <= SDG_DOWNWARDS_ACCELERATION_MAX_DURATION_MS) {
@@ -285,18 +430,30 @@ bool Data::set_down_gesture_detected() {
   return false;
 }
 
+/// Returns the time since `last_update_us` in units of
+/// `Data::ENVIRONMENT_REFERENCE_PERIOD_MS` and sets `last_update_us` to now.
+float take_environment_interval(i64& last_update_us) {
+  auto now = esp_timer_get_time();
+  auto dt_ms = static_cast<float>(now - last_update_us) / 1000.f;
+  last_update_us = now;
+  return dt_ms / Data::ENVIRONMENT_REFERENCE_PERIOD_MS;
+}
+
 void Data::update_temperature(float temp) {
-  m_temperature = temp + TEMPERATURE_OFFSET;
+  auto dt = take_environment_interval(m_last_temperature_update_us);
+  m_temperature = m_temperature_filter.process(temp, dt) + TEMPERATURE_OFFSET;
   post_environment_data_updated_event();
 }
 
 void Data::update_humidity(float hum) {
-  m_humidity = hum + HUMIDITY_OFFSET;
+  auto dt = take_environment_interval(m_last_humidity_update_us);
+  m_humidity = m_humidity_filter.process(hum, dt) + HUMIDITY_OFFSET;
   post_environment_data_updated_event();
 }
 
 void Data::update_co2_ppm(u16 co2_ppm) {
-  m_co2_ppm = co2_ppm;
+  auto dt = take_environment_interval(m_last_co2_update_us);
+  m_co2_ppm = static_cast<u16>(roundf(m_co2_filter.process(co2_ppm, dt)));
   post_environment_data_updated_event();
 }
 
@@ -442,15 +599,18 @@ std::vector<Data::HistoryEntry> Data::history() const {
   return result;
 }
 
+/// Returned by `Data::get_time()` while `Data::pin()` is in effect
+static std::optional<time_t> s_pinned_time;
+
 tm Data::get_time() {
-  auto now = time(NULL);
+  auto now = s_pinned_time.value_or(time(NULL));
   tm time;
   localtime_r(&now, &time);
   return time;
 }
 
 tm Data::get_utc_time() {
-  auto now = time(NULL);
+  auto now = s_pinned_time.value_or(time(NULL));
   return *gmtime(&now);
 }
 
@@ -470,7 +630,49 @@ void Data::set_time(time_t unix_timestamp) {
       .tv_usec = 0,
   };
   settimeofday(&tv, NULL);
-  esp_event_post(DATA_EVENT_BASE, Event::TimeChanged, NULL, 0, 0);
+  publish(Event::TimeChanged);
+}
+
+void Data::pin(DisplayedValues const& values) {
+  if (!m_unpinned)
+    m_unpinned = displayed_values();
+  show(values);
+  s_pinned_time = values.time;
+}
+
+void Data::unpin() {
+  if (!m_unpinned)
+    return;
+  show(*m_unpinned);
+  m_unpinned.reset();
+  s_pinned_time.reset();
+}
+
+Data::DisplayedValues Data::displayed_values() const {
+  return DisplayedValues{
+      .time = 0,
+      .battery_percentage = m_battery_percentage,
+      .temperature = m_temperature,
+      .humidity = m_humidity,
+      .co2_ppm = m_co2_ppm,
+      .voc_index = m_voc_index,
+      .nox_index = m_nox_index,
+      .compass_heading = m_compass_heading,
+      .acceleration = m_acceleration,
+      .gyroscope = m_gyroscope,
+  };
+}
+
+void Data::show(DisplayedValues const& values) {
+  m_battery_percentage = values.battery_percentage;
+  m_temperature = values.temperature;
+  m_humidity = values.humidity;
+  m_co2_ppm = values.co2_ppm;
+  m_voc_index = values.voc_index;
+  m_nox_index = values.nox_index;
+  m_compass_heading = values.compass_heading;
+  m_acceleration = values.acceleration;
+  m_gyroscope = values.gyroscope;
 }
 
 bool Data::is_upside_down() const {
@@ -4,17 +4,26 @@
 #include <cstdint>
 #include <cstdio>
 #include <ctime>
-#include <esp_event.h>
+#include <dsp.h>
+#include <event_bus.h>
+#include <freertos/event_groups.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/timers.h>
+#include <madgwick.h>
+#include <magnetometer_calibrator.h>
 #include <nvs_flash.h>
+#include <optional>
+#include <span>
 #include <sync.h>
 #include <types.h>
 #include <ui/ui.h>
 #include <util.h>
 #include <vector>
 
+/// Current wall clock time in milliseconds since the epoch.
+long long timestamp_in_ms();
+
 class UserTimer {
 public:
   void recover(int original_duration, int remaining_duration);
@@ -101,8 +110,6 @@ public:
   bool const is_light_color;
 };
 
-ESP_EVENT_DECLARE_BASE(DATA_EVENT_BASE);
-
 class Data {
 public:
   enum Event : i32 {
@@ -123,6 +130,8 @@ public:
     PrepareDeepSleep,
   };
 
+  using EventBus = ::EventBus<Event, 12>;
+
   static constexpr u32 BLUETOOTH_ADVERSISEMENT_DURATION_MS = 1 * 60 * 1000;
 
   /// https://wiki.seeedstudio.com/seeedstudio_round_display_usage/#measure-battery-voltage-pins
@@ -165,7 +174,8 @@ public:
   /// exceeded before allowing SDGs to be detected again
   static constexpr ulong SDG_COOLDOWN_AFTER_UPWARDS_ACCELERATION_MS = 200;
 
-  /// Hard- and soft-iron offset for the magnetometer measurements.
+  /// Default hard- and soft-iron offset for the magnetometer measurements,
+  /// used until the device has calibrated itself.
   ///
   /// Determined by moving the device to as many different angles as possible,
   /// plotting the points and finding the offset and scale of the ellipsoid
@@ -173,14 +183,26 @@ public:
   static constexpr Vector3 HARD_IRON_OFFSET = Vector3(-.387f, .25f, .35f);
   static constexpr Vector3 SOFT_IRON_OFFSET =
       Vector3(1.f / 1.12f, 1.f / 1.3f, 1.f / 1.3f);
+  /// Minimum distance between magnetometer samples used for calibration in
+  /// Gauss. See `MagnetometerCalibrator`.
+  static constexpr float MAG_CALIBRATION_MIN_SAMPLE_DISTANCE = 0.03f;
+  /// Interval the magnetometer calibration is refitted at, if new samples
+  /// were collected.
+  static constexpr u32 MAG_CALIBRATION_INTERVAL_S = 30;
+  /// Minimum time between saving the magnetometer calibration to flash.
+  static constexpr u32 MAG_CALIBRATION_PERSIST_INTERVAL_S = 10 * 60;
   /// Angle the compass heading is rotated by.
   static constexpr float COMPASS_HEADING_OFFSET = 0.f;
+  /// Gain of the orientation filter the compass heading is derived from. See
+  /// `Madgwick`.
+  static constexpr float ORIENTATION_FILTER_BETA = 0.1f;
 
   static constexpr char const* HISTORY_FILE_PATH = BASE_PATH "/history";
   static constexpr i64 TIME_BETWEEN_HISTORY_ENTRIES_S = 30 * 60;
   static constexpr size_t MAX_HISTORY_ENTRIES = 24;
 
   static constexpr char const* PREFERENCES_IS_MUTED = "muted";
+  static constexpr char const* PREFERENCES_MAG_CALIBRATION = "mag_cal";
 
   struct RawHistoryEntry {
     i64 timestamp;
@@ -196,12 +218,66 @@ public:
     float hum;
   };
 
+  /// Everything the UI shows that is measured or changes on its own
+  struct DisplayedValues {
+    time_t time;
+    uint8_t battery_percentage;
+    float temperature;
+    float humidity;
+    u16 co2_ppm;
+    u16 voc_index;
+    u16 nox_index;
+    float compass_heading;
+    Vector3 acceleration;
+    Vector3 gyroscope;
+  };
+
+  /// A single accelerometer + gyroscope sample in the device's axes.
+  struct InertialSample {
+    /// m/s^2
+    Vector3 acceleration;
+    /// °/s
+    Vector3 rotation;
+    /// Time the sample was taken at, as returned by `esp_timer_get_time()`.
+    i64 timestamp_us;
+  };
+
+  /// Period the low pass filter gains of the inertial measurements were tuned
+  /// for. Gains are converted to the actual sample period.
+  static constexpr float INERTIAL_REFERENCE_PERIOD_MS = 50;
+  static constexpr float GYROSCOPE_FILTER_GAIN = 0.5f;
+  static constexpr float ACCELERATION_FILTER_GAIN = 0.8f;
+  static constexpr float MAGNETIC_FILTER_GAIN = 0.25f;
+
+  /// Filters for the environment measurements. A median rejects single
+  /// outliers of the CO2 sensor, Kalman stages smooth the measurement noise.
+  /// Their process variances are given per
+  /// `ENVIRONMENT_REFERENCE_PERIOD_MS`, the SCD41's periodic measurement
+  /// interval, and scaled to the actual time between two measurements, which
+  /// the sampling scheduler lengthens while the readings are stable.
+  static constexpr float ENVIRONMENT_REFERENCE_PERIOD_MS = 5000;
+  using Co2Filter =
+      dsp::Pipeline<float, dsp::Median<float, 3>, dsp::Kalman<float>>;
+  using TemperatureFilter = dsp::Pipeline<float, dsp::Kalman<float>>;
+  using HumidityFilter = dsp::Pipeline<float, dsp::Kalman<float>>;
+
   static Mutex<Data>::Guard the();
 
+  /// Bus all `Data::Event`s are published on. Intentionally not behind the
+  /// data mutex, so publishing never blocks.
+  static EventBus& events();
+  static void publish(Event event) { events().publish(event); }
+
+  /// Blocks until environment data has been published at least once.
+  static void wait_for_environment_data();
+
   void initialize();
 
   void update_battery_voltage(uint32_t voltage);
-  void update_inertial_measurements(Vector3 accel, Vector3 gyro, Vector3 mag);
+  /// Feeds a batch of inertial samples, oldest first, together with the most
+  /// recent magnetometer reading, if there is a new one.
+  void update_inertial_measurements(std::span<InertialSample const> samples,
+                                    std::optional<Vector3> mag);
   void update_temperature(float temp);
   void update_humidity(float hum);
   void update_co2_ppm(u16 co2_ppm);
@@ -248,21 +324,39 @@ public:
 
   std::vector<HistoryEntry> history() const;
 
+  /// Publishes a set-down gesture detected outside of `Data`, e.g. by the
+  /// IMU itself, unless detection is currently disabled.
+  void report_set_down_gesture();
+
   void disable_sdg_detection() { m_disable_sdg_detection = true; }
   void enable_sdg_detection() { m_disable_sdg_detection = false; }
 
   bool is_upside_down() const;
 
+  /// Shows `values` instead of the measured ones until `unpin()`, e.g. so
+  /// renders of the UI are reproducible. Only meant for while nothing is
+  /// measured, as `unpin()` restores the values from before.
+  void pin(DisplayedValues const& values);
+  void unpin();
+
 private:
-  bool set_down_gesture_detected();
-  bool sdg_cooldown_exceeded() {
-    return millis() - m_sdg_cooldown >=
+  void update_magnetic(Vector3 mag);
+  void update_orientation(InertialSample const& sample,
+                          std::optional<Vector3> mag, float dt_s);
+  void update_compass_heading();
+  bool set_down_gesture_detected(u32 now_ms);
+  bool sdg_cooldown_exceeded(u32 now_ms) {
+    return now_ms - m_sdg_cooldown >=
            SDG_COOLDOWN_AFTER_UPWARDS_ACCELERATION_MS;
   }
 
   void update_history();
   std::optional<RawHistoryEntry> last_history_entry() const;
 
+  /// The current values, except for the time, which is static
+  DisplayedValues displayed_values() const;
+  void show(DisplayedValues const& values);
+
   // Lock m_lvgl_lock;
 
   UserTimer m_user_timer;
@@ -285,16 +379,41 @@ private:
   Vector3 m_acceleration;
   /// Magnetic field strength in the respective axes in Gauss.
   Vector3 m_magnetic;
+  MagnetometerCalibration m_mag_calibration{HARD_IRON_OFFSET,
+                                            SOFT_IRON_OFFSET};
+  /// Collects raw magnetometer samples, which are periodically fitted in the
+  /// background to update `m_mag_calibration`.
+  MagnetometerCalibrator m_mag_calibrator{MAG_CALIBRATION_MIN_SAMPLE_DISTANCE};
   /// Current compass heading of the device in degrees.
   ///
   /// 0° means the positive z-axis is pointing north.
   float m_compass_heading;
+  /// Orientation of the device, fused from all three inertial sensors. The
+  /// compass heading is derived from it, which makes it independent of the
+  /// device's tilt.
+  Madgwick m_orientation{ORIENTATION_FILTER_BETA};
 
-  float m_sdg_cooldown = 0;
+  u32 m_sdg_cooldown = 0;
   u32 m_set_down_gesture_start = 0;
+  /// Timestamp of the last inertial sample
+  i64 m_last_inertial_sample_us = 0;
 
   bool m_disable_sdg_detection = false;
 
+  dsp::OnePole<Vector3> m_gyroscope_filter{GYROSCOPE_FILTER_GAIN};
+  dsp::OnePole<Vector3> m_acceleration_filter{ACCELERATION_FILTER_GAIN};
+  dsp::OnePole<Vector3> m_magnetic_filter{MAGNETIC_FILTER_GAIN};
+
+  // Variances are in the squared unit of the respective measurement.
+  Co2Filter m_co2_filter{dsp::Median<float, 3>(), dsp::Kalman<float>(100, 900)};
+  TemperatureFilter m_temperature_filter{dsp::Kalman<float>(0.0025, 0.01)};
+  HumidityFilter m_humidity_filter{dsp::Kalman<float>(0.0625, 0.25)};
+  /// Times the filters were last updated at, as returned by
+  /// `esp_timer_get_time()`
+  i64 m_last_co2_update_us = 0;
+  i64 m_last_temperature_update_us = 0;
+  i64 m_last_humidity_update_us = 0;
+
   /// °C
   float m_temperature = 0;
   /// %
@@ -308,6 +427,9 @@ private:
   /// NOx (nitrogen oxides) index. Unitless and ranges from 0 (best) to 500
   /// (worst). 1 is average.
   u16 m_nox_index = 0;
+
+  /// The values from before `pin()`, while pinned
+  std::optional<DisplayedValues> m_unpinned;
 };
 
 /// Counting semaphore to keep track of how many tasks need to perform an
@@ -324,24 +446,36 @@ struct DeepSleepPreparation {
     index = uxSemaphoreGetCount(s_prepare_deep_sleep_counter);
     xSemaphoreGive(s_prepare_deep_sleep_counter);
     if (enable_notification) {
-      esp_event_handler_register(
-          DATA_EVENT_BASE, Data::Event::PrepareDeepSleep,
-          [](void* task, esp_event_base_t, int32_t, void*) {
-            xTaskNotify(static_cast<TaskHandle_t>(task), 1,
-                        eSetValueWithOverwrite);
-          },
-          xTaskGetCurrentTaskHandle());
+      m_subscriber = Data::events().subscribe(
+          pcTaskGetName(NULL),
+          Data::EventBus::mask(Data::Event::PrepareDeepSleep),
+          xTaskGetCurrentTaskHandle(), NOTIFICATION_BIT);
     }
   }
 
+  /// Notification bit set when deep sleep is requested. Tasks waiting on
+  /// other notifications as well must not use this bit for anything else.
+  static constexpr u32 NOTIFICATION_BIT = 0x01;
+
   bool wait_for_event(u32 ticks_to_wait) {
-    return ulTaskNotifyTake(true, ticks_to_wait) != 0;
+    ulTaskNotifyTake(true, ticks_to_wait);
+    return requested();
   }
 
+  /// Returns whether deep sleep was requested, without blocking.
+  bool requested() { return m_subscriber && m_subscriber->poll().has_value(); }
+
+  /// Signals that the task is ready for deep sleep. Also unsubscribes from
+  /// the bus, as the task is expected to delete itself afterwards.
   void ready() {
+    if (m_subscriber) {
+      Data::events().unsubscribe(m_subscriber);
+      m_subscriber = nullptr;
+    }
     xEventGroupSetBits(s_deep_sleep_ready_event_group, 1 << index);
   }
 
 private:
   u32 index;
+  Data::EventBus::Subscriber* m_subscriber = nullptr;
 };
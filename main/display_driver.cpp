@@ -1,8 +1,13 @@
 #include "display_driver.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cmath>
+#include <cstring>
 #include <data.h>
 #include <driver/gpio.h>
 #include <esp_err.h>
+#include <esp_heap_caps.h>
 #include <esp_lcd_gc9a01.h>
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
@@ -10,41 +15,263 @@
 #include <esp_log.h>
 #include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include <freertos/task.h>
 #include <lvgl.h>
+#include <round_panel.h>
 #include <stdio.h>
 #include <sys/lock.h>
 #include <sys/param.h>
 #include <ui/ui.h>
 #include <unistd.h>
 
+// The display expects big-endian RGB565, which LVGL renders natively since
+// 9.3. Older versions needed every flushed pixel to be swapped by the CPU, as
+// neither the ESP32-S3's SPI peripheral nor esp_lcd's SPI panel IO can swap
+// bytes.
+static_assert(LV_VERSION_CHECK(9, 3, 0),
+              "LV_COLOR_FORMAT_RGB565_SWAPPED requires LVGL 9.3");
+
 constexpr size_t CHSC6X_READ_POINT_LEN = 5;
 constexpr u32 CHSC6X_I2C_SPEED = 100000;
 constexpr u32 CHSC6X_I2C_TIMEOUT_MS = 50;
 
-i2c_master_dev_handle_t g_chsc6x_handle;
+I2cDevice* g_chsc6x;
+
+/// Given when the SPI transfers of a flushed draw buffer have completed.
+SemaphoreHandle_t g_flush_done;
+
+/// A draw buffer handed over by LVGL, sent by the flush task.
+struct FlushJob {
+  lv_area_t area;
+  u16* pixels;
+};
+
+QueueHandle_t g_flush_jobs;
+/// Color transfers of the current flush that haven't completed, plus one
+/// while the flush task is still issuing them. Whoever drops it to 0 gives
+/// `g_flush_done`. Transfers from `clear_display()` aren't counted.
+std::atomic<u32> g_pending_transfers = 0;
+
+static_assert(DP_H_RES == DP_V_RES);
+using Panel = RoundPanel<DP_H_RES>;
+Panel const g_panel;
+
+#if LOG_DISPLAY_FRAME_STATISTICS
+/// Durations accumulated over `DISPLAY_FRAME_STATISTICS_INTERVAL_MS`. LVGL
+/// renders into one draw buffer while the other one is prepared and
+/// transferred by the flush task, so render, prepare and DMA time overlap.
+/// `wait_us` is the time rendering was blocked on a flush.
+struct FrameStatistics {
+  i64 window_start_us = 0;
+  u32 frames = 0;
+  u32 flushes = 0;
+  i64 render_us = 0;
+  i64 wait_us = 0;
+  // written from the flush task
+  i64 prepare_us = 0;
+  /// Bytes that flushing the whole areas rendered by LVGL would have sent
+  u32 rendered_bytes = 0;
+  u32 sent_bytes = 0;
+  /// Areas invalidated by widgets, after clipping them to the panel. LVGL
+  /// merges overlapping ones before rendering.
+  u32 invalidated_areas = 0;
+  u32 invalidated_px = 0;
+  /// Written from the transfer completion ISR
+  i64 dma_us = 0;
+
+  /// Start of the refresh or the end of the last flush callback or wait for a
+  /// transfer, i.e. when rendering last continued. 0 outside of a refresh.
+  i64 last_mark_us = 0;
+  i64 dma_started_us = 0;
+};
+
+FrameStatistics g_frame_statistics;
+#endif
 
 bool lcd_on_color_trans_done(esp_lcd_panel_io_handle_t panel_io,
                              esp_lcd_panel_io_event_data_t* edata,
                              void* user_ctx) {
-  lv_display_t* disp = static_cast<lv_display_t*>(user_ctx);
-  lv_display_flush_ready(disp);
-  return false;
+  if (g_pending_transfers.load() == 0)
+    return false;
+  if (g_pending_transfers.fetch_sub(1) != 1)
+    return false;
+
+#if LOG_DISPLAY_FRAME_STATISTICS
+  auto& stats = g_frame_statistics;
+  stats.dma_us += esp_timer_get_time() - stats.dma_started_us;
+#endif
+
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(g_flush_done, &woken);
+  return woken == pdTRUE;
+}
+
+/// Shrinks invalidated areas to the bounding box of their visible part, so
+/// LVGL doesn't render the panel's corners. Areas are also widened to even
+/// columns, which keeps the row spans compacted by `send_visible_bands()`
+/// word aligned for the DMA.
+///
+/// LVGL can't drop an area from this event, so areas that lie entirely in a
+/// corner are reduced to two pixels that the flush skips.
+void lvgl_invalidate_area_cb(lv_event_t* e) {
+  auto* area = static_cast<lv_area_t*>(lv_event_get_param(e));
+
+  // the chords of the widest row and column bound the visible part
+  auto row = Panel::widest_chord(area->y1, area->y2);
+  auto column = Panel::widest_chord(area->x1, area->x2);
+  auto x1 = std::max<i32>(area->x1, g_panel.chord_start(row));
+  auto x2 = std::min<i32>(area->x2, g_panel.chord_end(row));
+  if (x1 > x2) {
+    *area = {column, row, column, row};
+  } else {
+    *area = {x1, std::max<i32>(area->y1, g_panel.chord_start(column)), x2,
+             std::min<i32>(area->y2, g_panel.chord_end(column))};
+  }
+
+  area->x1 &= ~1;
+  area->x2 |= 1;
+
+#if LOG_DISPLAY_FRAME_STATISTICS
+  ++g_frame_statistics.invalidated_areas;
+  g_frame_statistics.invalidated_px += lv_area_get_size(area);
+#endif
+}
+
+/// Called by LVGL before it reuses a draw buffer. Blocks until the transfer
+/// has completed instead of spinning on the display's flushing flag, so other
+/// tasks on the core can run in the meantime.
+void lvgl_flush_wait_cb(lv_display_t* disp) {
+#if LOG_DISPLAY_FRAME_STATISTICS
+  auto& stats = g_frame_statistics;
+  auto start = esp_timer_get_time();
+  // LVGL may also wait for the last transfer outside of a refresh
+  if (stats.last_mark_us != 0)
+    stats.render_us += start - stats.last_mark_us;
+  xSemaphoreTake(g_flush_done, portMAX_DELAY);
+  stats.last_mark_us = esp_timer_get_time();
+  stats.wait_us += stats.last_mark_us - start;
+#else
+  xSemaphoreTake(g_flush_done, portMAX_DELAY);
+#endif
 }
 
 // https://github.com/espressif/esp-idf/blob/f420609c332fbd2d2f7f188c6579d046c9560e42/examples/peripherals/lcd/spi_lcd_touch/main/spi_lcd_touch_example_main.c#L114
 void lvgl_flush_cb(lv_display_t* disp, lv_area_t const* area, uint8_t* px_map) {
-  auto panel_handle =
-      static_cast<esp_lcd_panel_handle_t>(lv_display_get_user_data(disp));
-  int x1 = area->x1, x2 = area->x2, y1 = area->y1, y2 = area->y2;
-  // because SPI LCD is big-endian, we need to swap the RGB bytes order
-  lv_draw_sw_rgb565_swap(px_map, (x2 + 1 - x1) * (y2 + 1 - y1));
-  esp_lcd_panel_draw_bitmap(panel_handle, x1, y1, x2 + 1, y2 + 1, px_map);
+#if LOG_DISPLAY_FRAME_STATISTICS
+  auto& stats = g_frame_statistics;
+  stats.render_us += esp_timer_get_time() - stats.last_mark_us;
+  ++stats.flushes;
+#endif
+
+  FlushJob job = {*area, reinterpret_cast<u16*>(px_map)};
+  xQueueSend(g_flush_jobs, &job, portMAX_DELAY);
+
+#if LOG_DISPLAY_FRAME_STATISTICS
+  stats.last_mark_us = esp_timer_get_time();
+#endif
 }
 
-void lvgl_tick_cb(void* arg) { lv_tick_inc(LVGL_TICK_PERIOD_MS); }
+/// Sends the visible part of a flushed area. The area is split into bands of
+/// `DISPLAY_FLUSH_BAND_LINES` rows, each clipped to the chord of its widest
+/// row. A clipped band's rows are moved together in place, so it can be sent
+/// as one rectangle. esp_lcd waits for the previous band's pixels before
+/// sending the next band's window, so the CPU prepares the next band while
+/// the current one is transferred.
+void send_visible_bands(FlushJob const& job) {
+  Panel::Area area = {job.area.x1, job.area.y1, job.area.x2, job.area.y2};
+
+  for (i32 y1 = area.y1; y1 <= area.y2; y1 += DISPLAY_FLUSH_BAND_LINES) {
+    auto y2 = std::min<i32>(y1 + DISPLAY_FLUSH_BAND_LINES - 1, area.y2);
+    auto band = g_panel.visible_band(area, y1, y2);
+    if (!band)
+      continue;
+
+#if LOG_DISPLAY_FRAME_STATISTICS
+    auto& stats = g_frame_statistics;
+    auto start = esp_timer_get_time();
+#endif
+
+    // LVGL rendered the pixels in the panel's byte order, they only have to
+    // be moved together
+    auto* pixels = Panel::compact_band(job.pixels, area, *band);
+
+#if LOG_DISPLAY_FRAME_STATISTICS
+    auto now = esp_timer_get_time();
+    stats.prepare_us += now - start;
+    if (g_pending_transfers.load() == 1)
+      stats.dma_started_us = now;
+    stats.sent_bytes += band->width() * band->height() * sizeof(u16);
+#endif
+
+    g_pending_transfers.fetch_add(1);
+    if (ESP_ERROR_CHECK_WITHOUT_ABORT(esp_lcd_panel_draw_bitmap(
+            g_panel_handle, band->x1, band->y1, band->x2 + 1, band->y2 + 1,
+            pixels)) != ESP_OK) {
+      // there won't be a completion
+      g_pending_transfers.fetch_sub(1);
+    }
+  }
+}
+
+void display_flush_task(void* arg) {
+  FlushJob job;
+  while (true) {
+    xQueueReceive(g_flush_jobs, &job, portMAX_DELAY);
 
-constexpr i32 LVGL_EVENT_QUEUE_PREPARE_DEEP_SLEEP_ENTRY = -1;
+#if LOG_DISPLAY_FRAME_STATISTICS
+    g_frame_statistics.rendered_bytes +=
+        lv_area_get_size(&job.area) * sizeof(u16);
+#endif
+
+    g_pending_transfers.store(1);
+    send_visible_bands(job);
+    // all transfers may have completed already, or none was started
+    if (g_pending_transfers.fetch_sub(1) == 1)
+      xSemaphoreGive(g_flush_done);
+  }
+}
+
+#if LOG_DISPLAY_FRAME_STATISTICS
+void lvgl_refresh_event_cb(lv_event_t* e) {
+  auto& stats = g_frame_statistics;
+  auto now = esp_timer_get_time();
+
+  if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+    stats.last_mark_us = now;
+    if (stats.window_start_us == 0)
+      stats.window_start_us = now;
+    return;
+  }
+
+  ++stats.frames;
+  stats.last_mark_us = 0;
+  auto window_us = now - stats.window_start_us;
+  if (window_us < DISPLAY_FRAME_STATISTICS_INTERVAL_MS * 1000)
+    return;
+
+  auto per_frame = [&](i64 us) { return us / stats.frames; };
+  ESP_LOGI("Display",
+           "%.1f FPS, %.1f flushes per frame, per frame: render %lld us, "
+           "prepare %lld us, DMA %lld us, waiting for DMA %lld us, "
+           "sent %lu of %lu rendered bytes",
+           stats.frames * 1e6f / window_us,
+           static_cast<float>(stats.flushes) / stats.frames,
+           per_frame(stats.render_us), per_frame(stats.prepare_us),
+           per_frame(stats.dma_us), per_frame(stats.wait_us),
+           stats.sent_bytes / stats.frames,
+           stats.rendered_bytes / stats.frames);
+  auto seconds = window_us / 1e6f;
+  ESP_LOGI("Display",
+           "per second: %.0f invalidated areas, %.0f invalidated px, "
+           "rendering %.1f%% of the time",
+           stats.invalidated_areas / seconds, stats.invalidated_px / seconds,
+           stats.render_us * 100.f / window_us);
+  stats = {};
+}
+#endif
+
+void lvgl_tick_cb(void* arg) { lv_tick_inc(LVGL_TICK_PERIOD_MS); }
 
 void lvgl_port_task(void* arg) {
   constexpr u32 MAX_DELAY_MS = 1000 / CONFIG_FREERTOS_HZ;
@@ -56,22 +283,7 @@ void lvgl_port_task(void* arg) {
     ui::Ui::the().initialize();
   }
 
-  auto event_queue = xQueueCreate(5, sizeof(Data::Event));
-
-  esp_event_handler_register(
-      DATA_EVENT_BASE, ESP_EVENT_ANY_ID,
-      [](void* event_queue, esp_event_base_t, auto event_id, void*) {
-        xQueueSend(static_cast<QueueHandle_t>(event_queue), &event_id, 10);
-      },
-      event_queue);
-
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::PrepareDeepSleep,
-      [](void* event_queue, esp_event_base_t, int32_t, void*) {
-        xQueueSend(static_cast<QueueHandle_t>(event_queue),
-                   &LVGL_EVENT_QUEUE_PREPARE_DEEP_SLEEP_ENTRY, 10);
-      },
-      event_queue);
+  auto* events = Data::events().subscribe("LVGL", Data::EventBus::ALL_EVENTS);
 
   ESP_LOGI("Display", "Starting LVGL task");
   xSemaphoreGive(s_lvgl_port_task_sync);
@@ -86,32 +298,31 @@ void lvgl_port_task(void* arg) {
 #if SLEEP_ON_DISPLAY_INACTIVITY
       if (lv_display_get_inactive_time(NULL) >
           DEEP_SLEEP_DISPLAY_INACTIVITY_MS) {
-        esp_event_post(DATA_EVENT_BASE, Data::Event::Inactivity, NULL, 0, 10);
+        Data::publish(Data::Event::Inactivity);
         lv_display_trigger_activity(NULL);
       }
 #endif
     }
 
-    Data::Event event;
-    if (xQueuePeek(event_queue, &event, pdMS_TO_TICKS(time_until_next))) {
-      bool should_quit = false;
-      while (uxQueueMessagesWaiting(event_queue) > 0) {
-        i32 event;
-        xQueueReceive(event_queue, &event, 20);
-        if (event == LVGL_EVENT_QUEUE_PREPARE_DEEP_SLEEP_ENTRY) {
-          should_quit = true;
-          break;
-        }
-
-        lv_obj_send_event(ui::Ui::the().data_event_obj(),
-                          ui::Ui::the().data_event(), &event);
-      }
+    if (ulTaskNotifyTake(true, pdMS_TO_TICKS(time_until_next)) == 0)
+      continue;
 
-      if (should_quit)
+    bool should_quit = false;
+    while (auto event = events->poll()) {
+      if (*event == Data::Event::PrepareDeepSleep) {
+        should_quit = true;
         break;
+      }
+
+      lv_obj_send_event(ui::Ui::the().data_event_obj(),
+                        ui::Ui::the().data_event(), &*event);
     }
+
+    if (should_quit)
+      break;
   }
 
+  Data::events().unsubscribe(events);
   deep_sleep.ready();
   vTaskDelete(NULL);
 }
@@ -131,7 +342,8 @@ void init_display() {
       .sclk_io_num = DP_SCK,
       .quadwp_io_num = -1,
       .quadhd_io_num = -1,
-      .max_transfer_sz = DP_H_RES * 80 * sizeof(uint16_t),
+      // a whole draw buffer fits into a single transaction
+      .max_transfer_sz = LVGL_DRAW_BUF_SIZE,
   };
   ESP_ERROR_CHECK(spi_bus_initialize(DP_HOST, &buscfg, SPI_DMA_CH_AUTO));
 
@@ -171,16 +383,28 @@ void init_display() {
 
   lv_display_t* display = lv_display_create(DP_H_RES, DP_V_RES);
 
-  size_t draw_buffer_sz = DP_H_RES * LVGL_DRAW_BUF_LINES * sizeof(lv_color16_t);
+  // LVGL renders into one buffer while the other one is being transferred.
+  // Both have to be DMA capable, otherwise the SPI driver would copy them
+  // into a bounce buffer first.
+  void* buf1 = heap_caps_malloc(LVGL_DRAW_BUF_SIZE, MALLOC_CAP_DMA);
+  void* buf2 = heap_caps_malloc(LVGL_DRAW_BUF_SIZE, MALLOC_CAP_DMA);
+  assert(buf1 && buf2);
 
-  void* buf1 = malloc(draw_buffer_sz);
-  void* buf2 = malloc(draw_buffer_sz);
-
-  lv_display_set_buffers(display, buf1, buf2, draw_buffer_sz,
+  lv_display_set_buffers(display, buf1, buf2, LVGL_DRAW_BUF_SIZE,
                          LV_DISPLAY_RENDER_MODE_PARTIAL);
   lv_display_set_user_data(display, g_panel_handle);
-  lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565);
+  lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565_SWAPPED);
   lv_display_set_flush_cb(display, lvgl_flush_cb);
+  g_flush_done = xSemaphoreCreateBinary();
+  lv_display_set_flush_wait_cb(display, lvgl_flush_wait_cb);
+  lv_display_add_event_cb(display, lvgl_invalidate_area_cb,
+                          LV_EVENT_INVALIDATE_AREA, NULL);
+#if LOG_DISPLAY_FRAME_STATISTICS
+  lv_display_add_event_cb(display, lvgl_refresh_event_cb, LV_EVENT_REFR_START,
+                          NULL);
+  lv_display_add_event_cb(display, lvgl_refresh_event_cb, LV_EVENT_REFR_READY,
+                          NULL);
+#endif
 
   ESP_LOGI("Display", "Install LVGL tick timer");
   esp_timer_create_args_t const lvgl_tick_timer_args = {
@@ -200,6 +424,13 @@ void init_display() {
   ESP_ERROR_CHECK(esp_lcd_panel_io_register_event_callbacks(g_panel_io_handle,
                                                             &cbs, display));
 
+  ESP_LOGI("Display", "Create flush task");
+  // LVGL flushes at most one draw buffer at a time
+  g_flush_jobs = xQueueCreate(1, sizeof(FlushJob));
+  xTaskCreate(display_flush_task, "Display flush",
+              DISPLAY_FLUSH_TASK_STACK_SIZE, NULL, DISPLAY_FLUSH_TASK_PRIORITY,
+              NULL);
+
   ESP_LOGI("Display", "Create LVGL task");
   s_lvgl_port_task_sync = xSemaphoreCreateBinary();
   xTaskCreate(lvgl_port_task, "LVGL", LVGL_TASK_STACK_SIZE, NULL,
@@ -243,9 +474,8 @@ void chsc6x_get_xy(u8* x, u8* y) {
   u8 temp[CHSC6X_READ_POINT_LEN] = {0};
   u8 tx = 0;
 
-  auto res =
-      i2c_master_transmit_receive(g_chsc6x_handle, &tx, 1, temp,
-                                  CHSC6X_READ_POINT_LEN, CHSC6X_I2C_TIMEOUT_MS);
+  auto res = g_chsc6x->transmit_receive(&tx, 1, temp, CHSC6X_READ_POINT_LEN,
+                                        CHSC6X_I2C_TIMEOUT_MS);
   if (res != ESP_OK) {
     ESP_LOGI("CHSC6X", "Couldn't receive from I2C");
     *x = 0;
@@ -301,14 +531,10 @@ void chsc6x_read(lv_indev_t* indev, lv_indev_data_t* data) {
   data->point.y = last_touch_y = touch_y;
 }
 
-void init_display_touch(i2c_master_bus_handle_t i2c_handle) {
-  i2c_device_config_t dev = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = I2C_CHSC6X_ADDR,
-      .scl_speed_hz = CHSC6X_I2C_SPEED,
-  };
-  ESP_ERROR_CHECK(
-      i2c_master_bus_add_device(i2c_handle, &dev, &g_chsc6x_handle));
+void init_display_touch(I2cBus& bus) {
+  // the UI waits for touch reads, so they go before the RTC's transfers
+  g_chsc6x = bus.add_device(I2C_CHSC6X_ADDR, CHSC6X_I2C_SPEED, "CHSC6X",
+                            I2cPriority::High);
 
   gpio_set_direction(DP_TOUCH_INT, GPIO_MODE_INPUT);
   gpio_set_pull_mode(DP_TOUCH_INT, GPIO_PULLUP_ONLY);
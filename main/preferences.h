@@ -1,6 +1,7 @@
 #pragma once
 
 #include <nvs_handle.hpp>
+#include <type_traits>
 #include <types.h>
 
 class Preferences {
@@ -17,6 +18,30 @@ public:
   void set_bool(char const* key, bool b);
   std::optional<bool> get_bool(char const* key);
 
+  /// Stores `value` as raw bytes. `T` must be trivially copyable and its
+  /// layout must stay the same between firmware versions reading the key.
+  template <typename T>
+  void set_blob(char const* key, T const& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    ESP_ERROR_CHECK(m_handle->set_blob(key, &value, sizeof(T)));
+  }
+
+  /// Returns `std::nullopt` if `key` doesn't exist or its size doesn't match
+  /// `T`, e.g. because it was written by an older firmware.
+  template <typename T>
+  std::optional<T> get_blob(char const* key) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    size_t size;
+    auto result = m_handle->get_item_size(nvs::ItemType::BLOB, key, size);
+    if (result == ESP_ERR_NVS_NOT_FOUND || size != sizeof(T))
+      return std::nullopt;
+    ESP_ERROR_CHECK(result);
+
+    T value;
+    ESP_ERROR_CHECK(m_handle->get_blob(key, &value, sizeof(T)));
+    return value;
+  }
+
 private:
   std::unique_ptr<nvs::NVSHandle> const m_handle;
 };
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <types.h>
+#include <util.h>
+
+/// Geometry of a round panel behind a square frame of `SIZE` x `SIZE` pixels.
+/// Everything outside of the panel's inscribed circle is never visible, so
+/// flushed areas are clipped to it. Kept free of LVGL and ESP-IDF, so the
+/// flush path can be benchmarked on the host.
+template <i32 SIZE> class RoundPanel {
+public:
+  static_assert(SIZE % 2 == 0 && SIZE / 2 <= 256);
+
+  /// Inclusive pixel coordinates, like `lv_area_t`
+  struct Area {
+    i32 x1, y1, x2, y2;
+
+    i32 width() const { return x2 + 1 - x1; }
+    i32 height() const { return y2 + 1 - y1; }
+  };
+
+  RoundPanel() {
+    constexpr i32 RADIUS = SIZE / 2;
+    for (i32 y = 0; y < SIZE; ++y) {
+      // distance from the center to the nearest edge of the row
+      i32 dy = y < RADIUS ? RADIUS - (y + 1) : y - RADIUS;
+      i32 x = 0;
+      while (sq(RADIUS - (x + 1)) + sq(dy) >= sq(RADIUS))
+        ++x;
+      m_chord_start[y] = x & ~1;
+    }
+  }
+
+  /// The first column of row `i` that is at least partially visible, rounded
+  /// down to an even column. As the panel is square, it is also the first
+  /// visible row of column `i`.
+  i32 chord_start(i32 i) const { return m_chord_start[i]; }
+  i32 chord_end(i32 i) const { return SIZE - 1 - m_chord_start[i]; }
+  /// The row (or column) in [first, last] with the longest visible chord.
+  static i32 widest_chord(i32 first, i32 last) {
+    return std::clamp<i32>(SIZE / 2, first, last);
+  }
+
+  /// The rows `y1` to `y2` of `area`, clipped to the chord of their widest
+  /// row. `std::nullopt` if none of them is visible.
+  std::optional<Area> visible_band(Area const& area, i32 y1, i32 y2) const {
+    auto row = widest_chord(y1, y2);
+    auto x1 = std::max<i32>(area.x1, chord_start(row));
+    auto x2 = std::min<i32>(area.x2, chord_end(row));
+    if (x1 > x2)
+      return std::nullopt;
+    return Area{x1, y1, x2, y2};
+  }
+
+  /// Moves the rows of `band` in `pixels`, which hold all of `area`, together
+  /// in place, so the band can be sent as one rectangle. Returns the band's
+  /// first pixel.
+  static u16* compact_band(u16* pixels, Area const& area, Area const& band) {
+    auto* first = pixels + (band.y1 - area.y1) * area.width();
+    auto width = band.width();
+    if (width != area.width()) {
+      for (i32 i = 0; i < band.height(); ++i) {
+        memmove(first + i * width,
+                first + i * area.width() + (band.x1 - area.x1),
+                width * sizeof(u16));
+      }
+    }
+    return first;
+  }
+
+private:
+  std::array<u8, SIZE> m_chord_start;
+};
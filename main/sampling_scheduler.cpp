@@ -0,0 +1,101 @@
+#include "sampling_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <util.h>
+
+/// Last known battery level, so the wakeup period can be chosen while only
+/// checking the environment.
+RTC_DATA_ATTR static u8 rtc_battery_percentage = 100;
+
+SamplingScheduler& SamplingScheduler::the() {
+  static SamplingScheduler scheduler;
+  return scheduler;
+}
+
+void SamplingScheduler::request_orientation() {
+  m_orientation_requested_until_ms.store(millis() + ORIENTATION_LEASE_MS,
+                                         std::memory_order_relaxed);
+}
+
+SamplingScheduler::ImuProfile SamplingScheduler::imu_profile() const {
+  auto until = m_orientation_requested_until_ms.load(std::memory_order_relaxed);
+  // signed difference, so the comparison survives millis() wrapping around
+  if (static_cast<i32>(until - millis()) > 0)
+    return ImuProfile::Orientation;
+  return ImuProfile::GesturesOnly;
+}
+
+void SamplingScheduler::report_co2(u16 co2_ppm) {
+  m_co2_history[m_co2_history_next] = co2_ppm;
+  m_co2_history_next = (m_co2_history_next + 1) % CO2_HISTORY_SIZE;
+  if (m_co2_history_size < CO2_HISTORY_SIZE)
+    ++m_co2_history_size;
+
+  if (m_co2_history_size < CO2_HISTORY_SIZE || co2_ppm >= ALWAYS_FAST_CO2_PPM) {
+    m_environment_stable = false;
+    return;
+  }
+
+  float mean = 0;
+  for (auto v : m_co2_history)
+    mean += v;
+  mean /= CO2_HISTORY_SIZE;
+
+  float variance = 0;
+  for (auto v : m_co2_history)
+    variance += (v - mean) * (v - mean);
+  variance /= CO2_HISTORY_SIZE;
+
+  auto stable = variance < STABLE_CO2_STDDEV_PPM * STABLE_CO2_STDDEV_PPM;
+  if (stable != m_environment_stable.exchange(stable)) {
+    ESP_LOGI("Scheduler", "Environment is %s (σ = %.1f ppm)",
+             stable ? "stable" : "changing", sqrtf(variance));
+  }
+}
+
+void SamplingScheduler::report_battery_percentage(u8 percentage) {
+  rtc_battery_percentage = percentage;
+}
+
+bool SamplingScheduler::battery_low() const {
+  return rtc_battery_percentage <= LOW_BATTERY_PERCENTAGE;
+}
+
+Scd41::Mode SamplingScheduler::scd_mode() const {
+  if (battery_low())
+    return Scd41::Mode::SingleShot;
+  if (m_environment_stable)
+    return Scd41::Mode::LowPowerPeriodic;
+  return Scd41::Mode::Periodic;
+}
+
+Scd41::Mode SamplingScheduler::environment_check_scd_mode() const {
+  // The sensor is powered down during deep sleep, after which the first single
+  // shot measurement has to be discarded. Periodic mode delivers a usable
+  // measurement the fastest, which keeps the time the device is awake short.
+  return Scd41::Mode::Periodic;
+}
+
+u32 SamplingScheduler::environment_read_interval_ms() const {
+  switch (scd_mode()) {
+  case Scd41::Mode::SingleShot:
+    return LOW_BATTERY_ENV_READ_INTERVAL_MS;
+  case Scd41::Mode::LowPowerPeriodic:
+    return Scd41::LOW_POWER_PERIODIC_MEASUREMENT_INTERVAL_MS;
+  default:
+    return Scd41::PERIODIC_MEASUREMENT_INTERVAL_MS;
+  }
+}
+
+u32 SamplingScheduler::sgp_samples_for_gap(i64 gap_ms) {
+  // a negative gap means the clock was changed
+  gap_ms =
+      std::clamp<i64>(gap_ms, SGP_READ_INTERVAL_MS, SGP_MAX_BRIDGED_GAP_MS);
+  return static_cast<u32>(gap_ms / SGP_READ_INTERVAL_MS);
+}
+
+u64 SamplingScheduler::wakeup_period_ms() const {
+  return battery_low() ? LOW_BATTERY_WAKEUP_PERIOD_MS : WAKEUP_PERIOD_MS;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <scd41.h>
+#include <types.h>
+
+/// Decides how often the sensors are sampled.
+///
+/// The sensor tasks ask the scheduler for their current interval or mode
+/// instead of using fixed constants. The decision is based on:
+///  - how much the CO2 concentration changed recently: a stable signal
+///    doesn't need to be measured as often, so the SCD41 can use one of its
+///    low power modes,
+///  - whether the UI currently needs the device's orientation: without it,
+///    the IMU only has to be fast enough for gesture detection,
+///  - the battery level: when it's low, everything is sampled slower.
+///
+/// The SGP41 is not scheduled, as the gas index algorithm requires the fixed
+/// sampling interval it was initialized with. During deep sleep, it is only
+/// sampled once per wakeup, and the missed samples are bridged (see
+/// `sgp_samples_for_gap()`).
+class SamplingScheduler {
+public:
+  enum class ImuProfile {
+    /// Full rate, for the compass and rotary input
+    Orientation,
+    /// Reduced rate that is still enough for the set-down gesture
+    GesturesOnly,
+  };
+
+  /// Sampling interval of the SGP41, fixed by the gas index algorithm.
+  static constexpr u32 SGP_READ_INTERVAL_MS = 1000;
+  /// Longest gap in the SGP41 samples that is bridged. The gas index algorithm
+  /// adapts over hours, so a longer gap is only bridged up to this length.
+  static constexpr i64 SGP_MAX_BRIDGED_GAP_MS = 10 * 60 * 1000;
+
+  /// Number of times an SGP41 measurement has to be fed to the gas index
+  /// algorithm if the previous one was `gap_ms` ago.
+  static u32 sgp_samples_for_gap(i64 gap_ms);
+
+  static SamplingScheduler& the();
+
+  /// The firmware uses `the()`. Separate instances are for simulations,
+  /// where e.g. a reboot after deep sleep starts with a fresh scheduler.
+  SamplingScheduler() = default;
+
+  /// Keeps the IMU in `ImuProfile::Orientation` for the next
+  /// `ORIENTATION_LEASE_MS`. Called periodically by UI elements that display
+  /// orientation data while they are visible.
+  void request_orientation();
+  ImuProfile imu_profile() const;
+
+  /// Called by the environment task for every new measurement.
+  void report_co2(u16 co2_ppm);
+  /// Called whenever the battery level was measured. The last value is kept
+  /// across deep sleep.
+  void report_battery_percentage(u8 percentage);
+
+  /// Mode the SCD41 should run in while the device is awake.
+  Scd41::Mode scd_mode() const;
+  /// Mode the SCD41 should use for the environment check during a deep sleep
+  /// wakeup.
+  Scd41::Mode environment_check_scd_mode() const;
+  u32 environment_read_interval_ms() const;
+  /// Period of the deep sleep wakeups for checking the environment.
+  u64 wakeup_period_ms() const;
+
+private:
+  static constexpr u32 ORIENTATION_LEASE_MS = 1000;
+
+  /// Interval of single shot measurements while the battery is low
+  static constexpr u32 LOW_BATTERY_ENV_READ_INTERVAL_MS = 60 * 1000;
+  /// Number of CO2 measurements the variability is determined over
+  static constexpr size_t CO2_HISTORY_SIZE = 6;
+  /// Standard deviation of the CO2 measurements in ppm below which the
+  /// environment is considered stable.
+  static constexpr float STABLE_CO2_STDDEV_PPM = 15.f;
+  /// CO2 concentration above which the environment is always sampled fast,
+  /// so warnings aren't delayed.
+  static constexpr u16 ALWAYS_FAST_CO2_PPM = 1000;
+
+  static constexpr u64 WAKEUP_PERIOD_MS = 60 * 1000;
+  static constexpr u64 LOW_BATTERY_WAKEUP_PERIOD_MS = 5 * 60 * 1000;
+  static constexpr u8 LOW_BATTERY_PERCENTAGE = 20;
+
+  bool battery_low() const;
+
+  std::atomic<u32> m_orientation_requested_until_ms = 0;
+
+  // only accessed from the environment task
+  std::array<u16, CO2_HISTORY_SIZE> m_co2_history{};
+  size_t m_co2_history_next = 0;
+  size_t m_co2_history_size = 0;
+
+  std::atomic<bool> m_environment_stable = false;
+};
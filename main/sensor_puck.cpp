@@ -1,6 +1,8 @@
 #include "battery.h"
 #include "display_driver.h"
+#include <algorithm>
 #include <bm8563.h>
+#include <cstdlib>
 #include <data.h>
 #include <driver/adc.h>
 #include <driver/i2c_master.h>
@@ -14,10 +16,14 @@
 #include <esp_task_wdt.h>
 #include <esp_vfs.h>
 #include <esp_vfs_fat.h>
+#include <i2c_bus.h>
+#include <irq_source.h>
 #include <lis2mdl.h>
 #include <lsm6dsox.h>
 #include <lvgl.h>
 #include <mbedtls/base64.h>
+#include <preferences.h>
+#include <sampling_scheduler.h>
 #include <scd41.h>
 #include <sgp41.h>
 #include <st25dv.h>
@@ -30,17 +36,37 @@
 // some include in this file fucks the compiler so hard omg
 #include <ble_peripheral_manager.h>
 
-#define SCD_LOW_POWER false
-
-constexpr u64 WAKEUP_PERIOD_MS = 60 * 1000;
-
 constexpr u32 ENV_TASK_STACK_SIZE = 5 * 1024;
-constexpr u32 ENV_READ_INTERVAL_MS = 5 * 1000;
-// Should be the same as the sampling interval of the gas index algorithm
-constexpr u32 SGP_READ_INTERVAL_MS = 1000;
 
 constexpr u32 LSM_TASK_STACK_SIZE = 5 * 1024;
-constexpr u32 LSM_READ_INTERVAL_MS = 50;
+/// Data rate while the UI needs the device's orientation
+constexpr Lsm6dsox::DataRate LSM_ORIENTATION_DATA_RATE =
+    Lsm6dsox::DataRate::Rate104Hz;
+constexpr i64 LSM_ORIENTATION_SAMPLE_PERIOD_US = 1000 * 1000 / 104;
+/// Data rate while only gestures are detected. The sensor then runs in
+/// low-power mode.
+constexpr Lsm6dsox::DataRate LSM_GESTURE_DATA_RATE =
+    Lsm6dsox::DataRate::Rate52Hz;
+constexpr i64 LSM_GESTURE_SAMPLE_PERIOD_US = 1000 * 1000 / 52;
+/// Accelerometer data rate tap recognition for the set-down gesture needs
+constexpr Lsm6dsox::DataRate LSM_TAP_DATA_RATE = Lsm6dsox::DataRate::Rate417Hz;
+/// FIFO level (in accelerometer + gyroscope samples) at which a batch is ready.
+/// At 104Hz, this is roughly every 50ms, at 52Hz every 100ms.
+constexpr u16 LSM_FIFO_WATERMARK_SAMPLES = 5;
+/// Time to wait for the FIFO watermark interrupt before reading anyway
+constexpr u32 LSM_IRQ_TIMEOUT_MS = 100;
+constexpr u32 LSM_FIFO_WATERMARK_BIT = 0x02;
+constexpr u32 LSM_SET_DOWN_GESTURE_BIT = 0x04;
+static_assert(((LSM_FIFO_WATERMARK_BIT | LSM_SET_DOWN_GESTURE_BIT) &
+               DeepSleepPreparation::NOTIFICATION_BIT) == 0);
+/// Threshold of the hardware set-down gesture in units of full scale / 32
+/// (125mg at ±4g), i.e. 1g.
+constexpr u8 SDG_TAP_THRESHOLD = 8;
+/// Maximum number of samples read from the FIFO at once
+constexpr size_t LSM_MAX_BATCH_SIZE = 32;
+/// How many sample periods the reconstructed timestamps may deviate from the
+/// time a batch was read at before they are re-anchored to it.
+constexpr i64 LSM_MAX_TIMESTAMP_DRIFT_SAMPLES = 4;
 
 constexpr u32 BEEP_DURATION_MS = 100;
 constexpr u32 BEEP_COUNT = 2;
@@ -52,6 +78,8 @@ constexpr char const* NFC_URL_ADDRESS = "sensor-puck.web.app?d=";
 
 i2c_master_bus_handle_t g_i2c_handle;
 i2c_master_bus_handle_t g_lcd_i2c_handle;
+I2cBus* g_i2c_bus;
+I2cBus* g_lcd_i2c_bus;
 
 /// Handle to the wear leveling library.
 static wl_handle_t s_wl_handle = WL_INVALID_HANDLE;
@@ -59,6 +87,7 @@ static wl_handle_t s_wl_handle = WL_INVALID_HANDLE;
 St25dv16kc* g_nfc;
 Bm8563* g_rtc;
 Scd41* g_scd;
+Sgp41* g_sgp;
 
 /// If the user timer duration is <= this value, we don't go to sleep and
 /// instead wait for the timer to expire.
@@ -84,6 +113,9 @@ struct EnvironmentData {
   u16 co2;
   float temperature;
   float humidity;
+  bool has_gas_indices = false;
+  u16 voc_index;
+  u16 nox_index;
 };
 
 RTC_DATA_ATTR EnvironmentData rtc_env_data = {};
@@ -91,6 +123,29 @@ RTC_DATA_ATTR bool rtc_check_env_only = false;
 
 RTC_DATA_ATTR bool rtc_did_condition_sgp41 = false;
 RTC_DATA_ATTR Sgp41::GasIndexAlgorithm rtc_sgp41_gia = {};
+RTC_DATA_ATTR time_t rtc_last_gia_snapshot = 0;
+/// Wall clock time of the last SGP41 sample in ms, 0 if there was none yet.
+RTC_DATA_ATTR i64 rtc_sgp41_last_sample_ms = 0;
+
+/// Copy of the gas index algorithm state in flash. RTC memory is lost on power
+/// loss, after which the algorithm would otherwise have to learn for hours.
+struct GasIndexAlgorithmSnapshot {
+  /// Must be incremented whenever the layout of the snapshot or the algorithm
+  /// state changes.
+  static constexpr u32 CURRENT_VERSION = 2;
+
+  u32 version;
+  /// Wall clock time the snapshot was taken at
+  time_t timestamp;
+  Sgp41::GasIndexAlgorithm gia;
+};
+
+constexpr char const* PREFERENCES_GIA_SNAPSHOT = "sgp41_gia";
+/// Snapshots are written this rarely to limit flash wear.
+constexpr time_t GIA_SNAPSHOT_INTERVAL_S = 30 * 60;
+/// Older snapshots are discarded, since the air might have changed too much
+/// for the learned state to still be valid.
+constexpr time_t GIA_SNAPSHOT_MAX_AGE_S = 60 * 60;
 
 template <typename T>
 void num_to_bytes(u8* buf, size_t& idx, T num, i64 width) {
@@ -167,7 +222,8 @@ void update_nfc_data() {
 
   auto record = nfc::build_ndef_uri_record(nfc::UriPrefix::Https, uri);
   ESP_LOGI("NFC", "Writing record of length %d", record.length);
-  g_nfc->write_ndef_record(record);
+  if (!g_nfc->write_ndef_record(record))
+    ESP_LOGW("NFC", "Writing record failed");
   nfc::free_ndef_record(record);
 }
 
@@ -179,24 +235,31 @@ void update_nfc_data_if_necessary() {
   update_nfc_data();
 }
 
-bool read_environment_sensors() {
+Scd41::ReadResult read_environment_sensors(bool check_data_ready = true) {
   auto data = Data::the();
-  auto scd_data = g_scd->read();
+  Scd41::Data scd_data;
+  auto result = g_scd->read(scd_data, check_data_ready);
 
-  if (scd_data) {
-    data->update_temperature(scd_data->temperature);
-    data->update_humidity(scd_data->humidity);
-    data->update_co2_ppm(scd_data->co2);
+  switch (result) {
+  case Scd41::ReadResult::Ok:
+    SamplingScheduler::the().report_co2(scd_data.co2);
+    data->update_temperature(scd_data.temperature);
+    data->update_humidity(scd_data.humidity);
+    data->update_co2_ppm(scd_data.co2);
 
     rtc_env_data.has_values = true;
-    rtc_env_data.co2 = scd_data->co2;
-    rtc_env_data.temperature = scd_data->temperature;
-    rtc_env_data.humidity = scd_data->humidity;
-    return true;
-  } else {
+    rtc_env_data.co2 = scd_data.co2;
+    rtc_env_data.temperature = scd_data.temperature;
+    rtc_env_data.humidity = scd_data.humidity;
+    break;
+  case Scd41::ReadResult::Discarded:
+    break;
+  case Scd41::ReadResult::NotReady:
+  case Scd41::ReadResult::Failed:
     ESP_LOGW("SCD41", "Failed reading sensor!");
-    return false;
+    break;
   }
+  return result;
 }
 
 void environment_read_task(void* arg) {
@@ -206,50 +269,149 @@ void environment_read_task(void* arg) {
 
   ESP_LOGI("ENV", "Sensors initialized");
 
+  auto wait = [&](TickType_t ticks) {
+    return deep_sleep.wait_for_event(ticks);
+  };
+
+  // whether the SCD41 replaced a discarded single shot measurement with a new
+  // one, which is then waited for right away
+  bool single_shot_pending = false;
   while (true) {
+    auto& scheduler = SamplingScheduler::the();
+    g_scd->set_mode(scheduler.scd_mode());
+
+    auto single_shot = g_scd->mode() == Scd41::Mode::SingleShot;
+    if (single_shot && !single_shot_pending)
+      g_scd->measure_single_shot();
+
+    // in the periodic modes, this also paces the loop
+    auto result = g_scd->wait_for_data(wait);
+    if (result == Scd41::WaitResult::Aborted)
+      break;
+    single_shot_pending = result == Scd41::WaitResult::Ready &&
+                          read_environment_sensors(false) ==
+                              Scd41::ReadResult::Discarded;
+
     {
-      read_environment_sensors();
-      Data::the()->update_battery_voltage(battery.read_voltage());
+      auto d = Data::the();
+      d->update_battery_voltage(battery.read_voltage());
+      scheduler.report_battery_percentage(d->battery_percentage());
     }
 
     update_nfc_data_if_necessary();
 
-    if (deep_sleep.wait_for_event(pdMS_TO_TICKS(ENV_READ_INTERVAL_MS))) {
-      ESP_LOGI("ENV", "Powering down...");
-      g_scd->power_down();
-      deep_sleep.ready();
+    if (single_shot && !single_shot_pending &&
+        wait(pdMS_TO_TICKS(scheduler.environment_read_interval_ms() -
+                           Scd41::SINGLE_SHOT_DURATION_MS))) {
       break;
     }
   }
 
+  ESP_LOGI("ENV", "Powering down...");
+  g_scd->power_down();
+  deep_sleep.ready();
+
   vTaskDelete(NULL);
 }
 
+/// Restores the gas index algorithm from its snapshot in flash, if there is a
+/// recent one that is compatible with the current firmware.
+bool restore_gas_index_algorithm() {
+  auto snapshot = Preferences::instance().get_blob<GasIndexAlgorithmSnapshot>(
+      PREFERENCES_GIA_SNAPSHOT);
+  if (!snapshot)
+    return false;
+
+  // a negative age means the clock was reset
+  auto age = time(NULL) - snapshot->timestamp;
+  if (snapshot->version != GasIndexAlgorithmSnapshot::CURRENT_VERSION ||
+      snapshot->gia.sampling_interval_s() !=
+          SamplingScheduler::SGP_READ_INTERVAL_MS / 1000.f ||
+      age < 0 || age > GIA_SNAPSHOT_MAX_AGE_S) {
+    ESP_LOGI("SGP41", "Ignoring incompatible or outdated snapshot");
+    return false;
+  }
+
+  ESP_LOGI("SGP41", "Restoring gas index algorithm snapshot from %lld s ago",
+           static_cast<i64>(age));
+  rtc_sgp41_gia = snapshot->gia;
+  rtc_last_gia_snapshot = snapshot->timestamp;
+  rtc_sgp41_last_sample_ms = static_cast<i64>(snapshot->timestamp) * 1000;
+  return true;
+}
+
+void save_gas_index_algorithm_snapshot_if_necessary() {
+  auto now = time(NULL);
+  if (now - rtc_last_gia_snapshot < GIA_SNAPSHOT_INTERVAL_S)
+    return;
+
+  rtc_last_gia_snapshot = now;
+  GasIndexAlgorithmSnapshot snapshot = {
+      .version = GasIndexAlgorithmSnapshot::CURRENT_VERSION,
+      .timestamp = now,
+      .gia = rtc_sgp41_gia,
+  };
+  Preferences::instance().set_blob(PREFERENCES_GIA_SNAPSHOT, snapshot);
+  ESP_LOGI("SGP41", "Saved gas index algorithm snapshot");
+}
+
+/// Samples the SGP41 and updates the gas indices. If samples were missed since
+/// the previous one (e.g. during deep sleep), the gap is bridged.
+bool read_sgp41(Sgp41& sgp) {
+  float temperature, humidity;
+  {
+    auto d = Data::the();
+    temperature = d->temperature();
+    humidity = d->humidity();
+  }
+
+  auto now_ms = timestamp_in_ms();
+  u32 samples = 1;
+  if (rtc_sgp41_last_sample_ms != 0) {
+    samples = SamplingScheduler::sgp_samples_for_gap(now_ms -
+                                                     rtc_sgp41_last_sample_ms);
+  }
+
+  auto values = sgp.read(temperature, humidity, rtc_sgp41_gia, samples);
+  if (!values) {
+    ESP_LOGE("SGP41", "Failed reading sensor!");
+    return false;
+  }
+
+  if (samples > 1)
+    ESP_LOGI("SGP41", "Bridged %lu missed samples", samples - 1);
+  rtc_sgp41_last_sample_ms = now_ms;
+
+  auto d = Data::the();
+  d->update_voc_index(values->voc_index);
+  d->update_nox_index(values->nox_index);
+
+  rtc_env_data.has_gas_indices = true;
+  rtc_env_data.voc_index = values->voc_index;
+  rtc_env_data.nox_index = values->nox_index;
+  return true;
+}
+
 void sgp_read_task(void* arg) {
-  Sgp41 sgp(g_i2c_handle);
+  DeepSleepPreparation deep_sleep;
+
+  auto& sgp = *g_sgp;
 
   if (!rtc_did_condition_sgp41) {
     rtc_did_condition_sgp41 = true;
 
-    rtc_sgp41_gia.initialize(SGP_READ_INTERVAL_MS / 1000.f);
+    if (!restore_gas_index_algorithm()) {
+      rtc_sgp41_gia.initialize(SamplingScheduler::SGP_READ_INTERVAL_MS /
+                               1000.f);
+      // don't persist a state that hasn't learned anything yet
+      rtc_last_gia_snapshot = time(NULL);
+    }
     sgp.turn_heater_off();
 
     ESP_LOGI("SGP41", "Performing conditioning. Waiting for temperature and "
                       "humidity data to be available...");
 
-    // wait for data to be available before adding a history entry
-    esp_event_handler_t handler = [](void* user_data, esp_event_base_t, i32,
-                                     void*) {
-      xTaskNotify(static_cast<TaskHandle_t>(user_data), 1,
-                  eSetValueWithOverwrite);
-    };
-
-    esp_event_handler_register(DATA_EVENT_BASE,
-                               Data::Event::EnvironmentDataUpdated, handler,
-                               xTaskGetCurrentTaskHandle());
-    ulTaskNotifyTake(true, portMAX_DELAY);
-    esp_event_handler_unregister(DATA_EVENT_BASE,
-                                 Data::Event::EnvironmentDataUpdated, handler);
+    Data::wait_for_environment_data();
 
     float temperature, humidity;
     {
@@ -261,58 +423,235 @@ void sgp_read_task(void* arg) {
              humidity);
     sgp.perform_conditioning(temperature, humidity);
     ESP_LOGI("SGP41", "Conditioning done!");
-  }
-
-  while (true) {
+  } else {
+    float temperature, humidity;
     {
       auto d = Data::the();
-      auto values = sgp.read(d->temperature(), d->humidity(), rtc_sgp41_gia);
-      if (values) {
-        d->update_voc_index(values->voc_index);
-        d->update_nox_index(values->nox_index);
-      } else {
-        ESP_LOGE("SGP41", "Failed reading sensor!");
-      }
+      temperature = d->temperature();
+      humidity = d->humidity();
     }
+    // the heater is turned off during deep sleep
+    sgp.heat_up(temperature, humidity);
+  }
 
-    vTaskDelay(pdMS_TO_TICKS(SGP_READ_INTERVAL_MS));
+  while (true) {
+    read_sgp41(sgp);
+    save_gas_index_algorithm_snapshot_if_necessary();
+
+    if (deep_sleep.wait_for_event(
+            pdMS_TO_TICKS(SamplingScheduler::SGP_READ_INTERVAL_MS))) {
+      break;
+    }
   }
 
+  ESP_LOGI("SGP41", "Turning heater off...");
+  sgp.turn_heater_off();
+  deep_sleep.ready();
+
   vTaskDelete(NULL);
 }
 
+/// Reconstructs the timestamps of FIFO samples, which don't carry any, from a
+/// continuous sample count. Consecutive samples are always one period apart,
+/// so the filters never see a sample that is older than the previous one.
+/// Batches are only re-anchored to the time they were read at if the count
+/// drifted too far from it, e.g. after a FIFO overrun or because the sensor's
+/// clock deviates from the nominal data rate.
+class SampleClock {
+public:
+  void reset(i64 period_us) {
+    m_period_us = period_us;
+    m_anchored = false;
+  }
+
+  /// Returns the timestamp of the first of `count` samples that were read at
+  /// `now_us`, the newest one having been taken just now.
+  i64 take(size_t count, i64 now_us) {
+    auto read_at = now_us - static_cast<i64>(count - 1) * m_period_us;
+    if (!m_anchored) {
+      m_next_us = read_at;
+      m_anchored = true;
+    } else if (std::abs(read_at - m_next_us) >
+               LSM_MAX_TIMESTAMP_DRIFT_SAMPLES * m_period_us) {
+      // never go back before the previous sample
+      m_next_us = std::max(read_at, m_next_us - m_period_us / 2);
+    }
+
+    auto first = m_next_us;
+    m_next_us += static_cast<i64>(count) * m_period_us;
+    return first;
+  }
+
+  i64 period_us() const { return m_period_us; }
+
+private:
+  i64 m_period_us = 0;
+  i64 m_next_us = 0;
+  bool m_anchored = false;
+};
+
+/// Configures the IMU's data rates for `profile` and returns the resulting
+/// sample period in µs.
+i64 configure_lsm(Lsm6dsox& lsm, SamplingScheduler::ImuProfile profile) {
+  auto orientation = profile == SamplingScheduler::ImuProfile::Orientation;
+  auto rate = orientation ? LSM_ORIENTATION_DATA_RATE : LSM_GESTURE_DATA_RATE;
+  ESP_LOGI("LSM", "Switching to %s data rate",
+           orientation ? "orientation" : "gesture");
+
+  auto power_mode = orientation ? Lsm6dsox::PowerMode::HighPerformance
+                                : Lsm6dsox::PowerMode::LowPower;
+
+#if HARDWARE_SET_DOWN_GESTURE
+  // Tap recognition needs a higher data rate than the one samples are batched
+  // at. The accelerometer always runs in high-performance mode at that rate.
+  lsm.set_data_rates(LSM_TAP_DATA_RATE, rate, power_mode);
+#else
+  lsm.set_data_rates(rate, rate, power_mode);
+#endif
+  lsm.enable_fifo(rate, LSM_FIFO_WATERMARK_SAMPLES * 2);
+  return orientation ? LSM_ORIENTATION_SAMPLE_PERIOD_US
+                     : LSM_GESTURE_SAMPLE_PERIOD_US;
+}
+
+/// Routes the IMU's FIFO watermark and set down gesture to the interrupt pins.
+void configure_lsm_interrupts(Lsm6dsox& lsm) {
+#if !SIMULATE_SENSOR_INTERRUPTS
+  lsm.set_fifo_watermark_interrupt(true);
+#endif
+#if HARDWARE_SET_DOWN_GESTURE
+  // the device's vertical axis is the sensor's z-axis
+  lsm.enable_single_tap(Lsm6dsox::Axis::Z, SDG_TAP_THRESHOLD);
+  lsm.set_single_tap_interrupt(true);
+  // clear a gesture that might still be latched from before deep sleep
+  lsm.single_tap_detected();
+#endif
+}
+
+void configure_lis(Lis2mdl& lis) {
+#if !SIMULATE_SENSOR_INTERRUPTS
+  // LIS2MDL runs faster than batches are read, so its data-ready line is only
+  // sampled instead of waking the task
+  lis.set_data_ready_on_pin(true);
+#endif
+}
+
 void lsm_read_task(void* arg) {
   DeepSleepPreparation deep_sleep;
 
-  Lsm6dsox lsm(g_i2c_handle);
-  Lis2mdl lis(g_i2c_handle);
+  Lsm6dsox lsm(*g_i2c_bus);
+  Lis2mdl lis(*g_i2c_bus);
+
+  auto imu_profile = SamplingScheduler::the().imu_profile();
+  SampleClock sample_clock;
+  sample_clock.reset(configure_lsm(lsm, imu_profile));
+  configure_lsm_interrupts(lsm);
+  configure_lis(lis);
+
+#if SIMULATE_SENSOR_INTERRUPTS
+  // fires at the rate the watermark would be reached at
+  SimulatedIrqSource fifo_irq(LSM_FIFO_WATERMARK_SAMPLES *
+                              sample_clock.period_us());
+#else
+  GpioIrqSource fifo_irq(LSM_INT1);
+  gpio_set_direction(LIS_INT, GPIO_MODE_INPUT);
+#endif
+  fifo_irq.attach(xTaskGetCurrentTaskHandle(), LSM_FIFO_WATERMARK_BIT);
+
+#if HARDWARE_SET_DOWN_GESTURE
+  GpioIrqSource sdg_irq(LSM_INT2);
+  sdg_irq.attach(xTaskGetCurrentTaskHandle(), LSM_SET_DOWN_GESTURE_BIT);
+#endif
+
+  Lsm6dsox::Data raw_samples[LSM_MAX_BATCH_SIZE];
+  Data::InertialSample samples[LSM_MAX_BATCH_SIZE];
+  u32 wake_count = 0;
 
   while (true) {
-    {
-      auto data = Data::the();
-      auto accel_gyro = lsm.read_sensor();
-      auto mag = lis.read_sensor();
-
-      if (accel_gyro && mag) {
-        auto mag_vec = Vector3(-mag->x, -mag->z, -mag->y);
-        // printf("(%.4f, %.4f, %.4f)\n", mag_vec.x, mag_vec.y, mag_vec.z);
-
-        data->update_inertial_measurements(
-            Vector3(-accel_gyro->acc_y, accel_gyro->acc_z, -accel_gyro->acc_x),
-            Vector3(accel_gyro->roll, accel_gyro->yaw, accel_gyro->pitch),
-            mag_vec);
-      } else {
-        if (!accel_gyro)
-          ESP_LOGW("LSM", "Failed reading sensor!");
-        if (!mag)
-          ESP_LOGW("LIS", "Failed reading sensor!");
+    // the sensors may have been reset while they weren't responding
+    if (lsm.reinitialize_if_requested()) {
+      sample_clock.reset(configure_lsm(lsm, imu_profile));
+      configure_lsm_interrupts(lsm);
+    }
+    if (lis.reinitialize_if_requested())
+      configure_lis(lis);
+
+#if SIMULATE_SENSOR_INTERRUPTS
+    auto sample_count = lsm.read_fifo(raw_samples, LSM_MAX_BATCH_SIZE);
+    auto mag = lis.read_sensor();
+#else
+    // the magnetometer is read on the bus while the FIFO bursts are decoded
+    if (gpio_get_level(LIS_INT))
+      lis.start_read_sensor();
+    auto sample_count = lsm.read_fifo(raw_samples, LSM_MAX_BATCH_SIZE);
+    auto mag = lis.finish_read_sensor();
+#endif
+    auto now = esp_timer_get_time();
+
+    // the timeout may wake the task before a sample is ready
+    if (sample_count && *sample_count > 0) {
+      auto first_timestamp_us = sample_clock.take(*sample_count, now);
+      for (size_t i = 0; i < *sample_count; ++i) {
+        auto const& raw = raw_samples[i];
+        // the gyroscope has to be mapped the same way as the accelerometer
+        // (pitch, roll and yaw are around the sensor's x-, y- and z-axis)
+        samples[i] = {
+            .acceleration = Vector3(-raw.acc_y, raw.acc_z, -raw.acc_x),
+            .rotation = Vector3(-raw.roll, raw.yaw, -raw.pitch),
+            .timestamp_us = first_timestamp_us +
+                            static_cast<i64>(i) * sample_clock.period_us(),
+        };
       }
+
+      std::optional<Vector3> mag_vec;
+      if (mag)
+        mag_vec = Vector3(-mag->x, -mag->z, -mag->y);
+
+      Data::the()->update_inertial_measurements(
+          std::span(samples, *sample_count), mag_vec);
+    } else if (!sample_count) {
+      ESP_LOGW("LSM", "Failed reading sensor!");
+    }
+
+    // The watermark interrupt is the regular wakeup. The timeout only
+    // guarantees progress should an edge ever be missed.
+    u32 notified_bits = 0;
+    xTaskNotifyWait(0, ULONG_MAX, &notified_bits,
+                    pdMS_TO_TICKS(LSM_IRQ_TIMEOUT_MS));
+    ++wake_count;
+
+    if (auto profile = SamplingScheduler::the().imu_profile();
+        profile != imu_profile) {
+      imu_profile = profile;
+      sample_clock.reset(configure_lsm(lsm, imu_profile));
+#if SIMULATE_SENSOR_INTERRUPTS
+      fifo_irq.set_period(LSM_FIFO_WATERMARK_SAMPLES *
+                          sample_clock.period_us());
+#endif
     }
 
-    if (deep_sleep.wait_for_event(pdMS_TO_TICKS(LSM_READ_INTERVAL_MS))) {
-      ESP_LOGI("LSM", "Powering down...");
-      lsm.set_accelerometer_data_rate(Lsm6dsox::DataRate::Off);
+#if HARDWARE_SET_DOWN_GESTURE
+    if ((notified_bits & LSM_SET_DOWN_GESTURE_BIT) != 0 &&
+        lsm.single_tap_detected()) {
+      Data::the()->report_set_down_gesture();
+    }
+#endif
+
+    if (deep_sleep.requested()) {
+      ESP_LOGI("LSM", "Powering down after %lu wakeups (%lu interrupts)...",
+               wake_count, fifo_irq.irq_count());
+      fifo_irq.detach();
+      lsm.disable_fifo();
+#if HARDWARE_SET_DOWN_GESTURE
+      sdg_irq.detach();
+#endif
+#if SET_DOWN_GESTURE_DEEP_SLEEP_WAKEUP
+      // the accelerometer keeps running for tap recognition, which wakes the
+      // device up through INT2
+      lsm.single_tap_detected();
       lsm.set_gyroscope_data_rate(Lsm6dsox::DataRate::Off);
+#else
+      lsm.set_data_rates(Lsm6dsox::DataRate::Off, Lsm6dsox::DataRate::Off);
+#endif
       lis.power_down();
 
       deep_sleep.ready();
@@ -363,36 +702,27 @@ void buzzer_beep(u32 beep_duration_ms, u32 pause_duration_ms, size_t count) {
 void buzzer_task(void* arg) {
   initialize_buzzer_ledc();
 
-  constexpr u32 ENVIRONMENT_DATA_UPDATED_BIT = 0x01;
-  constexpr u32 USER_TIMER_EXPIRED_BIT = 0x02;
-
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::EnvironmentDataUpdated,
-      [](void* task, char const*, auto, void*) {
-        xTaskNotify(static_cast<TaskHandle_t>(task),
-                    ENVIRONMENT_DATA_UPDATED_BIT, eSetBits);
-      },
-      xTaskGetCurrentTaskHandle());
-
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::UserTimerExpired,
-      [](void* task, char const*, auto, void*) {
-        xTaskNotify(static_cast<TaskHandle_t>(task), USER_TIMER_EXPIRED_BIT,
-                    eSetBits);
-      },
-      xTaskGetCurrentTaskHandle());
+  auto* events = Data::events().subscribe(
+      "Buzzer", Data::EventBus::mask(Data::Event::EnvironmentDataUpdated,
+                                     Data::Event::UserTimerExpired));
 
   i64 last_co2_beep = 0;
   while (true) {
-    u32 notified_value;
-    xTaskNotifyWait(false, ULONG_MAX, &notified_value, portMAX_DELAY);
+    ulTaskNotifyTake(true, portMAX_DELAY);
+
+    bool environment_data_updated = false;
+    bool user_timer_expired = false;
+    while (auto event = events->poll()) {
+      environment_data_updated |= *event == Data::Event::EnvironmentDataUpdated;
+      user_timer_expired |= *event == Data::Event::UserTimerExpired;
+    }
 
     if (Data::the()->muted() || Data::the()->is_upside_down()) {
       last_co2_beep = esp_timer_get_time();
       continue;
     }
 
-    if ((notified_value & ENVIRONMENT_DATA_UPDATED_BIT) != 0) {
+    if (environment_data_updated) {
       auto iaq = Data::the()->iaq();
 
       if (iaq <= Iaq::Fine)
@@ -418,7 +748,7 @@ void buzzer_task(void* arg) {
     env_data_updated_end:
     }
 
-    if ((notified_value & USER_TIMER_EXPIRED_BIT) != 0) {
+    if (user_timer_expired) {
       buzzer_beep(ui::TimerPage::BLINK_TIMER_PERIOD_MS,
                   ui::TimerPage::BLINK_TIMER_PERIOD_MS,
                   ui::TimerPage::BLINK_TIMER_REPEAT_COUNT);
@@ -429,8 +759,14 @@ void buzzer_task(void* arg) {
 }
 
 void update_system_time_from_rtc() {
+  auto maybe_rtc = g_rtc->read_date_time();
+  if (!maybe_rtc) {
+    ESP_LOGW("BM8563", "Reading RTC failed, keeping system time");
+    return;
+  }
+  auto const& rtc = *maybe_rtc;
+
   auto data = Data::the();
-  auto rtc = g_rtc->read_date_time();
   tm rt = {
       .tm_sec = rtc.second,
       .tm_min = rtc.minute,
@@ -461,7 +797,8 @@ void set_rtc_time(struct tm utc_tm) {
       .minute = static_cast<int8_t>(utc_tm.tm_min),
       .second = static_cast<int8_t>(utc_tm.tm_sec),
   };
-  g_rtc->set_date_time(dt);
+  if (!g_rtc->set_date_time(dt))
+    ESP_LOGW("BM8563", "Setting RTC time failed");
 }
 
 bool can_sleep() {
@@ -484,8 +821,13 @@ void enter_deep_sleep(bool sparse = false) {
   // matter?
 
   if (!sparse) {
-    esp_event_post(DATA_EVENT_BASE, Data::Event::PrepareDeepSleep, NULL, 0,
-                   pdMS_TO_TICKS(100));
+    Data::events().for_each_subscriber([](auto const& subscriber) {
+      ESP_LOGI("Sleep", "Event subscriber %s: %lu coalesced, %lu overflowed",
+               subscriber.name(), subscriber.coalesced_count(),
+               subscriber.overflow_count());
+    });
+    g_i2c_bus->log_statistics();
+    Data::publish(Data::Event::PrepareDeepSleep);
 
     // wait for deep sleep preparation to finish
     auto task_count = uxSemaphoreGetCount(s_prepare_deep_sleep_counter);
@@ -495,7 +837,8 @@ void enter_deep_sleep(bool sparse = false) {
                         true, true, pdMS_TO_TICKS(1000));
   }
 
-  esp_sleep_enable_timer_wakeup(WAKEUP_PERIOD_MS * 1000);
+  auto wakeup_period_ms = SamplingScheduler::the().wakeup_period_ms();
+  esp_sleep_enable_timer_wakeup(wakeup_period_ms * 1000);
   rtc_check_env_only = true;
 
   {
@@ -509,7 +852,7 @@ void enter_deep_sleep(bool sparse = false) {
       deep_sleep_timer.remaining_timer_duration =
           d->user_timer().remaining_duration_ms();
 
-      if (d->user_timer().remaining_duration_ms() <= WAKEUP_PERIOD_MS) {
+      if (d->user_timer().remaining_duration_ms() <= wakeup_period_ms) {
         rtc_check_env_only = false;
         esp_sleep_enable_timer_wakeup(
             static_cast<uint64_t>(d->user_timer().remaining_duration_ms()) *
@@ -539,6 +882,10 @@ void enter_deep_sleep(bool sparse = false) {
 
   ESP_ERROR_CHECK(rtc_gpio_pullup_en(DP_TOUCH_INT));
   ESP_ERROR_CHECK(esp_sleep_enable_ext0_wakeup(DP_TOUCH_INT, 0));
+#if SET_DOWN_GESTURE_DEEP_SLEEP_WAKEUP
+  ESP_ERROR_CHECK(esp_sleep_enable_ext1_wakeup(1ULL << LSM_INT2,
+                                               ESP_EXT1_WAKEUP_ANY_HIGH));
+#endif
   esp_deep_sleep_start();
 }
 
@@ -589,6 +936,11 @@ void pull_rtc_environment_data() {
   d->update_co2_ppm(rtc_env_data.co2);
   d->update_temperature(rtc_env_data.temperature);
   d->update_humidity(rtc_env_data.humidity);
+
+  if (rtc_env_data.has_gas_indices) {
+    d->update_voc_index(rtc_env_data.voc_index);
+    d->update_nox_index(rtc_env_data.nox_index);
+  }
 }
 
 /// Performs the periodic environment check and returns true if the device
@@ -600,10 +952,32 @@ bool perform_environment_check_with_notification_interrupt() {
     return false;
 
   recover_from_sleep();
-  while (!read_environment_sensors()) {
-    if (ulTaskNotifyTake(false, pdMS_TO_TICKS(5500)) != 0) {
+
+  // a touch interrupt notifies this task
+  auto wait = [](TickType_t ticks) {
+    return ulTaskNotifyTake(false, ticks) != 0;
+  };
+  while (true) {
+    auto result = g_scd->wait_for_data(wait);
+    if (result == Scd41::WaitResult::Aborted)
       return false;
+    if (result == Scd41::WaitResult::Ready &&
+        read_environment_sensors(false) == Scd41::ReadResult::Ok)
+      break;
+  }
+  ESP_LOGI("Setup", "Environment measured %lld ms after wakeup",
+           esp_timer_get_time() / 1000);
+
+  // The SGP41 is sampled once per wakeup, using the fresh temperature and
+  // humidity for compensation.
+  if (rtc_did_condition_sgp41) {
+    g_sgp = new Sgp41(*g_i2c_bus);
+    {
+      auto d = Data::the();
+      g_sgp->heat_up(d->temperature(), d->humidity());
     }
+    read_sgp41(*g_sgp);
+    g_sgp->turn_heater_off();
   }
 
   update_nfc_data();
@@ -614,6 +988,49 @@ bool perform_environment_check_with_notification_interrupt() {
   return true;
 }
 
+/// Handles `Data` events that aren't tied to a specific sensor or the UI.
+void system_event_task(void* arg) {
+  auto* events = Data::events().subscribe(
+      "System",
+      Data::EventBus::mask(Data::Event::TimeChanged, Data::Event::Inactivity));
+
+  while (true) {
+    ulTaskNotifyTake(true, portMAX_DELAY);
+
+    while (auto event = events->poll()) {
+      switch (*event) {
+      case Data::Event::TimeChanged:
+        xTaskCreate(
+            [](void*) {
+              // NOTE: Make sure to store UTC time, as the time is expected to
+              // be in UTC when read back in
+              tm utc_time = Data::get_utc_time();
+              set_rtc_time(utc_time);
+              vTaskDelete(NULL);
+            },
+            "Update RTC", 4 * 2048, NULL, 1, NULL);
+        break;
+      case Data::Event::Inactivity:
+        // entering deep sleep waits for other tasks, so don't block event
+        // handling while doing so
+        xTaskCreate(
+            [](void*) {
+              if (can_sleep()) {
+                enter_deep_sleep();
+              }
+              vTaskDelete(NULL);
+            },
+            "BEGIN DEEP SLP", 5 * 1024, NULL, BEGIN_DEEP_SLEEP_PRIORITY, NULL);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
 extern "C" void app_main() {
   // https://www.freertos.org/Documentation/02-Kernel/02-Kernel-features/06-Event-groups#:~:text=The%20number%20of%20bits%20(or%20flags)%20stored%20within%20an%20event%20group%20is%208%20if%20configUSE_16_BIT_TICKS%20is%20set%20to%201%2C%20or%2024%20if%20configUSE_16_BIT_TICKS%20is%20set%20to%200.
   auto ds_counter_max = configUSE_16_BIT_TICKS ? 8 : 24;
@@ -621,6 +1038,7 @@ extern "C" void app_main() {
   s_deep_sleep_ready_event_group = xEventGroupCreate();
 
   esp_event_loop_create_default();
+  gpio_install_isr_service(0);
 
   ESP_LOGI("Setup", "Initialize I2C master bus");
   gpio_reset_pin(B_SDA);
@@ -637,6 +1055,7 @@ extern "C" void app_main() {
           },
   };
   ESP_ERROR_CHECK(i2c_new_master_bus(&i2c_config, &g_i2c_handle));
+  g_i2c_bus = new I2cBus(g_i2c_handle, "I2C", I2C_BUS_TASK_PRIORITY);
 
   ESP_LOGI("Setup", "Initialize LCD I2C master bus");
   gpio_reset_pin(B_LCD_SDA);
@@ -653,6 +1072,8 @@ extern "C" void app_main() {
           },
   };
   ESP_ERROR_CHECK(i2c_new_master_bus(&lcd_i2c_config, &g_lcd_i2c_handle));
+  g_lcd_i2c_bus =
+      new I2cBus(g_lcd_i2c_handle, "LCD I2C", I2C_BUS_TASK_PRIORITY);
 
   initialize_nvs_flash();
 
@@ -669,17 +1090,16 @@ extern "C" void app_main() {
 
   Data::the()->initialize();
 
-  g_rtc = new Bm8563(g_lcd_i2c_handle);
+  g_rtc = new Bm8563(*g_lcd_i2c_bus);
   update_system_time_from_rtc();
 
-  g_nfc = new St25dv16kc(g_i2c_handle);
+  g_nfc = new St25dv16kc(*g_i2c_bus);
 
   if (rtc_check_env_only &&
       esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
     ESP_LOGI("Setup", "Checking env while staying silent...");
 
     gpio_set_intr_type(DP_TOUCH_INT, GPIO_INTR_NEGEDGE);
-    gpio_install_isr_service(0);
     gpio_isr_handler_add(
         DP_TOUCH_INT,
         [](void* task) {
@@ -691,12 +1111,8 @@ extern "C" void app_main() {
         },
         xTaskGetCurrentTaskHandle());
 
-    g_scd = new Scd41(g_i2c_handle);
-#if SCD_LOW_POWER
-    scd.start_low_power_periodic_measurement();
-#else
-    g_scd->start_periodic_measurement();
-#endif
+    g_scd = new Scd41(*g_i2c_bus);
+    g_scd->set_mode(SamplingScheduler::the().environment_check_scd_mode());
 
     if (perform_environment_check_with_notification_interrupt()) {
       g_scd->power_down();
@@ -715,48 +1131,15 @@ extern "C" void app_main() {
   pull_rtc_environment_data();
   recover_from_sleep();
 
-  init_display_touch(g_lcd_i2c_handle);
+  init_display_touch(*g_lcd_i2c_bus);
 
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::TimeChanged,
-      [](void*, esp_event_base_t, int32_t, void*) {
-        // don't block in event handler
-        xTaskCreate(
-            [](void*) {
-              // NOTE: Make sure to store UTC time, as the time is expected to
-              // be in UTC when read back in
-              tm utc_time = Data::get_utc_time();
-              set_rtc_time(utc_time);
-              vTaskDelete(NULL);
-            },
-            "Update RTC", 4 * 2048, NULL, 1, NULL);
-      },
-      NULL);
-
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::Inactivity,
-      [](void*, esp_event_base_t, i32, void*) {
-        // Don't block event handler. Probably doesn't actually matter here, but
-        // better safe than sorry.
-        xTaskCreate(
-            [](void*) {
-              if (can_sleep()) {
-                enter_deep_sleep();
-              }
-              vTaskDelete(NULL);
-            },
-            "BEGIN DEEP SLP", 5 * 1024, NULL, BEGIN_DEEP_SLEEP_PRIORITY, NULL);
-      },
-      NULL);
+  xTaskCreate(system_event_task, "SYS EVENTS", 2048, NULL, MISC_TASK_PRIORITY,
+              NULL);
 
-  if (!g_scd) {
-    g_scd = new Scd41(g_i2c_handle);
-#if SCD_LOW_POWER
-    scd.start_low_power_periodic_measurement();
-#else
-    g_scd->start_periodic_measurement();
-#endif
-  }
+  if (!g_scd)
+    g_scd = new Scd41(*g_i2c_bus);
+  if (!g_sgp)
+    g_sgp = new Sgp41(*g_i2c_bus);
 
   ESP_LOGI("Setup", "Starting sensor tasks");
   xTaskCreate(environment_read_task, "ENV SENS", ENV_TASK_STACK_SIZE, NULL,
@@ -0,0 +1,81 @@
+// Measures the CPU time the flush task spends preparing a full frame's pixels
+// for the panel: clipping the draw buffers to the round panel and compacting
+// the bands' rows. For comparison, the same with the RGB565 byte swap, which
+// was needed before LVGL rendered in the panel's byte order.
+//
+// Host timings only show the relative cost. On the ESP32-S3, the flush task
+// logs its prepare time with LOG_DISPLAY_FRAME_STATISTICS.
+
+#include <chrono>
+#include <cstdio>
+#include <round_panel.h>
+#include <vector>
+
+namespace {
+
+/// As in constants.h and display_driver.h, which need ESP-IDF
+constexpr i32 SIZE = 240;
+constexpr i32 DRAW_BUF_LINES = 60;
+constexpr i32 BAND_LINES = 8;
+constexpr int FRAMES = 20000;
+
+using Panel = RoundPanel<SIZE>;
+using Clock = std::chrono::steady_clock;
+
+/// Byte order of the panel from LVGL's native RGB565
+void swap_bytes(u16* pixels, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    pixels[i] = static_cast<u16>((pixels[i] >> 8) | (pixels[i] << 8));
+}
+
+/// Prepares every band of a full frame like `send_visible_bands()` and
+/// returns the average time per frame in µs. The draw buffer is refilled for
+/// every flush, which isn't measured.
+double prepare_frames(Panel const& panel, bool swap) {
+  std::vector<u16> rendered(SIZE * DRAW_BUF_LINES);
+  for (size_t i = 0; i < rendered.size(); ++i)
+    rendered[i] = static_cast<u16>(i * 2654435761u >> 16);
+  std::vector<u16> pixels(rendered.size());
+
+  Clock::duration total{};
+  u32 checksum = 0;
+  for (int frame = 0; frame < FRAMES; ++frame) {
+    for (i32 flush_y1 = 0; flush_y1 < SIZE; flush_y1 += DRAW_BUF_LINES) {
+      pixels = rendered;
+      Panel::Area area = {0, flush_y1, SIZE - 1,
+                          flush_y1 + DRAW_BUF_LINES - 1};
+
+      auto start = Clock::now();
+      for (i32 y1 = area.y1; y1 <= area.y2; y1 += BAND_LINES) {
+        auto y2 = std::min(y1 + BAND_LINES - 1, area.y2);
+        auto band = panel.visible_band(area, y1, y2);
+        if (!band)
+          continue;
+        auto* band_pixels = Panel::compact_band(pixels.data(), area, *band);
+        if (swap)
+          swap_bytes(band_pixels, band->width() * band->height());
+        checksum += band_pixels[0];
+      }
+      total += Clock::now() - start;
+    }
+  }
+
+  // keeps the work from being optimized away
+  if (checksum == 1)
+    std::printf(" ");
+  return std::chrono::duration<double, std::micro>(total).count() / FRAMES;
+}
+
+} // namespace
+
+int main() {
+  Panel panel;
+  auto compact_us = prepare_frames(panel, false);
+  auto swap_us = prepare_frames(panel, true);
+  std::printf("Preparing a full %dx%d frame in bands of %d rows:\n", SIZE,
+              SIZE, BAND_LINES);
+  std::printf("  compacting only:          %7.2f us\n", compact_us);
+  std::printf("  compacting and swapping:  %7.2f us (%.2fx)\n", swap_us,
+              swap_us / compact_us);
+  return 0;
+}
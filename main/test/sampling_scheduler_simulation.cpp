@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sampling_scheduler.h>
+#include <sstream>
+#include <string>
+#include <test.h>
+#include <vector>
+
+/// Estimates how much charge the sensors that `SamplingScheduler` controls
+/// draw per day, compared to the fixed rates used before it existed.
+///
+/// A day is simulated in 1 s steps from a trace of the CO2 concentration and
+/// of when the device is in use. While it is in use, the environment task
+/// reads the SCD41 in the scheduled mode and the IMU runs in the scheduled
+/// profile. Otherwise the device is in deep sleep and wakes up periodically
+/// for an environment check. The loads the scheduler doesn't change (display,
+/// SGP41, the CPU while in use) are left out.
+///
+/// Usage: sampling_scheduler_simulation [trace.csv [battery percentage]]
+///
+/// Without arguments, built-in synthetic scenarios are simulated and checked.
+/// A trace file has one `seconds,co2_ppm,in_use,orientation` line per change,
+/// e.g. exported from the device's history. `in_use` and `orientation` are 0
+/// or 1, the latter for whether a page showing the orientation is open.
+
+namespace {
+
+// Typical currents at 3.3 V from the datasheets, in mA
+constexpr double SCD_PERIODIC_MA = 15;
+constexpr double SCD_LOW_POWER_PERIODIC_MA = 3.2;
+constexpr double SCD_IDLE_MA = 0.15;
+/// Charge of one single shot measurement on top of idling, derived from the
+/// 0.45 mA average at one measurement every 5 min, in mAs
+constexpr double SCD_SINGLE_SHOT_MAS = (0.45 - SCD_IDLE_MA) * 300;
+/// Accelerometer and gyroscope in high-performance mode at 104 Hz
+constexpr double LSM_ORIENTATION_MA = 0.55;
+/// Accelerometer and gyroscope in low-power mode at 52 Hz. The datasheet
+/// lists the sensors separately, so this is an estimate.
+constexpr double LSM_GESTURE_MA = 0.3;
+/// CPU running while the environment is checked during a deep sleep wakeup
+constexpr double WAKEUP_CPU_MA = 25;
+/// Boot and the first periodic measurement
+constexpr i64 WAKEUP_DURATION_S = 6;
+
+constexpr i64 DAY_S = 24 * 60 * 60;
+constexpr u64 FIXED_WAKEUP_PERIOD_MS = 60 * 1000;
+
+i64 g_now_us = 0;
+
+struct TracePoint {
+  i64 time_s;
+  u16 co2_ppm;
+  bool in_use;
+  bool orientation;
+};
+
+struct Scenario {
+  std::string name;
+  u8 battery_percentage;
+  /// Sorted by time, each point holds until the next one
+  std::vector<TracePoint> trace;
+};
+
+struct Policy {
+  char const* name;
+  /// Whether to ask `SamplingScheduler` or to use the fixed rates
+  bool scheduled;
+};
+
+struct DailyCharge {
+  double scd_mas = 0;
+  double lsm_mas = 0;
+  double wakeup_mas = 0;
+  u32 measurements = 0;
+  u32 wakeups = 0;
+  /// Longest time CO2 was at or above `HIGH_CO2_PPM` while the device was in
+  /// use before a measurement showed it
+  i64 max_high_co2_delay_s = 0;
+
+  double total_mah() const {
+    return (scd_mas + lsm_mas + wakeup_mas) / 3600;
+  }
+};
+
+/// The scheduler's threshold for always sampling fast
+constexpr u16 HIGH_CO2_PPM = 1000;
+
+u32 measurement_interval_s(Scd41::Mode mode, SamplingScheduler const& s) {
+  if (mode == Scd41::Mode::Periodic)
+    return Scd41::PERIODIC_MEASUREMENT_INTERVAL_MS / 1000;
+  return s.environment_read_interval_ms() / 1000;
+}
+
+double scd_current_ma(Scd41::Mode mode) {
+  switch (mode) {
+  case Scd41::Mode::Periodic:
+    return SCD_PERIODIC_MA;
+  case Scd41::Mode::LowPowerPeriodic:
+    return SCD_LOW_POWER_PERIODIC_MA;
+  case Scd41::Mode::SingleShot:
+  case Scd41::Mode::Idle:
+    return SCD_IDLE_MA;
+  }
+  return 0;
+}
+
+DailyCharge simulate(Scenario const& scenario, Policy const& policy) {
+  DailyCharge charge;
+  std::optional<SamplingScheduler> scheduler;
+  auto scd_mode = Scd41::Mode::Idle;
+  i64 next_measurement_s = 0;
+  i64 next_wakeup_s = 0;
+  std::optional<i64> high_co2_since_s;
+  size_t trace_index = 0;
+
+  for (i64 t = 0; t < DAY_S; ++t) {
+    g_now_us = t * 1000000;
+    while (trace_index + 1 < scenario.trace.size() &&
+           scenario.trace[trace_index + 1].time_s <= t)
+      ++trace_index;
+    auto const& point = scenario.trace[trace_index];
+
+    if (!point.in_use) {
+      // the scheduler's state doesn't survive deep sleep
+      scheduler.reset();
+      scd_mode = Scd41::Mode::Idle;
+      high_co2_since_s.reset();
+      if (t < next_wakeup_s)
+        continue;
+
+      SamplingScheduler wakeup_scheduler;
+      wakeup_scheduler.report_battery_percentage(scenario.battery_percentage);
+      auto period_ms = policy.scheduled ? wakeup_scheduler.wakeup_period_ms()
+                                        : FIXED_WAKEUP_PERIOD_MS;
+      next_wakeup_s = t + static_cast<i64>(period_ms / 1000);
+      ++charge.wakeups;
+      ++charge.measurements;
+      charge.wakeup_mas +=
+          (WAKEUP_CPU_MA + SCD_PERIODIC_MA) * WAKEUP_DURATION_S;
+      continue;
+    }
+
+    if (!scheduler) {
+      scheduler.emplace();
+      next_measurement_s = t;
+    }
+    scheduler->report_battery_percentage(scenario.battery_percentage);
+    next_wakeup_s = t;
+
+    if (point.co2_ppm >= HIGH_CO2_PPM) {
+      if (!high_co2_since_s)
+        high_co2_since_s = t;
+    } else {
+      high_co2_since_s.reset();
+    }
+
+    // environment task
+    if (t >= next_measurement_s) {
+      auto mode =
+          policy.scheduled ? scheduler->scd_mode() : Scd41::Mode::Periodic;
+      if (mode != scd_mode) {
+        // switching restarts the measurement
+        scd_mode = mode;
+        next_measurement_s = t + measurement_interval_s(mode, *scheduler);
+      } else {
+        scheduler->report_co2(point.co2_ppm);
+        ++charge.measurements;
+        if (mode == Scd41::Mode::SingleShot)
+          charge.scd_mas += SCD_SINGLE_SHOT_MAS;
+        if (high_co2_since_s) {
+          charge.max_high_co2_delay_s =
+              std::max(charge.max_high_co2_delay_s, t - *high_co2_since_s);
+          high_co2_since_s.reset();
+        }
+        next_measurement_s = t + measurement_interval_s(mode, *scheduler);
+      }
+    }
+    charge.scd_mas += scd_current_ma(scd_mode);
+
+    // IMU task
+    if (point.orientation)
+      scheduler->request_orientation();
+    auto orientation =
+        !policy.scheduled || scheduler->imu_profile() ==
+                                 SamplingScheduler::ImuProfile::Orientation;
+    charge.lsm_mas += orientation ? LSM_ORIENTATION_MA : LSM_GESTURE_MA;
+  }
+  return charge;
+}
+
+/// Single room with a constant air exchange rate
+struct Room {
+  static constexpr double OUTDOOR_CO2_PPM = 420;
+  /// CO2 a person exhales, 0.005 l/s, in a 50 m³ room, in ppm per second
+  static constexpr double CO2_PER_PERSON_PPM_S = 0.005 / 50000 * 1e6;
+
+  double co2_ppm = OUTDOOR_CO2_PPM;
+
+  void step(double people, double air_changes_per_hour) {
+    co2_ppm += people * CO2_PER_PERSON_PPM_S -
+               (co2_ppm - OUTDOOR_CO2_PPM) * air_changes_per_hour / 3600;
+  }
+};
+
+struct Occupancy {
+  i64 from_s;
+  i64 to_s;
+  double people;
+  double air_changes_per_hour;
+};
+
+struct Use {
+  i64 from_s;
+  i64 to_s;
+  bool orientation;
+};
+
+constexpr i64 hours(double h) { return static_cast<i64>(h * 3600); }
+
+/// Samples a simulated room every 10 s, with the sensor's noise added
+Scenario make_scenario(std::string name, u8 battery_percentage,
+                       double idle_air_changes_per_hour,
+                       std::vector<Occupancy> const& occupancy,
+                       std::vector<Use> const& use) {
+  std::mt19937 random(4);
+  std::normal_distribution<double> noise(0, 5);
+  Scenario scenario{std::move(name), battery_percentage, {}};
+  Room room;
+
+  for (i64 t = 0; t < DAY_S; ++t) {
+    double people = 0;
+    auto air_changes = idle_air_changes_per_hour;
+    for (auto const& o : occupancy) {
+      if (t >= o.from_s && t < o.to_s) {
+        people = o.people;
+        air_changes = o.air_changes_per_hour;
+      }
+    }
+    room.step(people, air_changes);
+
+    if (t % 10 != 0)
+      continue;
+    TracePoint point{
+        .time_s = t,
+        .co2_ppm = static_cast<u16>(std::lround(room.co2_ppm + noise(random))),
+        .in_use = false,
+        .orientation = false,
+    };
+    for (auto const& u : use) {
+      if (t >= u.from_s && t < u.to_s) {
+        point.in_use = true;
+        point.orientation = u.orientation;
+      }
+    }
+    scenario.trace.push_back(point);
+  }
+  return scenario;
+}
+
+std::vector<Scenario> builtin_scenarios() {
+  std::vector<Occupancy> office = {
+      {hours(8), hours(10), 2, 1},      {hours(10), hours(10.25), 2, 6},
+      {hours(10.25), hours(12), 2, 1},  {hours(13), hours(15), 2, 1},
+      {hours(15), hours(15.25), 2, 6},  {hours(15.25), hours(18), 2, 1},
+  };
+  std::vector<Use> glances;
+  for (auto h : {8.5, 9.5, 10.5, 11.5, 13.5, 14.5, 15.5, 16.5, 17.5})
+    glances.push_back({hours(h), hours(h) + 60, false});
+  glances.push_back({hours(12), hours(12) + 120, true});
+
+  return {
+      make_scenario("Office, glancing at the device", 80, 0.5, office,
+                    glances),
+      make_scenario("Office, battery low", 15, 0.5, office, glances),
+      make_scenario("Office, display always on", 80, 0.5, office,
+                    {{0, DAY_S, false}}),
+      make_scenario("Bedroom, display always on", 80, 0.3,
+                    {{0, hours(7), 1, 0.3}, {hours(23), DAY_S, 1, 0.3}},
+                    {{0, DAY_S, false}}),
+      make_scenario("Hiking with the compass open", 80, 10, {},
+                    {{hours(9), hours(12), true}}),
+  };
+}
+
+std::optional<Scenario> load_trace(char const* path, u8 battery_percentage) {
+  std::ifstream file(path);
+  if (!file)
+    return std::nullopt;
+
+  Scenario scenario{path, battery_percentage, {}};
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    TracePoint point{};
+    char comma;
+    int in_use, orientation;
+    if (fields >> point.time_s >> comma >> point.co2_ppm >> comma >> in_use >>
+        comma >> orientation) {
+      point.in_use = in_use;
+      point.orientation = orientation;
+      scenario.trace.push_back(point);
+    }
+  }
+  if (scenario.trace.empty())
+    return std::nullopt;
+  return scenario;
+}
+
+void print_charge(Policy const& policy, DailyCharge const& charge) {
+  std::printf("  %-9s %7.1f mAh/day (SCD41 %6.1f, LSM6DSOX %5.1f, wakeups "
+              "%5.1f), %5lu measurements, %4lu wakeups, high CO2 noticed "
+              "after %lld s at most\n",
+              policy.name, charge.total_mah(), charge.scd_mas / 3600,
+              charge.lsm_mas / 3600, charge.wakeup_mas / 3600,
+              static_cast<unsigned long>(charge.measurements),
+              static_cast<unsigned long>(charge.wakeups),
+              static_cast<long long>(charge.max_high_co2_delay_s));
+}
+
+} // namespace
+
+int64_t esp_timer_get_time() { return g_now_us; }
+
+int main(int argc, char** argv) {
+  constexpr Policy FIXED = {"fixed", false};
+  constexpr Policy SCHEDULED = {"scheduled", true};
+
+  std::vector<Scenario> scenarios;
+  if (argc > 1) {
+    auto battery = argc > 2 ? static_cast<u8>(std::atoi(argv[2])) : 80;
+    auto scenario = load_trace(argv[1], battery);
+    if (!scenario) {
+      std::printf("Could not read a trace from %s\n", argv[1]);
+      return 1;
+    }
+    scenarios.push_back(std::move(*scenario));
+  } else {
+    scenarios = builtin_scenarios();
+  }
+
+  for (auto const& scenario : scenarios) {
+    std::printf("%s, battery at %u %%\n", scenario.name.c_str(),
+                scenario.battery_percentage);
+    auto fixed = simulate(scenario, FIXED);
+    auto scheduled = simulate(scenario, SCHEDULED);
+    print_charge(FIXED, fixed);
+    print_charge(SCHEDULED, scheduled);
+
+    CHECK(scheduled.total_mah() <= fixed.total_mah());
+    // Unless the battery is low, high CO2 is noticed within one low power
+    // measurement interval. From then on, it is measured at the fast rate.
+    if (scenario.battery_percentage > 20) {
+      CHECK(scheduled.max_high_co2_delay_s <=
+            static_cast<i64>(
+                Scd41::LOW_POWER_PERIODIC_MEASUREMENT_INTERVAL_MS / 1000));
+    }
+  }
+  return host_test::failure_count() == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include <round_panel.h>
+#include <test.h>
+#include <vector>
+
+namespace {
+
+/// As in constants.h and display_driver.h, which need ESP-IDF
+constexpr i32 SIZE = 240;
+constexpr i32 DRAW_BUF_LINES = 60;
+constexpr i32 BAND_LINES = 8;
+
+using Panel = RoundPanel<SIZE>;
+
+/// Whether any part of the pixel lies inside the panel's circle
+bool visible(i32 x, i32 y) {
+  constexpr i32 RADIUS = SIZE / 2;
+  // distances from the center to the pixel's nearest edges
+  auto dx = x < RADIUS ? RADIUS - (x + 1) : x - RADIUS;
+  auto dy = y < RADIUS ? RADIUS - (y + 1) : y - RADIUS;
+  return sq(dx) + sq(dy) < sq(RADIUS);
+}
+
+u16 pixel_value(i32 x, i32 y) { return static_cast<u16>(y * SIZE + x); }
+
+} // namespace
+
+TEST(chords_contain_every_visible_pixel) {
+  Panel panel;
+  for (i32 y = 0; y < SIZE; ++y) {
+    CHECK(panel.chord_start(y) % 2 == 0);
+    CHECK(panel.chord_start(y) == panel.chord_start(SIZE - 1 - y));
+    for (i32 x = 0; x < SIZE; ++x) {
+      if (visible(x, y))
+        CHECK(x >= panel.chord_start(y) && x <= panel.chord_end(y));
+    }
+    // rounding down to even columns adds at most one invisible pixel
+    CHECK(!visible(panel.chord_start(y) - 1, y));
+  }
+}
+
+TEST(compacted_bands_hold_their_pixels) {
+  Panel panel;
+  std::vector<u16> pixels(SIZE * DRAW_BUF_LINES);
+  u32 sent = 0;
+
+  // a full frame, flushed like LVGL does with the display's draw buffers
+  for (i32 flush_y1 = 0; flush_y1 < SIZE; flush_y1 += DRAW_BUF_LINES) {
+    Panel::Area area = {0, flush_y1, SIZE - 1, flush_y1 + DRAW_BUF_LINES - 1};
+    for (i32 y = area.y1; y <= area.y2; ++y) {
+      for (i32 x = area.x1; x <= area.x2; ++x)
+        pixels[(y - area.y1) * SIZE + x] = pixel_value(x, y);
+    }
+
+    for (i32 y1 = area.y1; y1 <= area.y2; y1 += BAND_LINES) {
+      auto y2 = std::min(y1 + BAND_LINES - 1, area.y2);
+      auto band = panel.visible_band(area, y1, y2);
+      CHECK(band.has_value());
+      if (!band)
+        continue;
+
+      for (i32 y = y1; y <= y2; ++y) {
+        for (i32 x = 0; x < SIZE; ++x) {
+          if (visible(x, y))
+            CHECK(x >= band->x1 && x <= band->x2);
+        }
+      }
+
+      auto* band_pixels = Panel::compact_band(pixels.data(), area, *band);
+      bool intact = true;
+      for (i32 i = 0; i < band->height(); ++i) {
+        for (i32 j = 0; j < band->width(); ++j) {
+          intact &= band_pixels[i * band->width() + j] ==
+                    pixel_value(band->x1 + j, band->y1 + i);
+        }
+      }
+      CHECK(intact);
+      sent += band->width() * band->height();
+    }
+  }
+
+  // see `DISPLAY_FLUSH_BAND_LINES`
+  CHECK_NEAR(static_cast<float>(sent) / (SIZE * SIZE), 0.82f, 0.01f);
+}
+
+TEST(bands_of_areas_outside_the_circle_are_dropped) {
+  Panel panel;
+  Panel::Area corner = {0, 0, 31, 7};
+  CHECK(!panel.visible_band(corner, 0, 7).has_value());
+  Panel::Area center = {100, 100, 139, 139};
+  auto band = panel.visible_band(center, 104, 111);
+  CHECK(band.has_value());
+  if (band) {
+    CHECK(band->x1 == 100 && band->x2 == 139);
+    CHECK(band->y1 == 104 && band->y2 == 111);
+  }
+}
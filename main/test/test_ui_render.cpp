@@ -0,0 +1,354 @@
+// Renders the UI into a framebuffer in memory through scripted scenes: every
+// page of the home screen redrawn in full and left idle, swiping through all
+// pages, and a running timer and stopwatch. Checks that the pages render
+// reproducibly and within the display's refresh period, and prints the render
+// time, the invalidated area and LVGL's heap high water mark per scene.
+//
+// Unlike on the device, invalidated areas aren't clipped to the round panel,
+// so the whole square is rendered and checksummed.
+
+#include <algorithm>
+#include <array>
+#include <ble_peripheral_manager.h>
+#include <chrono>
+#include <constants.h>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <data.h>
+#include <iterator>
+#include <lvgl.h>
+#include <optional>
+#include <test.h>
+#include <thread>
+#include <ui/pages.h>
+#include <util.h>
+#include <wifi_manager.h>
+
+namespace {
+
+/// In the order `HomeScreen` adds them to its pages container
+constexpr char const* PAGE_NAMES[] = {
+    "AirQualityPage",
+    "ClockPage",
+    "TimerPage",
+    "CompassPage",
+};
+
+/// Time to let animations and page updates finish before a scene starts
+constexpr u32 SETTLE_DURATION_MS = 500;
+constexpr u32 IDLE_DURATION_MS = 3000;
+/// A swipe moves the scripted touch by `SWIPE_DISTANCE` px to the left, in
+/// `SWIPE_STEPS` steps that are `SWIPE_STEP_MS` apart.
+constexpr i32 SWIPE_DISTANCE = 160;
+constexpr i32 SWIPE_STEPS = 8;
+constexpr u32 SWIPE_STEP_MS = 35;
+constexpr int TIMER_DURATION_MS = 60 * 1000;
+
+/// Average render time per frame allowed in every scene. The host renders
+/// many times faster than the ESP32-S3, so missing even the device's refresh
+/// period here means a page redraws far more than it has to.
+constexpr i64 RENDER_BUDGET_US = LV_DEF_REFR_PERIOD * 1000;
+
+/// Framebuffer checksums of the pages' full redraws, rendered with the LVGL
+/// version in dependencies.lock and the fonts of components/lvgl_fonts.
+/// Pages without one are only checked for rendering the same every time, and
+/// their checksum is printed for recording it here, e.g. after updating LVGL
+/// or changing a page on purpose.
+struct ReferenceChecksum {
+  char const* page;
+  u32 checksum;
+};
+constexpr std::array<ReferenceChecksum, 0> REFERENCE_CHECKSUMS = {};
+
+/// Shown instead of the measured values, so checksums are comparable between
+/// runs
+constexpr Data::DisplayedValues PINNED_VALUES = {
+    // 1 June 2024, 12:34:56 UTC
+    .time = 1717245296,
+    .battery_percentage = 76,
+    .temperature = 22.4f,
+    .humidity = 41.5f,
+    .co2_ppm = 842,
+    .voc_index = 112,
+    .nox_index = 1,
+    .compass_heading = 37.f,
+    .acceleration = Data::GRAVITATIONAL_ACCELERATION,
+    .gyroscope = Vector3(),
+};
+
+struct SceneStatistics {
+  /// Refreshes that rendered anything
+  u32 frames = 0;
+  i64 render_us = 0;
+  i64 max_render_us = 0;
+  u64 invalidated_px = 0;
+
+  i64 frame_start_us = 0;
+  bool frame_flushed = false;
+
+  i64 average_render_us() const {
+    return render_us / std::max<u32>(frames, 1);
+  }
+};
+
+struct ScriptedTouch {
+  bool pressed = false;
+  lv_point_t point{};
+};
+
+/// The panel's pixels, as they are after the last flush
+std::array<u16, DP_H_RES * DP_V_RES> g_framebuffer;
+/// Partial draw buffers of the same size as on the device, see
+/// `init_display()`
+alignas(4) std::array<u8, LVGL_DRAW_BUF_SIZE> g_draw_buf1;
+alignas(4) std::array<u8, LVGL_DRAW_BUF_SIZE> g_draw_buf2;
+
+SceneStatistics g_scene;
+ScriptedTouch g_touch;
+
+void flush_cb(lv_display_t* display, lv_area_t const* area, uint8_t* px_map) {
+  auto const* pixels = reinterpret_cast<u16 const*>(px_map);
+  auto width = lv_area_get_width(area);
+  for (i32 y = area->y1; y <= area->y2; ++y) {
+    std::copy_n(pixels, width, &g_framebuffer[y * DP_H_RES + area->x1]);
+    pixels += width;
+  }
+  g_scene.frame_flushed = true;
+  lv_display_flush_ready(display);
+}
+
+/// FNV-1a hash of the framebuffer
+u32 framebuffer_checksum() {
+  u32 checksum = 2166136261;
+  auto const* bytes = reinterpret_cast<u8 const*>(g_framebuffer.data());
+  for (size_t i = 0; i < sizeof(g_framebuffer); ++i) {
+    checksum ^= bytes[i];
+    checksum *= 16777619;
+  }
+  return checksum;
+}
+
+void refresh_event_cb(lv_event_t* e) {
+  auto& scene = g_scene;
+  auto now = esp_timer_get_time();
+
+  if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+    scene.frame_start_us = now;
+    scene.frame_flushed = false;
+    return;
+  }
+
+  // LVGL also refreshes if nothing was invalidated
+  if (!scene.frame_flushed)
+    return;
+
+  auto render_us = now - scene.frame_start_us;
+  ++scene.frames;
+  scene.render_us += render_us;
+  scene.max_render_us = std::max(scene.max_render_us, render_us);
+}
+
+void invalidate_area_cb(lv_event_t* e) {
+  auto* area = static_cast<lv_area_t*>(lv_event_get_param(e));
+  g_scene.invalidated_px += lv_area_get_size(area);
+}
+
+void scripted_touch_read_cb(lv_indev_t*, lv_indev_data_t* data) {
+  data->point = g_touch.point;
+  data->state =
+      g_touch.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
+/// Creates the display and the UI on first use, with the displayed values
+/// pinned for the whole run
+lv_display_t* display() {
+  static lv_display_t* display = [] {
+    // the pinned time is shown in local time
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    lv_init();
+    lv_tick_set_cb(millis);
+    auto* display = lv_display_create(DP_H_RES, DP_V_RES);
+    lv_display_set_buffers(display, g_draw_buf1.data(), g_draw_buf2.data(),
+                           LVGL_DRAW_BUF_SIZE, LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565_SWAPPED);
+    lv_display_set_flush_cb(display, flush_cb);
+    lv_display_add_event_cb(display, refresh_event_cb, LV_EVENT_REFR_START,
+                            NULL);
+    lv_display_add_event_cb(display, refresh_event_cb, LV_EVENT_REFR_READY,
+                            NULL);
+    lv_display_add_event_cb(display, invalidate_area_cb,
+                            LV_EVENT_INVALIDATE_AREA, NULL);
+
+    auto* touch = lv_indev_create();
+    lv_indev_set_type(touch, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(touch, scripted_touch_read_cb);
+    lv_indev_set_display(touch, display);
+
+    Data::the()->pin(PINNED_VALUES);
+    ui::Ui::the().initialize();
+    return display;
+  }();
+  return display;
+}
+
+/// Runs LVGL's timers, i.e. page updates, input, animations and refreshes,
+/// like the LVGL task does.
+void run_lvgl_for(u32 duration_ms) {
+  auto end_us = esp_timer_get_time() + duration_ms * 1000ll;
+  while (esp_timer_get_time() < end_us) {
+    lv_timer_handler();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+lv_obj_t* pages() { return ui::Ui::the().home_screen()->pages_container(); }
+
+u32 page_count() { return lv_obj_get_child_count(pages()); }
+
+char const* page_name(u32 i) {
+  return i < std::size(PAGE_NAMES) ? PAGE_NAMES[i] : "Page";
+}
+
+void show_page(u32 i) {
+  lv_obj_scroll_to_view(lv_obj_get_child(pages(), i), LV_ANIM_OFF);
+  run_lvgl_for(SETTLE_DURATION_MS);
+}
+
+/// Redraws the whole screen, e.g. like after leaving a fullscreen screen, and
+/// returns the framebuffer's checksum
+u32 full_redraw() {
+  lv_obj_invalidate(lv_screen_active());
+  lv_refr_now(display());
+  return framebuffer_checksum();
+}
+
+void swipe_left() {
+  auto& touch = g_touch;
+  touch.point = {DP_H_RES / 2 + SWIPE_DISTANCE / 2, DP_V_RES / 2};
+  touch.pressed = true;
+  run_lvgl_for(SWIPE_STEP_MS);
+
+  for (i32 i = 0; i < SWIPE_STEPS; ++i) {
+    touch.point.x -= SWIPE_DISTANCE / SWIPE_STEPS;
+    run_lvgl_for(SWIPE_STEP_MS);
+  }
+
+  touch.pressed = false;
+  run_lvgl_for(SETTLE_DURATION_MS);
+}
+
+void begin_scene() { g_scene = {}; }
+
+/// Prints the scene's statistics and checks its render time
+void end_scene(char const* subject, char const* scene_name) {
+  auto const& scene = g_scene;
+  lv_mem_monitor_t memory;
+  lv_mem_monitor(&memory);
+
+  std::printf("%s, %s: %lu frames, render %lld us avg, %lld us max, %llu px "
+              "invalidated per frame, LVGL heap high water mark %zu of %zu "
+              "bytes\n",
+              subject, scene_name, static_cast<unsigned long>(scene.frames),
+              static_cast<long long>(scene.average_render_us()),
+              static_cast<long long>(scene.max_render_us),
+              static_cast<unsigned long long>(scene.invalidated_px /
+                                              std::max<u32>(scene.frames, 1)),
+              memory.max_used, memory.total_size);
+  CHECK(scene.average_render_us() <= RENDER_BUDGET_US);
+  CHECK(memory.max_used < memory.total_size);
+}
+
+std::optional<u32> reference_checksum(char const* page) {
+  for (auto const& reference : REFERENCE_CHECKSUMS) {
+    if (strcmp(reference.page, page) == 0)
+      return reference.checksum;
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+int64_t esp_timer_get_time() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Bluetooth and WiFi are never enabled while rendering
+
+BlePeripheralManager& BlePeripheralManager::the() {
+  static BlePeripheralManager manager;
+  return manager;
+}
+
+BlePeripheralManager::BlePeripheralManager() {}
+void BlePeripheralManager::start(u32) {}
+void BlePeripheralManager::stop() {}
+bool BlePeripheralManager::started() const { return false; }
+
+/// Referenced by the GATT table in ble_peripheral_manager.h
+int access_cb(u16, u16, ble_gatt_access_ctxt*, void*) { return 0; }
+
+WifiManager::WifiManager() {}
+bool WifiManager::enable_wifi() { return false; }
+void WifiManager::disable_wifi() {}
+
+TEST(pages_render_reproducibly_within_the_budget) {
+  display();
+  for (u32 i = 0; i < page_count(); ++i) {
+    show_page(i);
+
+    begin_scene();
+    auto checksum = full_redraw();
+    end_scene(page_name(i), "full redraw");
+
+    // only what the page's periodic updates change
+    begin_scene();
+    run_lvgl_for(IDLE_DURATION_MS);
+    end_scene(page_name(i), "idle");
+
+    // the updates show the same pinned values again
+    auto after_idle = full_redraw();
+    std::printf("%s framebuffer checksum: %08lx\n", page_name(i),
+                static_cast<unsigned long>(checksum));
+    CHECK(after_idle == checksum);
+    auto reference = reference_checksum(page_name(i));
+    if (reference)
+      CHECK(checksum == *reference);
+  }
+}
+
+TEST(swiping_through_all_pages_stays_within_the_budget) {
+  display();
+  show_page(0);
+  begin_scene();
+  for (u32 i = 1; i < page_count(); ++i)
+    swipe_left();
+  end_scene("HomeScreen", "swiping through all pages");
+}
+
+TEST(running_timer_and_stopwatch_stay_within_the_budget) {
+  display();
+  show_page(0);
+  {
+    auto d = Data::the();
+    d->user_timer().start(TIMER_DURATION_MS);
+    d->user_stopwatch().resume();
+  }
+  // Data's events are forwarded to LVGL by the LVGL task on the device
+  auto event = Data::Event::UserTimerStarted;
+  lv_obj_send_event(ui::Ui::the().data_event_obj(), ui::Ui::the().data_event(),
+                    &event);
+
+  // the digits depend on when frames are rendered, so there's no checksum
+  begin_scene();
+  run_lvgl_for(IDLE_DURATION_MS);
+  end_scene(page_name(0), "timer and stopwatch running");
+
+  auto d = Data::the();
+  d->user_timer().reset();
+  d->user_stopwatch().reset();
+}
@@ -6,19 +6,11 @@
 #include <cmath>
 #include <constants.h>
 #include <esp_log.h>
+#include <sampling_scheduler.h>
 #include <sys/param.h>
 
 namespace ui {
 
-#define DATA_EVENT_LISTENER(Type, cb, user_data)                               \
-  lv_obj_add_event_cb(                                                         \
-      Ui::the().data_event_obj(),                                              \
-      [](lv_event_t* lv_event) {                                               \
-        auto event = *static_cast<Data::Event*>(lv_event_get_param(lv_event)); \
-        (cb)(event, static_cast<Type*>(lv_event_get_user_data(lv_event)));     \
-      },                                                                       \
-      Ui::the().data_event(), user_data);
-
 HomeScreen::HomeScreen()
     : Screen() {
   // battery percentage
@@ -433,12 +425,12 @@ ClockPage::ClockPage(lv_obj_t* parent)
 
 void ClockPage::update() {
   auto time = Data::the()->get_time();
-  lv_label_set_text_fmt(m_time, "%02d:%02d", time.tm_hour, time.tm_min);
+  update_label_text_fmt(m_time, "%02d:%02d", time.tm_hour, time.tm_min);
   // from https://cplusplus.com/reference/ctime/tm/
   // tm_mon has the range 0-11
   // tm_year is the years since 1900
-  lv_label_set_text_fmt(m_date, "%02d.%02d.%02d", time.tm_mday, time.tm_mon + 1,
-                        time.tm_year + 1900);
+  update_label_text_fmt(m_date, "%02d.%02d.%02d", time.tm_mday,
+                        time.tm_mon + 1, time.tm_year + 1900);
 }
 
 AirQualityPage::AirQualityPage(lv_obj_t* parent)
@@ -636,9 +628,14 @@ CompassPage::CompassPage(lv_obj_t* parent)
 }
 
 void CompassPage::update() {
+  if (is_visible())
+    SamplingScheduler::the().request_orientation();
+
   auto d = Data::the();
   auto heading = d->compass_heading();
 
+  // lv_obj_set_pos() only invalidates the object if the position changed, so
+  // heading changes of less than a pixel don't redraw anything
   auto position = [](lv_obj_t* obj, float angle) {
     // we need to do 360° - angle, since we need to "un-rotate" the UI elements
     angle = (360.f - angle - 90.f) * DEG_TO_RAD;
@@ -668,12 +665,12 @@ void CompassPage::update() {
     dir_name = DIRECTION_NAMES[0];
   }
 
-  lv_label_set_text_fmt(m_heading_label, "%.0f° %s", heading, dir_name);
+  update_label_text_fmt(m_heading_label, "%.0f° %s", heading, dir_name);
 
   auto acceleration = d->acceleration();
   auto dx = -acceleration.x * 10;
   auto dy = acceleration.z * 10;
-  lv_obj_set_pos(m_crosshair, dx, dy);
+  lv_obj_set_pos(m_crosshair, static_cast<i32>(dx), static_cast<i32>(dy));
 
   // fade crosshair out when its too far from the center of the screen
   auto offset = sqrtf(dx * dx + dy * dy);
@@ -682,7 +679,7 @@ void CompassPage::update() {
              std::clamp(CROSSHAIR_FADE_DISTANCE - fadeout_start_dist, 0.f,
                         CROSSHAIR_FADE_DISTANCE) /
              CROSSHAIR_FADE_DISTANCE;
-  lv_obj_set_style_opa(m_crosshair, opa, 0);
+  update_opa(m_crosshair, opa);
 }
 
 RotaryInputScreen::RotaryInputScreen(int& value, float units_per_angle)
@@ -718,6 +715,8 @@ RotaryInputScreen::RotaryInputScreen(int& value, float units_per_angle)
 }
 
 void RotaryInputScreen::update() {
+  SamplingScheduler::the().request_orientation();
+
   auto elapsed = static_cast<float>(millis() - m_last_update) / 1000.0;
   auto yaw_speed = Data::the()->gyroscope().y;
 
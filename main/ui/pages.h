@@ -2,7 +2,6 @@
 
 #include "ui.h"
 #include <ctime>
-#include <esp_event.h>
 #include <lvgl.h>
 #include <optional>
 #include <types.h>
@@ -10,10 +9,23 @@
 
 namespace ui {
 
+/// Registers `cb` to be called on the LVGL thread for every `Data::Event`.
+#define DATA_EVENT_LISTENER(Type, cb, user_data)                               \
+  lv_obj_add_event_cb(                                                         \
+      Ui::the().data_event_obj(),                                              \
+      [](lv_event_t* lv_event) {                                               \
+        auto event = *static_cast<Data::Event*>(lv_event_get_param(lv_event)); \
+        (cb)(event, static_cast<Type*>(lv_event_get_user_data(lv_event)));     \
+      },                                                                       \
+      Ui::the().data_event(), user_data);
+
 class HomeScreen : public Screen {
 public:
   explicit HomeScreen();
 
+  /// Horizontally scrolling container holding one page per child.
+  lv_obj_t* pages_container() const { return m_pages_container; }
+
 private:
   static constexpr u32 UPDATE_INTERVAL_MS = 5 * 1000;
   static constexpr size_t PAGE_COUNT = 4;
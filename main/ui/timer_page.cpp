@@ -19,7 +19,7 @@ void blink_timer_cb(lv_timer_t* timer) {
 void format_label_with_minutes_and_seconds(lv_obj_t* label, int ms) {
   auto minutes = ms / (1000 * 60);
   auto seconds = ms / 1000 - minutes * 60;
-  lv_label_set_text_fmt(label, "%02d:%02d", minutes, seconds);
+  update_label_text_fmt(label, "%02d:%02d", minutes, seconds);
 }
 
 TimerPage::TimerPage(lv_obj_t* parent)
@@ -40,11 +40,10 @@ TimerPage::TimerPage(lv_obj_t* parent)
   lv_obj_set_size(bottom_arc, LV_PCT(100), LV_PCT(100));
   lv_obj_align(bottom_arc, LV_ALIGN_CENTER, 0, 0);
 
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::SetDownGesture,
-      [](void* handler_arg, esp_event_base_t, int32_t, void*) {
-        auto* p = static_cast<TimerPage*>(handler_arg);
-        if (!p->is_visible())
+  DATA_EVENT_LISTENER(
+      TimerPage,
+      [](Data::Event e, TimerPage* p) {
+        if (e != Data::Event::SetDownGesture || !p->is_visible())
           return;
 
         switch (p->m_mode) {
@@ -156,10 +155,11 @@ TimerPageContent::TimerPageContent(lv_obj_t* parent) {
   lv_timer_pause(m_time_blink_timer);
   lv_timer_set_auto_delete(m_time_blink_timer, false);
 
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::UserTimerExpired,
-      [](void* handler_arg, esp_event_base_t, int32_t, void*) {
-        auto* p = static_cast<TimerPageContent*>(handler_arg);
+  DATA_EVENT_LISTENER(
+      TimerPageContent,
+      [](Data::Event e, TimerPageContent* p) {
+        if (e != Data::Event::UserTimerExpired)
+          return;
         p->m_duration_ms = 0;
         lv_timer_reset(p->m_time_blink_timer);
         // each repetition of the timer toggles the opacity of the label,
@@ -188,9 +188,9 @@ void TimerPageContent::update() {
   if (d->user_timer().is_running()) {
     m_duration_ms = d->user_timer().remaining_duration_ms();
     m_prev_duration_ms = m_duration_ms;
-    lv_label_set_text(m_play_pause_button_label, LV_SYMBOL_PAUSE);
+    update_label_text(m_play_pause_button_label, LV_SYMBOL_PAUSE);
   } else {
-    lv_label_set_text(m_play_pause_button_label, LV_SYMBOL_PLAY);
+    update_label_text(m_play_pause_button_label, LV_SYMBOL_PLAY);
   }
   lv_obj_set_state(m_edit_button, LV_STATE_DISABLED,
                    d->user_timer().is_running());
@@ -268,9 +268,9 @@ void StopwatchPageContent::update() {
   auto d = Data::the();
 
   if (d->user_stopwatch().is_running()) {
-    lv_label_set_text(m_play_pause_button_label, LV_SYMBOL_PAUSE);
+    update_label_text(m_play_pause_button_label, LV_SYMBOL_PAUSE);
   } else {
-    lv_label_set_text(m_play_pause_button_label, LV_SYMBOL_PLAY);
+    update_label_text(m_play_pause_button_label, LV_SYMBOL_PLAY);
   }
 
   auto elapsed_ms = static_cast<float>(d->user_stopwatch().elapsed_ms());
@@ -284,10 +284,10 @@ void StopwatchPageContent::update() {
       static_cast<int>(round(elapsed_milliseconds / 10.f));
 
   if (elapsed_minutes > 0) {
-    lv_label_set_text_fmt(m_time_label, "%02d:%02d.%02d", elapsed_minutes,
+    update_label_text_fmt(m_time_label, "%02d:%02d.%02d", elapsed_minutes,
                           elapsed_seconds, elapsed_fract_seconds);
   } else {
-    lv_label_set_text_fmt(m_time_label, "%02d.%02d", elapsed_seconds,
+    update_label_text_fmt(m_time_label, "%02d.%02d", elapsed_seconds,
                           elapsed_fract_seconds);
   }
 }
@@ -384,11 +384,22 @@ TimerPage::TimerOverlay::TimerOverlay(lv_obj_t* parent)
   lv_obj_add_flag(m_timer_arc, LV_OBJ_FLAG_HIDDEN);
   lv_obj_add_flag(m_stopwatch_arc, LV_OBJ_FLAG_HIDDEN);
 
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::UserTimerStarted,
-      [](void* handler_arg, esp_event_base_t, int32_t, void* event_data) {
-        auto* to = static_cast<TimerOverlay*>(handler_arg);
-        to->m_original_timer_duration = *static_cast<int*>(event_data);
+  DATA_EVENT_LISTENER(
+      TimerOverlay,
+      [](Data::Event e, TimerOverlay* to) {
+        if (e == Data::Event::UserTimerStarted) {
+          to->m_original_timer_duration =
+              Data::the()->user_timer().original_duration_ms();
+          return;
+        }
+        if (e != Data::Event::UserTimerExpired)
+          return;
+        lv_timer_reset(to->m_blink_timer);
+        // each repetition of the timer toggles the opacity of the overlay,
+        // therefore, for n blinks, we need n * 2 repetitions of the timer
+        lv_timer_set_repeat_count(to->m_blink_timer,
+                                  BLINK_TIMER_REPEAT_COUNT * 2);
+        lv_timer_resume(to->m_blink_timer);
       },
       this);
 
@@ -404,44 +415,34 @@ TimerPage::TimerOverlay::TimerOverlay(lv_obj_t* parent)
       BLINK_TIMER_PERIOD_MS, m_timer_arc);
   lv_timer_pause(m_blink_timer);
   lv_timer_set_auto_delete(m_blink_timer, false);
-
-  esp_event_handler_register(
-      DATA_EVENT_BASE, Data::Event::UserTimerExpired,
-      [](void* handler_arg, esp_event_base_t, int32_t, void*) {
-        auto* p = static_cast<TimerOverlay*>(handler_arg);
-        lv_timer_reset(p->m_blink_timer);
-        // each repetition of the timer toggles the opacity of the overlay,
-        // therefore, for n blinks, we need n * 2 repetitions of the timer
-        lv_timer_set_repeat_count(p->m_blink_timer,
-                                  BLINK_TIMER_REPEAT_COUNT * 2);
-        lv_timer_resume(p->m_blink_timer);
-      },
-      this);
 }
 
 void TimerPage::TimerOverlay::update() {
+  // lv_arc_set_value() only redraws the part of the arc that changed, while
+  // showing an already visible arc would redraw all of it, i.e. the whole
+  // screen
   auto d = Data::the();
   if (d->user_timer().is_running() && m_original_timer_duration != 0) {
     auto remaining = d->user_timer().remaining_duration_ms();
     lv_arc_set_value(m_timer_arc, 100 * remaining / m_original_timer_duration);
-    lv_obj_remove_flag(m_timer_arc, LV_OBJ_FLAG_HIDDEN);
+    update_hidden(m_timer_arc, false);
   } else {
     // only hide the arc once, to allow e.g. blinking of the arc to indicate the
     // timer having expired
     if (d->user_timer().remaining_duration_ms() == 0 &&
         m_previous_timer_duration != 0) {
       lv_arc_set_value(m_timer_arc, 100);
-      lv_obj_add_flag(m_timer_arc, LV_OBJ_FLAG_HIDDEN);
+      update_hidden(m_timer_arc, true);
     }
   }
 
   if (d->user_stopwatch().is_running()) {
     auto remaining_in_minute = d->user_stopwatch().elapsed_ms() % (60 * 1000);
     lv_arc_set_value(m_stopwatch_arc, 100 * remaining_in_minute / (60 * 1000));
-    lv_obj_remove_flag(m_stopwatch_arc, LV_OBJ_FLAG_HIDDEN);
+    update_hidden(m_stopwatch_arc, false);
   } else {
     if (d->user_stopwatch().elapsed_ms() == 0) {
-      lv_obj_add_flag(m_stopwatch_arc, LV_OBJ_FLAG_HIDDEN);
+      update_hidden(m_stopwatch_arc, true);
     }
   }
 
@@ -1,5 +1,8 @@
 #include "ui.h"
 #include "pages.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <util.h>
 
 namespace ui {
@@ -239,6 +242,34 @@ lv_obj_t* checkbox(lv_obj_t* parent) {
   return cb;
 }
 
+void update_label_text(lv_obj_t* label, char const* text) {
+  if (strcmp(lv_label_get_text(label), text) != 0)
+    lv_label_set_text(label, text);
+}
+
+void update_label_text_fmt(lv_obj_t* label, char const* fmt, ...) {
+  char text[64];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+  update_label_text(label, text);
+}
+
+void update_opa(lv_obj_t* obj, lv_opa_t opa) {
+  if (lv_obj_get_style_opa(obj, LV_PART_MAIN) != opa)
+    lv_obj_set_style_opa(obj, opa, 0);
+}
+
+void update_hidden(lv_obj_t* obj, bool hidden) {
+  if (lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN) == hidden)
+    return;
+  if (hidden)
+    lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+  else
+    lv_obj_remove_flag(obj, LV_OBJ_FLAG_HIDDEN);
+}
+
 lv_obj_t* headline1(lv_obj_t* parent) {
   auto* text = lv_label_create(parent);
   lv_obj_add_style(text, Ui::the().style().headline1(), 0);
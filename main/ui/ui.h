@@ -25,6 +25,8 @@ LV_FONT_DECLARE(font_montagu_slab_16);
 
 namespace ui {
 
+class HomeScreen;
+
 constexpr unsigned long LONG_PRESS_DURATION_MS = 300;
 
 lv_event_code_t register_lv_event_id();
@@ -140,6 +142,8 @@ public:
   void exit_fullscreen();
   bool in_fullscreen() { return !m_sub_screens.empty(); }
 
+  HomeScreen* home_screen() { return m_home_screen; }
+
   void add_overlay(Page* overlay) { m_overlays.push_back(overlay); }
 
   lv_obj_t* data_event_obj() { return m_data_event_obj; }
@@ -150,7 +154,7 @@ private:
   Style m_style;
 
   lv_obj_t* m_data_event_obj;
-  Screen* m_home_screen;
+  HomeScreen* m_home_screen;
 
   struct SubScreens {
     Screen* screen;
@@ -179,4 +183,15 @@ lv_obj_t* text_button(lv_obj_t* parent, char const* text,
 lv_obj_t* fullscreen_back_button(lv_obj_t* parent);
 lv_obj_t* checkbox(lv_obj_t* parent);
 
+// LVGL invalidates an object whenever its text, opacity or visibility is set,
+// even if the value didn't change. Pages updated periodically use these
+// instead, so only what actually changed is redrawn.
+
+void update_label_text(lv_obj_t* label, char const* text);
+/// The formatted text is truncated to 63 characters.
+void update_label_text_fmt(lv_obj_t* label, char const* fmt, ...)
+    LV_FORMAT_ATTRIBUTE(2, 3);
+void update_opa(lv_obj_t* obj, lv_opa_t opa);
+void update_hidden(lv_obj_t* obj, bool hidden);
+
 } // namespace ui
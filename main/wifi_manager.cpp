@@ -1,5 +1,6 @@
 #include "wifi_manager.h"
 #include <data.h>
+#include <esp_event.h>
 #include <esp_log.h>
 #include <esp_wifi.h>
 #include <lwip/err.h>
@@ -53,8 +54,7 @@ bool WifiManager::enable_wifi() {
       [](auto, auto, auto, void* event_data) {
         auto* event = static_cast<ip_event_got_ip_t*>(event_data);
         ESP_LOGI("WiFi", "Got IP: %d.%d.%d.%d", IP2STR(&event->ip_info.ip));
-        esp_event_post(DATA_EVENT_BASE, Data::Event::WifiConnected, NULL, 0,
-                       portMAX_DELAY);
+        Data::publish(Data::Event::WifiConnected);
         WifiManager::the().m_connection_retries = 0;
       },
       NULL);
@@ -83,8 +83,7 @@ bool WifiManager::enable_wifi() {
   m_enabled = false;
   ESP_LOGI("WiFi", "WiFi successfully enabled");
 
-  esp_event_post(DATA_EVENT_BASE, Data::Event::WifiEnabled, NULL, 0,
-                 portMAX_DELAY);
+  Data::publish(Data::Event::WifiEnabled);
 
   return true;
 }
@@ -99,8 +98,7 @@ void WifiManager::disable_wifi() {
   m_enabled = false;
   ESP_LOGI("WiFi", "WiFi successfully disabled");
 
-  esp_event_post(DATA_EVENT_BASE, Data::Event::WifiDisabled, NULL, 0,
-                 portMAX_DELAY);
+  Data::publish(Data::Event::WifiDisabled);
 }
 
 void WifiManager::set_ssid(std::string const& ssid) {